@@ -20,6 +20,10 @@ int main(int argc, char **argv)
     uint32_t num_threads, R, L, disk_PQ, build_PQ, QD, Lf, filter_threshold;
     float B, M;
     bool append_reorder_data = false;
+    bool locality_layout = false;
+    bool decoupled_layout = false;
+    bool compress_adjacency = false;
+    bool nav_graph = false;
     bool use_opq = false;
 
     po::options_description desc{
@@ -63,6 +67,18 @@ int main(int argc, char **argv)
         optional_configs.add_options()("append_reorder_data", po::bool_switch()->default_value(false),
                                        "Include full precision data in the index. Use only in "
                                        "conjuction with compressed data on SSD.");
+        optional_configs.add_options()("locality_layout", po::bool_switch()->default_value(false),
+                                       "Reorder nodes on disk so that graph neighbours share sectors. "
+                                       "Writes an id map next to the index that search applies on load.");
+        optional_configs.add_options()("decoupled_layout", po::bool_switch()->default_value(false),
+                                       "Store adjacency lists and full precision vectors in separate regions "
+                                       "of the disk index; vectors are read only to rerank the results.");
+        optional_configs.add_options()("compress_adjacency", po::bool_switch()->default_value(false),
+                                       "Store neighbour lists delta + group varint encoded so that more "
+                                       "nodes fit in a sector.");
+        optional_configs.add_options()("nav_graph", po::bool_switch()->default_value(false),
+                                       "Build a small in-memory graph over the sample points that search uses "
+                                       "to pick entry points close to the query.");
         optional_configs.add_options()("build_PQ_bytes", po::value<uint32_t>(&build_PQ)->default_value(0),
                                        program_options_utils::BUIlD_GRAPH_PQ_BYTES);
         optional_configs.add_options()("use_opq", po::bool_switch()->default_value(false),
@@ -94,6 +110,14 @@ int main(int argc, char **argv)
             append_reorder_data = true;
         if (vm["use_opq"].as<bool>())
             use_opq = true;
+        if (vm["locality_layout"].as<bool>())
+            locality_layout = true;
+        if (vm["decoupled_layout"].as<bool>())
+            decoupled_layout = true;
+        if (vm["compress_adjacency"].as<bool>())
+            compress_adjacency = true;
+        if (vm["nav_graph"].as<bool>())
+            nav_graph = true;
     }
     catch (const std::exception &ex)
     {
@@ -131,11 +155,23 @@ int main(int argc, char **argv)
         }
     }
 
+    if (append_reorder_data && decoupled_layout)
+    {
+        std::cout << "Error: --decoupled_layout already keeps full precision vectors in the index; "
+                     "it cannot be combined with --append_reorder_data."
+                  << std::endl;
+        return -1;
+    }
+
     std::string params = std::string(std::to_string(R)) + " " + std::string(std::to_string(L)) + " " +
                          std::string(std::to_string(B)) + " " + std::string(std::to_string(M)) + " " +
                          std::string(std::to_string(num_threads)) + " " + std::string(std::to_string(disk_PQ)) + " " +
                          std::string(std::to_string(append_reorder_data)) + " " +
-                         std::string(std::to_string(build_PQ)) + " " + std::string(std::to_string(QD));
+                         std::string(std::to_string(build_PQ)) + " " + std::string(std::to_string(QD)) + " " +
+                         std::string(std::to_string(locality_layout)) + " " +
+                         std::string(std::to_string(decoupled_layout)) + " " +
+                         std::string(std::to_string(compress_adjacency)) + " " +
+                         std::string(std::to_string(nav_graph));
 
     try
     {
@@ -0,0 +1,93 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <omp.h>
+#include <boost/program_options.hpp>
+
+#include "utils.h"
+#include "streaming_disk_index.h"
+#include "program_options_utils.hpp"
+
+namespace po = boost::program_options;
+
+int main(int argc, char **argv)
+{
+    std::string data_type, index_path_prefix, output_path_prefix;
+    uint32_t num_threads;
+    float min_deleted_fraction, alpha;
+
+    po::options_description desc{program_options_utils::make_program_description(
+        "compact_disk_index", "Rewrites a disk index without its deleted points once there are enough of them.")};
+    try
+    {
+        desc.add_options()("help,h", "Print information on arguments");
+
+        // Required parameters
+        po::options_description required_configs("Required");
+        required_configs.add_options()("data_type", po::value<std::string>(&data_type)->required(),
+                                       program_options_utils::DATA_TYPE_DESCRIPTION);
+        required_configs.add_options()("index_path_prefix", po::value<std::string>(&index_path_prefix)->required(),
+                                       program_options_utils::INDEX_PATH_PREFIX_DESCRIPTION);
+        required_configs.add_options()("output_path_prefix",
+                                       po::value<std::string>(&output_path_prefix)->required(),
+                                       "Path prefix of the compacted index. <prefix>_disk.index_old_ids.bin maps "
+                                       "its ids to those of the input index.");
+
+        // Optional parameters
+        po::options_description optional_configs("Optional");
+        optional_configs.add_options()("num_threads,T",
+                                       po::value<uint32_t>(&num_threads)->default_value(omp_get_num_procs()),
+                                       program_options_utils::NUMBER_THREADS_DESCRIPTION);
+        optional_configs.add_options()(
+            "min_deleted_fraction",
+            po::value<float>(&min_deleted_fraction)->default_value(diskann::defaults::COMPACTION_MIN_DELETED_FRACTION),
+            "Share of deleted points below which the index is left as it is.");
+        optional_configs.add_options()("alpha", po::value<float>(&alpha)->default_value(1.2f),
+                                       program_options_utils::GRAPH_BUILD_ALPHA);
+
+        // Merge required and optional parameters
+        desc.add(required_configs).add(optional_configs);
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        if (vm.count("help"))
+        {
+            std::cout << desc;
+            return 0;
+        }
+        po::notify(vm);
+    }
+    catch (const std::exception &ex)
+    {
+        std::cerr << ex.what() << '\n';
+        return -1;
+    }
+
+    try
+    {
+        bool compacted;
+        if (data_type == std::string("int8"))
+            compacted = diskann::compact_disk_index<int8_t>(index_path_prefix, output_path_prefix, num_threads,
+                                                            min_deleted_fraction, alpha);
+        else if (data_type == std::string("uint8"))
+            compacted = diskann::compact_disk_index<uint8_t>(index_path_prefix, output_path_prefix, num_threads,
+                                                             min_deleted_fraction, alpha);
+        else if (data_type == std::string("float"))
+            compacted = diskann::compact_disk_index<float>(index_path_prefix, output_path_prefix, num_threads,
+                                                           min_deleted_fraction, alpha);
+        else
+        {
+            diskann::cerr << "Error. Unsupported data type" << std::endl;
+            return -1;
+        }
+        if (!compacted)
+            diskann::cout << "Too few deleted points, index left as it is." << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << std::string(e.what()) << std::endl;
+        diskann::cerr << "Index compaction failed." << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -29,12 +29,18 @@
 #include "timer.h"
 #include "percentile_stats.h"
 #include "program_options_utils.hpp"
+#include "scheduled_aligned_file_reader.h"
 
 #ifndef _WINDOWS
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include "linux_aligned_file_reader.h"
+#include "mmap_aligned_file_reader.h"
+#include "striped_aligned_file_reader.h"
+#ifdef USE_IO_URING
+#include "io_uring_aligned_file_reader.h"
+#endif
 #else
 #ifdef USE_BING_INFRA
 #include "bing_aligned_file_reader.h"
@@ -75,7 +81,15 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
                       const uint32_t num_nodes_to_cache, const uint32_t search_io_limit,
                       const std::vector<uint32_t> &Lvec, const float fail_if_recall_below,
                       const std::vector<std::string> &query_filters, std::ofstream& csv_stream, 
-                      std::string& profile_perfix, const bool use_reorder_data = false)
+                      std::string& profile_perfix, const std::string &io_backend, const std::string &search_mode,
+                      const uint32_t queries_per_thread, const uint32_t sector_cache_mb,
+                      const std::string &co_resident, const uint32_t nav_seeds, const bool dedup_reads,
+                      const uint32_t adaptive_min_width, const uint32_t early_stop_hops,
+                      const uint32_t latency_budget_us, const std::string &budget_policy,
+                      const uint32_t io_device_depth, const uint32_t batch_io_depth, const float batch_query_fraction,
+                      const std::string &cache_list_file, const bool async_cache_load,
+                      const uint32_t cache_refresh_ms, const bool graph_only_cache,
+                      const bool use_reorder_data = false)
 {
     diskann::cout << "Search parameters: #threads: " << num_threads << ", ";
     if (beamwidth <= 0)
@@ -87,6 +101,24 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
     else
         diskann::cout << ", io_limit: " << search_io_limit << "." << std::endl;
 
+    if (search_mode != std::string("beam") && search_mode != std::string("pipelined") &&
+        search_mode != std::string("multiplexed"))
+    {
+        diskann::cerr << "Unsupported search_mode: " << search_mode << std::endl;
+        return -1;
+    }
+    if (search_mode != std::string("beam") && !query_filters.empty())
+    {
+        diskann::cerr << "search_mode " << search_mode << " does not support filters" << std::endl;
+        return -1;
+    }
+    const bool multiplexed = (search_mode == std::string("multiplexed"));
+    if (multiplexed && queries_per_thread == 0)
+    {
+        diskann::cerr << "queries_per_thread must be positive" << std::endl;
+        return -1;
+    }
+
     std::ofstream cache_hit_rate_file;
     cache_hit_rate_file.open(profile_perfix + "_cache_hit_rate.csv", std::ios::out);
 
@@ -134,28 +166,127 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
     reader.reset(new diskann::BingAlignedFileReader());
 #endif
 #else
-    reader.reset(new LinuxAlignedFileReader());
+    if (io_backend == std::string("aio"))
+    {
+        reader.reset(new LinuxAlignedFileReader());
+    }
+    else if (io_backend == std::string("mmap"))
+    {
+        reader.reset(new MmapAlignedFileReader());
+    }
+    else if (io_backend == std::string("mmap_populate"))
+    {
+        reader.reset(new MmapAlignedFileReader(true, true));
+    }
+    else if (io_backend == std::string("striped"))
+    {
+        reader.reset(new StripedAlignedFileReader());
+    }
+#ifdef USE_IO_URING
+    else if (io_backend == std::string("io_uring"))
+    {
+        reader.reset(new IoUringAlignedFileReader());
+    }
+    else if (io_backend == std::string("io_uring_sqpoll"))
+    {
+        reader.reset(new IoUringAlignedFileReader(true));
+    }
+#endif
+    else
+    {
+        diskann::cerr << "Unsupported io_backend: " << io_backend << std::endl;
+        return -1;
+    }
 #endif
+    diskann::cout << "Using I/O backend: " << io_backend << std::endl;
+
+    // with the I/O scheduler on, queries run in two classes: interactive (class 0) and a
+    // batch_query_fraction share of batch queries (class 1), spread evenly over the query set
+    std::shared_ptr<diskann::IOScheduler> io_scheduler;
+    if (io_device_depth > 0)
+    {
+        std::vector<diskann::IOScheduler::ClassConfig> classes(2);
+        classes[0].weight = 4;
+        classes[1].weight = 1;
+        classes[1].max_depth = batch_io_depth;
+        io_scheduler = std::make_shared<diskann::IOScheduler>(classes, io_device_depth);
+        reader.reset(new ScheduledAlignedFileReader(reader, io_scheduler));
+        diskann::cout << "I/O scheduler: device depth " << io_device_depth << ", batch depth "
+                      << (batch_io_depth > 0 ? std::to_string(batch_io_depth) : std::string("unlimited"))
+                      << ", batch queries " << batch_query_fraction << std::endl;
+    }
+    auto is_batch_query = [batch_query_fraction](int64_t i) {
+        return (int64_t)(i * (double)batch_query_fraction) != (int64_t)((i + 1) * (double)batch_query_fraction);
+    };
 
     std::unique_ptr<diskann::PQFlashIndex<T, LabelT>> _pFlashIndex(
         new diskann::PQFlashIndex<T, LabelT>(reader, metric));
 
-    int res = _pFlashIndex->load(num_threads, index_path_prefix.c_str());
+    // multiplexed search holds one scratch space per in-flight query
+    uint32_t num_scratch = multiplexed ? num_threads * queries_per_thread : num_threads;
+    int res = _pFlashIndex->load(num_scratch, index_path_prefix.c_str());
 
     if (res != 0)
     {
         return res;
     }
 
+    uint64_t cache_size = num_nodes_to_cache;
+    if (graph_only_cache)
+    {
+        // as many more nodes as fit in the memory the full cache would have taken
+        uint64_t full_node_bytes = _pFlashIndex->node_cache_bytes_per_node();
+        _pFlashIndex->set_node_cache_mode(diskann::NodeCacheMode::GRAPH_ONLY);
+        cache_size = cache_size * full_node_bytes / _pFlashIndex->node_cache_bytes_per_node();
+    }
+
     std::vector<uint32_t> node_list;
-    diskann::cout << "Caching " << num_nodes_to_cache << " nodes around medoid(s)" << std::endl;
-    _pFlashIndex->cache_bfs_levels(num_nodes_to_cache, node_list);
-    // if (num_nodes_to_cache > 0)
-    //     _pFlashIndex->generate_cache_list_from_sample_queries(warmup_query_file, 15, 6, num_nodes_to_cache,
-    //     num_threads, node_list);
-    _pFlashIndex->load_cache_list(node_list);
+    if (!cache_list_file.empty() && _pFlashIndex->read_cache_list(cache_list_file, node_list))
+    {
+        diskann::cout << "Read a cache list of " << node_list.size() << " nodes from " << cache_list_file
+                      << std::endl;
+    }
+    else
+    {
+        diskann::cout << "Caching " << cache_size << " nodes around medoid(s)" << std::endl;
+        _pFlashIndex->cache_bfs_levels(cache_size, node_list);
+        // if (num_nodes_to_cache > 0)
+        //     _pFlashIndex->generate_cache_list_from_sample_queries(warmup_query_file, 15, 6, num_nodes_to_cache,
+        //     num_threads, node_list);
+        if (!cache_list_file.empty())
+            _pFlashIndex->save_cache_list(cache_list_file, node_list);
+    }
+    if (async_cache_load)
+        _pFlashIndex->load_cache_list_async(node_list, num_threads);
+    else
+        _pFlashIndex->load_cache_list(node_list);
     node_list.clear();
     node_list.shrink_to_fit();
+    if (sector_cache_mb > 0)
+        _pFlashIndex->set_sector_cache((uint64_t)sector_cache_mb * 1024 * 1024);
+    if (dedup_reads)
+        _pFlashIndex->set_read_dedup(true);
+    _pFlashIndex->set_adaptive_beam(adaptive_min_width, early_stop_hops);
+    if (co_resident == std::string("score"))
+        _pFlashIndex->set_co_resident_mode(diskann::CoResidentMode::SCORE);
+    else if (co_resident == std::string("expand"))
+        _pFlashIndex->set_co_resident_mode(diskann::CoResidentMode::EXPAND);
+    else if (co_resident != std::string("none"))
+    {
+        diskann::cerr << "Unsupported co_resident mode: " << co_resident << std::endl;
+        return -1;
+    }
+    _pFlashIndex->set_nav_graph_params(nav_seeds, diskann::defaults::NAV_GRAPH_SEARCH_LIST_SIZE);
+
+    diskann::SearchBudget budget;
+    budget.latency_us = latency_budget_us;
+    if (budget_policy == std::string("hops"))
+        budget.policy = diskann::BudgetPolicy::HOPS;
+    else if (budget_policy != std::string("rerank"))
+    {
+        diskann::cerr << "Unsupported budget_policy: " << budget_policy << std::endl;
+        return -1;
+    }
 
     omp_set_num_threads(num_threads);
 
@@ -200,6 +331,13 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
         }
         diskann::cout << "..done" << std::endl;
     }
+    if (async_cache_load)
+    {
+        diskann::cout << "Cache nodes loaded when search starts: " << _pFlashIndex->num_cache_nodes_loaded()
+                      << std::endl;
+    }
+    if (cache_refresh_ms > 0)
+        _pFlashIndex->start_cache_refresh(cache_refresh_ms);
 
     diskann::cout.setf(std::ios_base::fixed, std::ios_base::floatfield);
     diskann::cout.precision(2);
@@ -264,37 +402,76 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
         std::vector<uint64_t> query_result_ids_64(recall_at * query_num);
         auto s = std::chrono::high_resolution_clock::now();
 
-#pragma omp parallel for schedule(dynamic, 1)
-        for (int64_t i = 0; i < (int64_t)query_num; i++)
+        if (multiplexed)
         {
-            // (stats + i) -> iter_ids = new uint32_t[L * optimized_beamwidth];
-            if (!filtered_search)
+            // each thread interleaves `queries_per_thread` queries; hand out blocks of queries
+            int64_t block = (int64_t)queries_per_thread * 4;
+#pragma omp parallel for schedule(dynamic, 1)
+            for (int64_t b = 0; b < (int64_t)query_num; b += block)
             {
-                _pFlashIndex->cached_beam_search(query + (i * query_aligned_dim), recall_at, L,
-                                                 query_result_ids_64.data() + (i * recall_at),
-                                                 query_result_dists[test_id].data() + (i * recall_at),
-                                                 optimized_beamwidth, use_reorder_data, stats + i);
+                uint64_t n = (std::min)((uint64_t)block, (uint64_t)(query_num - b));
+                _pFlashIndex->multiplexed_beam_search(query + (b * query_aligned_dim), n, query_aligned_dim, recall_at,
+                                                      L, query_result_ids_64.data() + (b * recall_at),
+                                                      query_result_dists[test_id].data() + (b * recall_at),
+                                                      optimized_beamwidth, queries_per_thread, use_reorder_data,
+                                                      stats + b);
             }
-            else
+        }
+        else
+        {
+#pragma omp parallel for schedule(dynamic, 1)
+            for (int64_t i = 0; i < (int64_t)query_num; i++)
             {
-                LabelT label_for_search;
-                if (query_filters.size() == 1)
-                { // one label for all queries
-                    label_for_search = _pFlashIndex->get_converted_label(query_filters[0]);
+                // (stats + i) -> iter_ids = new uint32_t[L * optimized_beamwidth];
+                if (io_scheduler != nullptr)
+                    ScheduledAlignedFileReader::set_thread_class(is_batch_query(i) ? 1 : 0);
+                if (search_mode == std::string("pipelined"))
+                {
+                    _pFlashIndex->pipelined_beam_search(query + (i * query_aligned_dim), recall_at, L,
+                                                        query_result_ids_64.data() + (i * recall_at),
+                                                        query_result_dists[test_id].data() + (i * recall_at),
+                                                        optimized_beamwidth, use_reorder_data, stats + i);
+                }
+                else if (!filtered_search && budget.latency_us > 0)
+                {
+                    _pFlashIndex->cached_beam_search_with_deadline(
+                        query + (i * query_aligned_dim), recall_at, L, query_result_ids_64.data() + (i * recall_at),
+                        query_result_dists[test_id].data() + (i * recall_at), optimized_beamwidth, budget,
+                        use_reorder_data, stats + i);
+                }
+                else if (!filtered_search)
+                {
+                    _pFlashIndex->cached_beam_search(query + (i * query_aligned_dim), recall_at, L,
+                                                     query_result_ids_64.data() + (i * recall_at),
+                                                     query_result_dists[test_id].data() + (i * recall_at),
+                                                     optimized_beamwidth, use_reorder_data, stats + i);
                 }
                 else
-                { // one label for each query
-                    label_for_search = _pFlashIndex->get_converted_label(query_filters[i]);
+                {
+                    LabelT label_for_search;
+                    if (query_filters.size() == 1)
+                    { // one label for all queries
+                        label_for_search = _pFlashIndex->get_converted_label(query_filters[0]);
+                    }
+                    else
+                    { // one label for each query
+                        label_for_search = _pFlashIndex->get_converted_label(query_filters[i]);
+                    }
+                    _pFlashIndex->cached_beam_search(
+                        query + (i * query_aligned_dim), recall_at, L, query_result_ids_64.data() + (i * recall_at),
+                        query_result_dists[test_id].data() + (i * recall_at), optimized_beamwidth, true, label_for_search,
+                        use_reorder_data, stats + i);
                 }
-                _pFlashIndex->cached_beam_search(
-                    query + (i * query_aligned_dim), recall_at, L, query_result_ids_64.data() + (i * recall_at),
-                    query_result_dists[test_id].data() + (i * recall_at), optimized_beamwidth, true, label_for_search,
-                    use_reorder_data, stats + i);
             }
         }
         auto e = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> diff = e - s;
         double qps = (1.0 * query_num) / (1.0 * diff.count());
+        if (multiplexed)
+        {
+            diskann::cout << "Multiplexed search with " << queries_per_thread << " queries per thread: " << qps
+                          << " QPS, " << qps / num_threads << " QPS per core" << std::endl;
+        }
 
         diskann::convert_types<uint64_t, uint32_t>(query_result_ids_64.data(), query_result_ids[test_id].data(),
                                                    query_num, recall_at);
@@ -338,6 +515,69 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
         auto cache_hit_rate = diskann::get_mean_stats<float>(
             stats, query_num, [](const diskann::QueryStats &stats) { return stats.cache_hit_rate; });
 
+        if (sector_cache_mb > 0)
+        {
+            auto mean_sector_cache_hits = diskann::get_mean_stats<float>(
+                stats, query_num, [](const diskann::QueryStats &stats) { return stats.n_sector_cache_hits; });
+            diskann::cout << "Mean sector cache hits per query: " << mean_sector_cache_hits << std::endl;
+        }
+
+        if (dedup_reads)
+        {
+            auto mean_dedup_reads = diskann::get_mean_stats<float>(
+                stats, query_num, [](const diskann::QueryStats &stats) { return stats.n_dedup_reads; });
+            diskann::cout << "Mean reads served by other queries' in-flight reads: " << mean_dedup_reads << std::endl;
+        }
+
+        if (early_stop_hops > 0)
+        {
+            auto early_stopped = diskann::get_mean_stats<float>(
+                stats, query_num, [](const diskann::QueryStats &stats) { return stats.early_stopped; });
+            diskann::cout << "Fraction of queries stopped early: " << early_stopped << std::endl;
+        }
+
+        if (latency_budget_us > 0)
+        {
+            auto truncated = diskann::get_mean_stats<float>(
+                stats, query_num, [](const diskann::QueryStats &stats) { return stats.truncated; });
+            diskann::cout << "Fraction of queries truncated by the latency budget: " << truncated << std::endl;
+        }
+
+        if (io_scheduler != nullptr)
+        {
+            const char *class_names[] = {"interactive", "batch"};
+            std::vector<float> class_latency[2];
+            for (int64_t i = 0; i < (int64_t)query_num; i++)
+                class_latency[is_batch_query(i) ? 1 : 0].push_back(stats[i].total_us);
+            auto class_stats = io_scheduler->get_class_stats(); // cumulative over all L
+            for (uint32_t c = 0; c < 2; c++)
+            {
+                if (class_latency[c].empty())
+                    continue;
+                std::sort(class_latency[c].begin(), class_latency[c].end());
+                float mean = std::accumulate(class_latency[c].begin(), class_latency[c].end(), 0.0f) /
+                             class_latency[c].size();
+                float p999 = class_latency[c][(uint64_t)(0.999 * class_latency[c].size())];
+                float wait_per_grant =
+                    class_stats[c].n_grants > 0 ? (float)class_stats[c].wait_us / class_stats[c].n_grants : 0;
+                diskann::cout << "Class " << class_names[c] << ": " << class_latency[c].size()
+                              << " queries, mean latency " << mean << "us, 99.9 latency " << p999
+                              << "us, mean scheduler wait per batch " << wait_per_grant << "us" << std::endl;
+            }
+        }
+
+        if (co_resident != std::string("none"))
+        {
+            auto mean_resident_scored = diskann::get_mean_stats<float>(
+                stats, query_num, [](const diskann::QueryStats &stats) { return stats.n_resident_scored; });
+            auto mean_resident_expanded = diskann::get_mean_stats<float>(
+                stats, query_num, [](const diskann::QueryStats &stats) { return stats.n_resident_expanded; });
+            auto mean_resident_ios_saved = diskann::get_mean_stats<float>(
+                stats, query_num, [](const diskann::QueryStats &stats) { return stats.n_resident_ios_saved; });
+            diskann::cout << "Co-resident nodes per query: scored " << mean_resident_scored << ", expanded "
+                          << mean_resident_expanded << ", reads saved " << mean_resident_ios_saved << std::endl;
+        }
+
         std::vector<float> chr_arr;
         diskann::get_stats_arr<float>(
             stats, query_num, chr_arr, [](const diskann::QueryStats &stats) { return stats.cache_hit_rate; });
@@ -418,6 +658,26 @@ int search_disk_index(diskann::Metric &metric, const std::string &index_path_pre
         delete[] stats;
     }
 
+#ifndef _WINDOWS
+    if (auto striped = std::dynamic_pointer_cast<StripedAlignedFileReader>(reader))
+    {
+        // cumulative over warmup, cache loading and every L
+        diskann::cout << "Per-device reads:" << std::endl;
+        for (auto &dev : striped->get_device_stats())
+        {
+            diskann::cout << "  " << dev.path << ": " << dev.n_reads << " reads, " << dev.n_bytes / (1024 * 1024)
+                          << " MiB, mean latency "
+                          << (dev.n_reads == 0 ? 0.0 : (double)dev.total_us / (double)dev.n_reads) << " us"
+                          << std::endl;
+        }
+    }
+#endif
+
+    if (cache_refresh_ms > 0)
+    {
+        _pFlashIndex->stop_cache_refresh();
+        diskann::cout << "Node cache refreshed " << _pFlashIndex->num_cache_refreshes() << " times" << std::endl;
+    }
     diskann::cout << "Done searching. Now saving results " << std::endl;
     uint64_t test_id = 0;
     for (auto L : Lvec)
@@ -526,10 +786,12 @@ int main(int argc, char **argv)
     //! ====================
 
     std::string data_type, dist_fn, index_path_prefix, result_path_prefix, query_file, gt_file, filter_label,
-        label_type, query_filters_file, csv_file;
-    uint32_t num_threads, K, W, num_nodes_to_cache, search_io_limit;
+        label_type, query_filters_file, csv_file, io_backend, search_mode, co_resident, budget_policy, cache_list_file;
+    uint32_t num_threads, K, W, num_nodes_to_cache, search_io_limit, queries_per_thread, sector_cache_mb, nav_seeds,
+        adaptive_min_width, early_stop_hops, latency_budget_us, io_device_depth, batch_io_depth, cache_refresh_ms;
+    float batch_query_fraction;
     std::vector<uint32_t> Lvec;
-    bool use_reorder_data = false;
+    bool use_reorder_data = false, dedup_reads = false, async_cache_load = false, graph_only_cache = false;
     float fail_if_recall_below = 0.0f;
 
     po::options_description desc{
@@ -571,6 +833,63 @@ int main(int argc, char **argv)
             "search_io_limit",
             po::value<uint32_t>(&search_io_limit)->default_value(std::numeric_limits<uint32_t>::max()),
             "Max #IOs for search.  Default value: uint32::max()");
+        optional_configs.add_options()("sector_cache_mb", po::value<uint32_t>(&sector_cache_mb)->default_value(0),
+                                       "Size of the dynamic sector cache in MB, filled by the queries themselves "
+                                       "and evicted with CLOCK. Default value: 0 (disabled)");
+        optional_configs.add_options()("adaptive_min_width",
+                                       po::value<uint32_t>(&adaptive_min_width)->default_value(0),
+                                       "Start every query with this beam width and double it, up to W, after each "
+                                       "hop that does not improve the k-th best candidate. Beam search only. "
+                                       "Default value: 0 (fixed W)");
+        optional_configs.add_options()("early_stop_hops", po::value<uint32_t>(&early_stop_hops)->default_value(0),
+                                       "Stop a query after this many hops in a row without improving the k-th best "
+                                       "candidate. Beam search only. Default value: 0 (disabled)");
+        optional_configs.add_options()("latency_budget_us",
+                                       po::value<uint32_t>(&latency_budget_us)->default_value(0),
+                                       "Per-query latency budget in microseconds. A query that would overrun it "
+                                       "returns its best results so far. Unfiltered beam search only. "
+                                       "Default value: 0 (no budget)");
+        optional_configs.add_options()("budget_policy", po::value<std::string>(&budget_policy)->default_value("rerank"),
+                                       "How a query spends the end of its latency budget, one of {rerank, hops}: "
+                                       "stop hopping in time for the full precision rerank, or keep hopping and "
+                                       "skip the rerank if it no longer fits. Default value: rerank");
+        optional_configs.add_options()("cache_list_file",
+                                       po::value<std::string>(&cache_list_file)->default_value(std::string("")),
+                                       "Read the list of nodes to cache from this file if it exists, else write "
+                                       "the generated list to it for later runs");
+        optional_configs.add_options()("async_cache_load", po::bool_switch(&async_cache_load)->default_value(false),
+                                       "Start searching right after load and fill the node cache from background "
+                                       "threads meanwhile");
+        optional_configs.add_options()("cache_refresh_ms", po::value<uint32_t>(&cache_refresh_ms)->default_value(0),
+                                       "Move the node cache to the nodes the queries visit most, re-checking at "
+                                       "this interval. Default value: 0 (static cache)");
+        optional_configs.add_options()("graph_only_cache", po::bool_switch(&graph_only_cache)->default_value(false),
+                                       "Cache neighbour lists without the full precision vectors, and that many "
+                                       "more nodes in the same memory; cached nodes get their exact distances in "
+                                       "the final rerank");
+        optional_configs.add_options()("io_device_depth", po::value<uint32_t>(&io_device_depth)->default_value(0),
+                                       "Put an I/O scheduler in front of the reader that keeps at most this many "
+                                       "reads in flight and shares them 4:1 between interactive and batch queries. "
+                                       "Default value: 0 (no scheduler)");
+        optional_configs.add_options()("batch_io_depth", po::value<uint32_t>(&batch_io_depth)->default_value(0),
+                                       "Reads the batch queries may have in flight under the I/O scheduler. "
+                                       "Default value: 0 (only io_device_depth applies)");
+        optional_configs.add_options()("batch_query_fraction",
+                                       po::value<float>(&batch_query_fraction)->default_value(0.0f),
+                                       "Share of the queries run as batch queries under the I/O scheduler; the "
+                                       "rest are interactive. Not used by search_mode multiplexed. "
+                                       "Default value: 0");
+        optional_configs.add_options()("dedup_reads", po::bool_switch(&dedup_reads)->default_value(false),
+                                       "Let a query that needs a sector another query is already reading wait for "
+                                       "that read instead of issuing its own. Beam search only.");
+        optional_configs.add_options()("co_resident", po::value<std::string>(&co_resident)->default_value("none"),
+                                       "What beam search does with the other nodes of a fetched sector, one of "
+                                       "{none, score, expand}. Only matters with several nodes per sector. "
+                                       "Default value: none");
+        optional_configs.add_options()(
+            "nav_seeds", po::value<uint32_t>(&nav_seeds)->default_value(diskann::defaults::NAV_GRAPH_NUM_SEEDS),
+            "Number of entry points taken from the in-memory navigation graph, if the index has one. "
+            "0 starts from the medoid instead.");
         optional_configs.add_options()("num_threads,T",
                                        po::value<uint32_t>(&num_threads)->default_value(omp_get_num_procs()),
                                        program_options_utils::NUMBER_THREADS_DESCRIPTION);
@@ -585,6 +904,23 @@ int main(int argc, char **argv)
                                        program_options_utils::FILTERS_FILE_DESCRIPTION);
         optional_configs.add_options()("label_type", po::value<std::string>(&label_type)->default_value("uint"),
                                        program_options_utils::LABEL_TYPE_DESCRIPTION);
+        optional_configs.add_options()("io_backend", po::value<std::string>(&io_backend)->default_value("aio"),
+                                       "I/O backend used to read the disk index, one of {aio, io_uring, "
+                                       "io_uring_sqpoll, mmap, mmap_populate, striped}. io_uring variants need a "
+                                       "build with -DIO_URING=ON. mmap serves reads from a mapping of the index "
+                                       "file and suits indexes that fit in the page cache; mmap_populate also "
+                                       "faults the whole file in at load and asks for huge pages. striped reads an "
+                                       "index split across devices by stripe_disk_index and reports per-device "
+                                       "latency. Default value: aio");
+        optional_configs.add_options()("search_mode", po::value<std::string>(&search_mode)->default_value("beam"),
+                                       "Search loop, one of {beam, pipelined, multiplexed}. pipelined keeps up to W "
+                                       "node reads in flight and expands each as it completes; multiplexed runs "
+                                       "queries_per_thread pipelined queries at once on every thread. Both are "
+                                       "Linux only, take no filters and ignore search_io_limit. Default value: beam");
+        optional_configs.add_options()("queries_per_thread",
+                                       po::value<uint32_t>(&queries_per_thread)->default_value(8),
+                                       "Queries interleaved by each thread with search_mode multiplexed. Run with "
+                                       "one thread per core. Default value: 8");
         optional_configs.add_options()("fail_if_recall_below",
                                        po::value<float>(&fail_if_recall_below)->default_value(0.0f),
                                        program_options_utils::FAIL_IF_RECALL_BELOW);
@@ -683,15 +1019,27 @@ int main(int argc, char **argv)
             if (data_type == std::string("float"))
                 search_disk_index<float, uint16_t>(
                     metric, index_path_prefix, result_path_prefix, query_file, gt_file, num_threads, K, W,
-                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, csv_stream, perfix, use_reorder_data);
+                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, csv_stream, perfix, io_backend, search_mode,
+                    queries_per_thread, sector_cache_mb, co_resident, nav_seeds, dedup_reads,
+                    adaptive_min_width, early_stop_hops, latency_budget_us, budget_policy,
+                    io_device_depth, batch_io_depth, batch_query_fraction, cache_list_file, async_cache_load,
+                    cache_refresh_ms, graph_only_cache, use_reorder_data);
             else if (data_type == std::string("int8"))
                 search_disk_index<int8_t, uint16_t>(
                     metric, index_path_prefix, result_path_prefix, query_file, gt_file, num_threads, K, W,
-                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, csv_stream, perfix, use_reorder_data);
+                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, csv_stream, perfix, io_backend, search_mode,
+                    queries_per_thread, sector_cache_mb, co_resident, nav_seeds, dedup_reads,
+                    adaptive_min_width, early_stop_hops, latency_budget_us, budget_policy,
+                    io_device_depth, batch_io_depth, batch_query_fraction, cache_list_file, async_cache_load,
+                    cache_refresh_ms, graph_only_cache, use_reorder_data);
             else if (data_type == std::string("uint8"))
                 search_disk_index<uint8_t, uint16_t>(
                     metric, index_path_prefix, result_path_prefix, query_file, gt_file, num_threads, K, W,
-                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, csv_stream, perfix, use_reorder_data);
+                    num_nodes_to_cache, search_io_limit, Lvec, fail_if_recall_below, query_filters, csv_stream, perfix, io_backend, search_mode,
+                    queries_per_thread, sector_cache_mb, co_resident, nav_seeds, dedup_reads,
+                    adaptive_min_width, early_stop_hops, latency_budget_us, budget_policy,
+                    io_device_depth, batch_io_depth, batch_query_fraction, cache_list_file, async_cache_load,
+                    cache_refresh_ms, graph_only_cache, use_reorder_data);
             else
             {
                 std::cerr << "Unsupported data type. Use float or int8 or uint8" << std::endl;
@@ -703,15 +1051,27 @@ int main(int argc, char **argv)
             if (data_type == std::string("float"))
                 search_disk_index<float>(metric, index_path_prefix, result_path_prefix, query_file, gt_file,
                                                 num_threads, K, W, num_nodes_to_cache, search_io_limit, Lvec,
-                                                fail_if_recall_below, query_filters, csv_stream, perfix, use_reorder_data);
+                                                fail_if_recall_below, query_filters, csv_stream, perfix, io_backend, search_mode,
+                    queries_per_thread, sector_cache_mb, co_resident, nav_seeds, dedup_reads,
+                    adaptive_min_width, early_stop_hops, latency_budget_us, budget_policy,
+                    io_device_depth, batch_io_depth, batch_query_fraction, cache_list_file, async_cache_load,
+                    cache_refresh_ms, graph_only_cache, use_reorder_data);
             else if (data_type == std::string("int8"))
                 search_disk_index<int8_t>(metric, index_path_prefix, result_path_prefix, query_file, gt_file,
                                                  num_threads, K, W, num_nodes_to_cache, search_io_limit, Lvec,
-                                                 fail_if_recall_below, query_filters, csv_stream, perfix, use_reorder_data);
+                                                 fail_if_recall_below, query_filters, csv_stream, perfix, io_backend, search_mode,
+                    queries_per_thread, sector_cache_mb, co_resident, nav_seeds, dedup_reads,
+                    adaptive_min_width, early_stop_hops, latency_budget_us, budget_policy,
+                    io_device_depth, batch_io_depth, batch_query_fraction, cache_list_file, async_cache_load,
+                    cache_refresh_ms, graph_only_cache, use_reorder_data);
             else if (data_type == std::string("uint8"))
                 search_disk_index<uint8_t>(metric, index_path_prefix, result_path_prefix, query_file, gt_file,
                                                   num_threads, K, W, num_nodes_to_cache, search_io_limit, Lvec,
-                                                  fail_if_recall_below, query_filters, csv_stream, perfix, use_reorder_data);
+                                                  fail_if_recall_below, query_filters, csv_stream, perfix, io_backend, search_mode,
+                    queries_per_thread, sector_cache_mb, co_resident, nav_seeds, dedup_reads,
+                    adaptive_min_width, early_stop_hops, latency_budget_us, budget_policy,
+                    io_device_depth, batch_io_depth, batch_query_fraction, cache_list_file, async_cache_load,
+                    cache_refresh_ms, graph_only_cache, use_reorder_data);
             else
             {
                 std::cerr << "Unsupported data type. Use float or int8 or uint8" << std::endl;
@@ -0,0 +1,39 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "utils.h"
+#include "disk_utils.h"
+
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        std::cout << argv[0]
+                  << " disk_index_file stripe_sectors stripe_file_1 [stripe_file_2 ...]\n"
+                     "Rewrites disk_index_file as the first stripe and writes the other stripes to the given "
+                     "files, e.g. one per device. Search with --io_backend striped."
+                  << std::endl;
+        exit(-1);
+    }
+
+    std::string disk_index_file(argv[1]);
+    uint64_t stripe_sectors = std::stoull(argv[2]);
+    std::vector<std::string> extra_stripe_files;
+    for (int i = 3; i < argc; i++)
+        extra_stripe_files.emplace_back(argv[i]);
+
+    try
+    {
+        diskann::stripe_disk_index(disk_index_file, extra_stripe_files, stripe_sectors);
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << std::string(e.what()) << std::endl;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,28 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstdint>
+
+#include "windows_customizations.h"
+
+namespace diskann
+{
+// Compressed neighbour lists for the disk index. Ids are sorted and delta coded,
+// then packed with group varint: every group of 4 values starts with a control
+// byte holding 2 bits per value (its byte length - 1), followed by the value
+// bytes in little endian order. The last group may hold fewer than 4 values.
+// Decoding full groups takes one shuffle and a prefix sum.
+
+// upper bound on the encoded size of a list of n ids
+DISKANN_DLLEXPORT uint64_t adjacency_max_encoded_len(uint64_t n);
+
+// sorts ids[0..n) in place and writes their encoding to `out`; returns the number of
+// bytes written
+DISKANN_DLLEXPORT uint64_t encode_adjacency(uint32_t *ids, uint64_t n, uint8_t *out);
+
+// decodes n ids from `in` into `out`. Bytes at or past `in_end` are never read, so
+// `in_end` may be the end of the node slot rather than the end of the encoding.
+DISKANN_DLLEXPORT void decode_adjacency(const uint8_t *in, const uint8_t *in_end, uint64_t n, uint32_t *out);
+} // namespace diskann
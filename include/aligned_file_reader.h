@@ -12,7 +12,19 @@
 #include <fcntl.h>
 #include <libaio.h>
 #include <unistd.h>
-typedef io_context_t IOContext;
+
+struct IoUringContext;
+struct StripedIOState;
+
+// A context is created per registered thread and copied into that thread's
+// search scratch. Only the handle of the reader that created it is set.
+struct IOContext
+{
+    io_context_t aio_ctx = 0;                 // LinuxAlignedFileReader
+    IoUringContext *uring = nullptr;          // IoUringAlignedFileReader
+    std::vector<void *> *mmap_done = nullptr; // MmapAlignedFileReader: bufs of submitted, already copied reads
+    StripedIOState *striped = nullptr;        // StripedAlignedFileReader
+};
 #else
 #include <Windows.h>
 #include <minwinbase.h>
@@ -98,7 +110,7 @@ class AlignedFileReader
 
   public:
     // returns the thread-specific context
-    // returns (io_context_t)(-1) if thread is not registered
+    // returns a context with invalid handles if thread is not registered
     virtual IOContext &get_ctx() = 0;
 
     virtual ~AlignedFileReader(){};
@@ -109,6 +121,19 @@ class AlignedFileReader
     virtual void deregister_thread() = 0;
     virtual void deregister_all_threads() = 0;
 
+    // optionally pin a caller-owned buffer with `ctx` so reads landing inside
+    // it can skip per-request page mapping; no-op for readers without support
+    virtual void register_buffer(IOContext &ctx, void *buf, uint64_t len)
+    {
+    }
+
+    // true if open() follows the <fname>_stripes.txt manifest of an index
+    // spread by stripe_disk_index(); other readers would see only the first stripe
+    virtual bool reads_striped_files() const
+    {
+        return false;
+    }
+
     // Open & close ops
     // Blocking calls
     virtual void open(const std::string &fname) = 0;
@@ -117,4 +142,20 @@ class AlignedFileReader
     // process batch of aligned requests in parallel
     // NOTE :: blocking call
     virtual void read(std::vector<AlignedRead> &read_reqs, IOContext &ctx, bool async = false) = 0;
+
+    // Non-blocking variant of read(): queues the requests on `ctx` and returns
+    // immediately. Each request's `buf` identifies it on completion and must
+    // stay valid (and unique among in-flight requests) until it is reaped.
+    virtual void submit_reqs(std::vector<AlignedRead> &read_reqs, IOContext &ctx)
+    {
+        throw diskann::ANNException("submit_reqs is not supported by this reader", -1);
+    }
+
+    // Waits until at least `min_completions` requests submitted on `ctx` have
+    // finished and appends the `buf` of every reaped request to `completed_bufs`.
+    // If a read failed it throws, after appending the bufs of everything it reaped.
+    virtual void get_completions(IOContext &ctx, uint64_t min_completions, std::vector<void *> &completed_bufs)
+    {
+        throw diskann::ANNException("get_completions is not supported by this reader", -1);
+    }
 };
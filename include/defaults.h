@@ -22,6 +22,29 @@ const float GRAPH_SLACK_FACTOR = 1.3;
 const uint64_t MAX_GRAPH_DEGREE = 512;
 const uint64_t SECTOR_LEN = 4096;
 const uint64_t MAX_N_SECTOR_READS = 128;
+// full-precision rerank: per-thread scratch for vector sectors, and the longest
+// run of adjacent sectors merged into one read
+const uint64_t RERANK_SCRATCH_SECTORS = 128;
+const uint64_t MAX_COALESCED_READ_SECTORS = 32;
+
+// In-memory navigation graph over a sample of an SSD index's points
+const uint32_t NAV_GRAPH_MAX_DEGREE = 32;
+const uint32_t NAV_GRAPH_BUILD_LIST_SIZE = 64;
+const uint32_t NAV_GRAPH_SEARCH_LIST_SIZE = 32;
+const uint32_t NAV_GRAPH_NUM_SEEDS = 8;
+
+// Online node cache refresh: per-round decay of the visit scores, and the smallest
+// fraction of the cache that has to change for a new generation to be built
+const float CACHE_REFRESH_DECAY = 0.5f;
+const float CACHE_REFRESH_MIN_CHANGE = 0.05f;
+
+// Streaming updates over an SSD index: sectors a merge reads, patches and writes at a time
+const uint64_t STREAMING_MERGE_BLOCK_SECTORS = 1024;
+
+// Deletes on a serving SSD index: the most a search grows L by to make up for deleted
+// candidates, and the deleted share at which compact_disk_index rewrites the index
+const float MAX_DELETED_L_OVERFETCH = 4.0f;
+const float COMPACTION_MIN_DELETED_FRACTION = 0.1f;
 
 // following constants should always be specified, but are useful as a
 // sensible default at cli / python boundaries
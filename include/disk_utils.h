@@ -100,9 +100,44 @@ DISKANN_DLLEXPORT int build_disk_index(
     const std::string &universal_label = "", const uint32_t filter_threshold = 0,
     const uint32_t Lf = 0); // default is empty string for no universal label
 
+// Orders nodes so that graph neighbours share sectors: nodes are visited in BFS order from
+// `start`, and each newly placed node pulls its unplaced neighbours into the rest of its
+// sector. Returns new_to_old, a permutation of [0, graph.size()).
+DISKANN_DLLEXPORT std::vector<uint32_t> compute_locality_layout(const std::vector<std::vector<uint32_t>> &graph,
+                                                              const uint32_t start, const uint64_t nnodes_per_sector);
+
+// Spreads an existing disk index over 1 + extra_stripe_files.size() files, in units of
+// stripe_sectors sectors dealt round-robin. disk_index_file is rewritten in place as the
+// first stripe (it keeps the header sector); the stripe size and the other files are
+// recorded in <disk_index_file>_stripes.txt for StripedAlignedFileReader. Throws if that
+// file exists already; PQFlashIndex::load() refuses the index with any other reader.
+DISKANN_DLLEXPORT void stripe_disk_index(const std::string &disk_index_file,
+                                         const std::vector<std::string> &extra_stripe_files,
+                                         const uint64_t stripe_sectors = 1);
+
+// Builds a small in-memory Vamana index over the points sampled to <sample_prefix>_data.bin
+// and saves it to nav_index_file, with the sampled ids next to it in <nav_index_file>_ids.bin.
+// PQFlashIndex loads <disk index>_nav.index and uses it to pick entry points.
+template <typename T>
+DISKANN_DLLEXPORT void build_nav_graph(const std::string &sample_prefix, const std::string &nav_index_file,
+                                       const uint32_t num_threads);
+
+// With locality_layout, nodes are written in compute_locality_layout() order and the
+// disk-id -> original-id map is saved to <output_file>_locality_map.bin. PQFlashIndex
+// applies the map on load, so callers keep seeing original ids.
+//
+// With decoupled_layout, graph sectors hold only [nnbrs][nbrs] and the vectors are
+// written to a separate region after them, read only to rerank the final candidates.
+// The header gains a [layout_flags][max_degree][vec_start_sector][vec_len] extension
+// after the file size. Cannot be combined with reorder data.
+//
+// With compress_adjacency, neighbour lists are stored in the adjacency_codec.h format
+// and the node slot is sized for the longest encoded list instead of the max degree.
 template <typename T>
 DISKANN_DLLEXPORT void create_disk_layout(const std::string base_file, const std::string mem_index_file,
                                           const std::string output_file,
-                                          const std::string reorder_data_file = std::string(""));
+                                          const std::string reorder_data_file = std::string(""),
+                                          const bool locality_layout = false, const bool decoupled_layout = false,
+                                          const bool compress_adjacency = false);
 
 } // namespace diskann
@@ -0,0 +1,90 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "windows_customizations.h"
+
+namespace diskann
+{
+// Admission control for reads issued by concurrent queries. Every read holds a
+// slot from the time it is issued until it completes. There is a global cap on
+// slots (the queue depth the device is allowed to see) and an optional cap per
+// priority class. When slots are short, waiting classes are served in weighted
+// fair order: a class's virtual time advances by slots / weight on each grant,
+// and the waiting class with the lowest virtual time goes next. Class 0 wins ties.
+// A class held back by its own cap does not block the other classes.
+//
+// Thread-safety: all methods may be called concurrently.
+class IOScheduler
+{
+  public:
+    struct ClassConfig
+    {
+        uint32_t weight = 1;
+        uint32_t max_depth = 0; // 0: only the device cap applies
+    };
+
+    struct ClassStats
+    {
+        uint64_t n_grants = 0;
+        uint64_t n_reads = 0;
+        uint64_t wait_us = 0; // summed time spent blocked in acquire()
+    };
+
+    DISKANN_DLLEXPORT IOScheduler(const std::vector<ClassConfig> &classes, uint32_t device_depth);
+
+    DISKANN_DLLEXPORT uint32_t num_classes() const;
+
+    // largest number of slots one acquire() for `cls` can get; larger batches have
+    // to be split by the caller
+    DISKANN_DLLEXPORT uint32_t max_grant(uint32_t cls) const;
+
+    // blocks until `n` slots (clamped to max_grant) are granted to `cls`
+    DISKANN_DLLEXPORT void acquire(uint32_t cls, uint32_t n);
+
+    // takes `n` slots without waiting, even past the caps; for reads that cannot
+    // block at submission, so the others still see them as in flight
+    DISKANN_DLLEXPORT void charge(uint32_t cls, uint32_t n);
+
+    DISKANN_DLLEXPORT void release(uint32_t cls, uint32_t n);
+
+    DISKANN_DLLEXPORT std::vector<ClassStats> get_class_stats();
+
+    // acquire() calls currently blocked, over all classes
+    DISKANN_DLLEXPORT uint64_t num_waiting();
+
+  private:
+    struct Waiter
+    {
+        uint64_t ticket;
+        uint32_t n;
+    };
+    struct ClassState
+    {
+        ClassConfig config;
+        uint32_t in_flight = 0;
+        double vtime = 0;
+        std::deque<Waiter> waiting;
+        ClassStats stats;
+    };
+
+    std::mutex _lock;
+    std::condition_variable _cv;
+    std::vector<ClassState> _classes;
+    uint32_t _device_depth;
+    uint32_t _in_flight = 0;
+    uint64_t _next_ticket = 0;
+    double _vclock = 0; // virtual time of the latest grant
+
+    void check_class(uint32_t cls) const;
+    // the waiting class to serve next, or -1; call with _lock held
+    int64_t next_class() const;
+};
+} // namespace diskann
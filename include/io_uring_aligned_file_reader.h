@@ -0,0 +1,67 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+#if !defined(_WINDOWS) && defined(USE_IO_URING)
+
+#include <liburing.h>
+
+#include "aligned_file_reader.h"
+#include "tsl/robin_map.h"
+
+// per-thread ring state; IOContext::uring points to one of these
+struct IoUringContext
+{
+    struct io_uring ring;
+    bool fixed_file = false;       // index file registered at slot 0
+    char *fixed_buf = nullptr;     // registered buffer (buf_index 0), if any
+    uint64_t fixed_buf_len = 0;
+    // length of each read submitted with submit_reqs(), by buffer, to spot short reads
+    tsl::robin_map<void *, uint64_t> pending_len;
+    // completions of those reads reaped by a blocking read(), with their results
+    std::vector<std::pair<void *, int>> requeued;
+};
+
+class IoUringAlignedFileReader : public AlignedFileReader
+{
+  private:
+    FileHandle file_desc;
+    IOContext bad_ctx;
+
+    // kernel-side submission polling; all rings share one poller, attached through the
+    // ring in sqpoll_wq_fd, which is handed to another live ring when that one exits
+    bool sqpoll;
+    uint32_t sqpoll_idle_ms;
+    int sqpoll_wq_fd = -1;
+
+  public:
+    IoUringAlignedFileReader(bool sqpoll = false, uint32_t sqpoll_idle_ms = 2000);
+    ~IoUringAlignedFileReader();
+
+    IOContext &get_ctx();
+
+    // register thread-id for a context; creates the thread's ring
+    void register_thread();
+
+    // de-register thread-id for a context
+    void deregister_thread();
+    void deregister_all_threads();
+
+    // registers `buf` as fixed buffer 0 of the ring behind `ctx`
+    void register_buffer(IOContext &ctx, void *buf, uint64_t len);
+
+    // Open & close ops
+    // Blocking calls
+    void open(const std::string &fname);
+    void close();
+
+    // process batch of aligned requests in parallel
+    // NOTE :: blocking call
+    void read(std::vector<AlignedRead> &read_reqs, IOContext &ctx, bool async = false);
+
+    // non-blocking submission and reaping; see AlignedFileReader
+    void submit_reqs(std::vector<AlignedRead> &read_reqs, IOContext &ctx);
+    void get_completions(IOContext &ctx, uint64_t min_completions, std::vector<void *> &completed_bufs);
+};
+
+#endif
@@ -4,14 +4,39 @@
 #pragma once
 #ifndef _WINDOWS
 
+#include <sys/uio.h>
+
 #include "aligned_file_reader.h"
 
+// most buffers scattered into by one merged read
+#define MAX_IOVS_PER_READ 64
+
+namespace diskann
+{
+// A run of requests covering one contiguous file range, read with a single
+// preadv into the requests' own buffers
+struct MergedRead
+{
+    uint64_t offset;
+    uint64_t len;
+    uint64_t iov_start; // first entry in the iovec array
+    uint64_t n_iovs;
+};
+
+// Sorts `read_reqs` by offset, reads identical requests once and turns runs of
+// contiguous requests into MergedReads. Requests skipped as duplicates are copied
+// from their twin's buffer after the I/O, see `dups` (twin, duplicate).
+DISKANN_DLLEXPORT void merge_requests(std::vector<AlignedRead> &read_reqs, std::vector<MergedRead> &merged,
+                                      std::vector<iovec> &iovs,
+                                      std::vector<std::pair<AlignedRead *, AlignedRead *>> &dups);
+} // namespace diskann
+
 class LinuxAlignedFileReader : public AlignedFileReader
 {
   private:
     uint64_t file_sz;
     FileHandle file_desc;
-    io_context_t bad_ctx = (io_context_t)-1;
+    IOContext bad_ctx;
 
   public:
     LinuxAlignedFileReader();
@@ -34,6 +59,10 @@ class LinuxAlignedFileReader : public AlignedFileReader
     // process batch of aligned requests in parallel
     // NOTE :: blocking call
     void read(std::vector<AlignedRead> &read_reqs, IOContext &ctx, bool async = false);
+
+    // non-blocking submission and reaping; see AlignedFileReader
+    void submit_reqs(std::vector<AlignedRead> &read_reqs, IOContext &ctx);
+    void get_completions(IOContext &ctx, uint64_t min_completions, std::vector<void *> &completed_bufs);
 };
 
 #endif
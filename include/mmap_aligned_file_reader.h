@@ -0,0 +1,56 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+#ifndef _WINDOWS
+
+#include "aligned_file_reader.h"
+
+// Serves reads from a shared read-only mapping of the index file. Meant for
+// indexes that fit in the page cache: a read is a memcpy from the mapping
+// rather than a syscall, and once the pages are resident there is no I/O at all.
+// Requests still land in the caller's buffers, so the search code is unchanged.
+class MmapAlignedFileReader : public AlignedFileReader
+{
+  private:
+    FileHandle file_desc;
+    char *base = nullptr;
+    uint64_t file_sz = 0;
+    IOContext bad_ctx;
+
+    // MAP_POPULATE: fault the whole file in at open() instead of on first touch
+    bool populate;
+    // MADV_HUGEPAGE on the mapping; only honoured where the kernel supports
+    // huge pages for file-backed memory (e.g. tmpfs), ignored elsewhere
+    bool hugepages;
+
+    void copy_reqs(std::vector<AlignedRead> &read_reqs);
+
+  public:
+    MmapAlignedFileReader(bool populate = false, bool hugepages = false);
+    ~MmapAlignedFileReader();
+
+    IOContext &get_ctx();
+
+    // register thread-id for a context
+    void register_thread();
+
+    // de-register thread-id for a context
+    void deregister_thread();
+    void deregister_all_threads();
+
+    // Open & close ops
+    // Blocking calls
+    void open(const std::string &fname);
+    void close();
+
+    // copies each request out of the mapping; always synchronous
+    void read(std::vector<AlignedRead> &read_reqs, IOContext &ctx, bool async = false);
+
+    // submit_reqs() copies immediately and queues the bufs on `ctx`, which
+    // get_completions() then hands back without waiting
+    void submit_reqs(std::vector<AlignedRead> &read_reqs, IOContext &ctx);
+    void get_completions(IOContext &ctx, uint64_t min_completions, std::vector<void *> &completed_bufs);
+};
+
+#endif
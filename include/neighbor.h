@@ -52,11 +52,12 @@ class NeighborPriorityQueue
     // set item or it has a greated distance than the final
     // item in the set. The set cursor that is used to pop() the
     // next item will be set to the lowest index of an uncheck item
-    void insert(const Neighbor &nbr)
+    // Returns false if the item was dropped.
+    bool insert(const Neighbor &nbr)
     {
         if (_size == _capacity && _data[_size - 1] < nbr)
         {
-            return;
+            return false;
         }
 
         size_t lo = 0, hi = _size;
@@ -70,7 +71,7 @@ class NeighborPriorityQueue
             }
             else if (_data[mid].id == nbr.id)
             {
-                return;
+                return false;
             }
             else
             {
@@ -78,10 +79,11 @@ class NeighborPriorityQueue
             }
         }
 
-        if (lo < _capacity)
+        if (lo >= _capacity)
         {
-            std::memmove(&_data[lo + 1], &_data[lo], (_size - lo) * sizeof(Neighbor));
+            return false;
         }
+        std::memmove(&_data[lo + 1], &_data[lo], (_size - lo) * sizeof(Neighbor));
         _data[lo] = {nbr.id, nbr.distance};
         if (_size < _capacity)
         {
@@ -91,6 +93,29 @@ class NeighborPriorityQueue
         {
             _cur = lo;
         }
+        return true;
+    }
+
+    // Like insert(), but an unexpanded item that does not fit, be it `nbr` or
+    // the last item it pushes out of a full set, is appended to `overflow`
+    // instead of being lost, so it can be inserted again after reserve() grows
+    // the set.
+    void insert(const Neighbor &nbr, std::vector<Neighbor> &overflow)
+    {
+        if (_size < _capacity)
+        {
+            insert(nbr);
+            return;
+        }
+        if (_capacity == 0 || _data[_size - 1] < nbr)
+        {
+            overflow.push_back(nbr);
+            return;
+        }
+        // past the check above, insert() only refuses an id the set already holds
+        Neighbor last = _data[_size - 1];
+        if (insert(nbr) && !last.expanded)
+            overflow.push_back(last);
     }
 
     Neighbor closest_unexpanded()
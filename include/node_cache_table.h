@@ -0,0 +1,113 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "utils.h"
+#include "windows_customizations.h"
+
+namespace diskann
+{
+// Static cache of whole nodes, laid out once for a fixed list of node ids. Slot i
+// holds the coords of node i of the list followed by its neighbour count and ids,
+// [COORDS][NNBRS][NBR_ID(uint32_t)], in one run of cache lines, so a hit costs
+// a probe of the index and then reads that run. The index is a flat open-addressing
+// table of (node id, slot) pairs with linear probing, at most half full.
+//
+// Thread-safety: lookups may run concurrently with the loading of other slots. A
+// slot is written once, then published with set_loaded(); readers must check
+// loaded() before using it.
+class NodeCacheTable
+{
+  public:
+    // coord_bytes is 0 when only neighbourhoods are cached
+    DISKANN_DLLEXPORT NodeCacheTable(const std::vector<uint32_t> &node_ids, uint64_t coord_bytes,
+                                     uint64_t max_degree);
+    DISKANN_DLLEXPORT ~NodeCacheTable();
+
+    // slot of node_id, or -1 if it has none
+    inline int64_t find(uint32_t node_id) const
+    {
+        uint64_t pos = ((uint64_t)node_id * 0x9E3779B97F4A7C15ULL) >> _index_shift;
+        while (true)
+        {
+            const IndexEntry &entry = _index[pos];
+            if (entry.node_id == node_id)
+                return entry.slot;
+            if (entry.node_id == EMPTY_ID)
+                return -1;
+            pos = (pos + 1) & _index_mask;
+        }
+    }
+
+    inline bool loaded(uint64_t slot) const
+    {
+        return _loaded[slot].load(std::memory_order_acquire);
+    }
+    // call once the slot's coords and neighbourhood are written
+    inline void set_loaded(uint64_t slot)
+    {
+        _loaded[slot].store(true, std::memory_order_release);
+    }
+
+    // pulls a slot into L1 ahead of its use
+    inline void prefetch(uint64_t slot) const
+    {
+        prefetch_vector(_slots + slot * _slot_len, _slot_len);
+    }
+
+    inline char *coords(uint64_t slot) const
+    {
+        return _slots + slot * _slot_len;
+    }
+    // [NNBRS][NBR_ID(uint32_t)]
+    inline uint32_t *nhood(uint64_t slot) const
+    {
+        return (uint32_t *)(_slots + slot * _slot_len + _coord_bytes);
+    }
+
+    inline uint32_t node_id(uint64_t slot) const
+    {
+        return _node_ids[slot];
+    }
+    inline uint64_t size() const
+    {
+        return _node_ids.size();
+    }
+    inline bool has_coords() const
+    {
+        return _coord_bytes > 0;
+    }
+    // bytes per slot, a multiple of the cache line
+    inline uint64_t slot_len() const
+    {
+        return _slot_len;
+    }
+    static inline uint64_t slot_len(uint64_t coord_bytes, uint64_t max_degree)
+    {
+        return ROUND_UP(coord_bytes + (max_degree + 1) * sizeof(uint32_t), 64);
+    }
+
+  private:
+    static const uint32_t EMPTY_ID = 0xFFFFFFFF;
+    struct IndexEntry
+    {
+        uint32_t node_id;
+        uint32_t slot;
+    };
+
+    std::vector<uint32_t> _node_ids;
+    uint64_t _coord_bytes;
+    uint64_t _slot_len;
+    char *_slots = nullptr;
+    std::vector<IndexEntry> _index;
+    uint64_t _index_mask;
+    uint32_t _index_shift;
+    std::unique_ptr<std::atomic<bool>[]> _loaded;
+};
+} // namespace diskann
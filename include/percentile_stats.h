@@ -45,7 +45,15 @@ struct QueryStats
     unsigned n_cmps = 0;       // # cmps
     unsigned n_cache_hits = 0; // # cache_hits
     unsigned n_cache_misses = 0; // # cache_misses
+    unsigned n_sector_cache_hits = 0; // # cache misses served by the sector cache
+    unsigned n_resident_scored = 0;   // # co-resident nodes scored from fetched sectors
+    unsigned n_resident_expanded = 0; // # co-resident nodes expanded without their own read
+    unsigned n_resident_ios_saved = 0; // # beam candidates skipped as already expanded in place
+    unsigned n_rerank_prefetched = 0;  // # rerank vectors read while the search was still running
+    unsigned n_dedup_reads = 0;        // # sector reads served by another query's in-flight read
     unsigned n_hops = 0;       // # search hops
+    unsigned early_stopped = 0; // 1 if the search ended on the no-improvement rule
+    unsigned truncated = 0;     // 1 if a latency budget cut the search or its rerank short
 
     unsigned n_nnbrs = 0; // # avg neighbors
     unsigned n_dist = 0; // # avg distance
@@ -3,6 +3,9 @@
 
 #pragma once
 #include "common_includes.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #include "aligned_file_reader.h"
 #include "concurrent_queue.h"
@@ -13,17 +16,121 @@
 #include "utils.h"
 #include "windows_customizations.h"
 #include "scratch.h"
+#include "node_cache_table.h"
+#include "read_single_flight.h"
+#include "sector_cache.h"
 #include "tsl/robin_map.h"
 #include "tsl/robin_set.h"
 
 #define FULL_PRECISION_REORDER_MULTIPLIER 3
 
+// bits of the layout_flags field in the disk index header extension
+#define DISK_LAYOUT_DECOUPLED 0x1            // graph sectors first, then a separate vector region
+#define DISK_LAYOUT_COMPRESSED_ADJACENCY 0x2 // neighbour lists in the adjacency_codec.h format
+
 namespace diskann
 {
+template <typename T, typename TagT, typename LabelT> class Index;
+
+// What cached_beam_search does with the other nodes of a multi-node sector it
+// read for one node: nothing, add their exact distances to the candidates, or
+// also expand the promising ones in place, saving their own reads later on.
+enum class CoResidentMode
+{
+    NONE,
+    SCORE,
+    EXPAND
+};
+
+// What the node cache keeps for each cached node. FULL keeps the full precision
+// coords next to the neighbour list. GRAPH_ONLY keeps the neighbour list only, so the
+// same memory holds several times more nodes; a cached node is then scored by its
+// (always resident) PQ code and its exact distance is read back in the final rerank.
+enum class NodeCacheMode
+{
+    FULL,
+    GRAPH_ONLY
+};
+
+// How cached_beam_search_with_deadline spends what is left of its latency budget.
+// RERANK stops hopping early enough to leave time for the full precision rerank;
+// HOPS keeps hopping while a hop still fits and skips the rerank if it no longer does.
+enum class BudgetPolicy
+{
+    RERANK,
+    HOPS
+};
+
+struct SearchBudget
+{
+    uint64_t latency_us = 0; // from the call to the return; 0 means no deadline
+    BudgetPolicy policy = BudgetPolicy::RERANK;
+};
 
 template <typename T, typename LabelT = uint32_t> class PQFlashIndex
 {
   public:
+    // The search state of one paginated query, kept between next_page() calls: its
+    // candidate list, visited set and the nodes expanded so far. A cursor only holds
+    // memory of its own; scratch space is borrowed for the duration of each call.
+    class SearchCursor
+    {
+      public:
+        // true once the cursor has nothing more to return, or has expired
+        bool exhausted() const
+        {
+            return _exhausted;
+        }
+        uint64_t num_returned() const
+        {
+            return _returned.size();
+        }
+
+      private:
+        friend class PQFlashIndex<T, LabelT>;
+
+        std::vector<T> _query;
+        uint64_t _l_search = 0;
+        uint64_t _max_l_search = 0;
+        uint64_t _beam_width = 0;
+        bool _use_reorder_data = false;
+        bool _started = false;
+        bool _exhausted = false;
+        std::chrono::steady_clock::time_point _expiry;
+        uint64_t _page_size = 0; // results written by the last call
+
+        tsl::robin_set<size_t> _visited;
+        NeighborPriorityQueue _retset;
+        std::vector<Neighbor> _full_retset;
+        std::vector<Neighbor> _retset_overflow;
+        tsl::robin_set<uint32_t> _full_scored;
+        tsl::robin_set<uint32_t> _expanded_in_place;
+        tsl::robin_set<uint32_t> _pq_scored;
+        tsl::robin_set<uint32_t> _returned; // ids handed out so far
+
+        void swap_state(SSDQueryScratch<T> &scratch)
+        {
+            std::swap(_visited, scratch.visited);
+            std::swap(_retset, scratch.retset);
+            std::swap(_full_retset, scratch.full_retset);
+            std::swap(_retset_overflow, scratch.retset_overflow);
+            std::swap(_full_scored, scratch.full_scored);
+            std::swap(_expanded_in_place, scratch.expanded_in_place);
+            std::swap(_pq_scored, scratch.pq_scored);
+        }
+        void release()
+        {
+            _exhausted = true;
+            tsl::robin_set<size_t>().swap(_visited);
+            _retset = NeighborPriorityQueue();
+            std::vector<Neighbor>().swap(_full_retset);
+            std::vector<Neighbor>().swap(_retset_overflow);
+            tsl::robin_set<uint32_t>().swap(_full_scored);
+            tsl::robin_set<uint32_t>().swap(_expanded_in_place);
+            tsl::robin_set<uint32_t>().swap(_pq_scored);
+        }
+    };
+
     DISKANN_DLLEXPORT PQFlashIndex(std::shared_ptr<AlignedFileReader> &fileReader,
                                    diskann::Metric metric = diskann::Metric::L2);
     DISKANN_DLLEXPORT ~PQFlashIndex();
@@ -46,6 +153,35 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
 
     DISKANN_DLLEXPORT void load_cache_list(std::vector<uint32_t> &node_list);
 
+    // Call before loading a cache list. The decoupled layout always caches neighbour lists only.
+    DISKANN_DLLEXPORT void set_node_cache_mode(NodeCacheMode mode);
+    // memory one cached node takes in the current mode, to size a cache list to a budget
+    DISKANN_DLLEXPORT uint64_t node_cache_bytes_per_node() const;
+
+    // Like load_cache_list(), but only lays the cache out and returns; num_threads
+    // background threads then read the nodes in large batches, and searches use each
+    // cached node from the moment its read lands. Call after load(), before searching.
+    DISKANN_DLLEXPORT void load_cache_list_async(const std::vector<uint32_t> &node_list, uint32_t num_threads);
+    // blocks until the background cache load is done; returns the number of nodes cached
+    DISKANN_DLLEXPORT uint64_t wait_for_cache_load();
+    DISKANN_DLLEXPORT uint64_t num_cache_nodes_loaded() const;
+
+    // A generated cache list can be saved and read back on a later start, skipping the
+    // BFS or the warmup pass that made it. read_cache_list() returns false if there is no
+    // file at `path`.
+    DISKANN_DLLEXPORT void save_cache_list(const std::string &path, const std::vector<uint32_t> &node_list);
+    DISKANN_DLLEXPORT bool read_cache_list(const std::string &path, std::vector<uint32_t> &node_list);
+
+    // Keeps the node cache on the nodes live queries visit most. A background thread counts
+    // visits and, every interval_ms, adds them to a per-node score that decays by `decay`
+    // each round. When the top scoring nodes, as many as the cache holds now, differ from
+    // the cached ones by at least CACHE_REFRESH_MIN_CHANGE, it builds a new cache next to
+    // the current one and swaps it in; queries never wait on it. Call after the cache is
+    // loaded. generate_cache_list_from_sample_queries() cannot run while it is on.
+    DISKANN_DLLEXPORT void start_cache_refresh(uint32_t interval_ms, float decay = defaults::CACHE_REFRESH_DECAY);
+    DISKANN_DLLEXPORT void stop_cache_refresh();
+    DISKANN_DLLEXPORT uint64_t num_cache_refreshes() const;
+
 #ifdef EXEC_ENV_OLS
     DISKANN_DLLEXPORT void generate_cache_list_from_sample_queries(MemoryMappedFiles &files, std::string sample_bin,
                                                                    uint64_t l_search, uint64_t beamwidth,
@@ -58,6 +194,30 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
                                                                    std::vector<uint32_t> &node_list);
 #endif
 
+    // Enables a shared cache of up to cache_bytes of graph sectors in front of the reader,
+    // filled from the reads of live queries (0 disables it). Call after load(). Complements
+    // the static node cache above, which is checked first.
+    DISKANN_DLLEXPORT void set_sector_cache(uint64_t cache_bytes);
+
+    // With dedup on, a beam search that misses both caches and finds the sector already
+    // being read by another query waits for that read instead of issuing its own.
+    // Call after load().
+    DISKANN_DLLEXPORT void set_read_dedup(bool enable);
+
+    // Only has an effect when several nodes share a sector; see CoResidentMode.
+    DISKANN_DLLEXPORT void set_co_resident_mode(CoResidentMode mode);
+
+    // When <disk index>_nav.index was loaded, unfiltered searches start from the num_seeds
+    // nearest sample points found in it (searched with list size search_l) instead of
+    // the medoid. num_seeds = 0 goes back to the medoid.
+    DISKANN_DLLEXPORT void set_nav_graph_params(uint32_t num_seeds, uint32_t search_l);
+
+    // Adaptive beam search. With min_beam_width > 0, each query starts with that beam
+    // width and doubles it, up to the beam_width it was called with, after every hop that
+    // did not improve the k-th best candidate distance. With stop_after_hops > 0, a query
+    // also stops once that many hops in a row brought no improvement. 0 disables either.
+    DISKANN_DLLEXPORT void set_adaptive_beam(uint32_t min_beam_width, uint32_t stop_after_hops);
+
     DISKANN_DLLEXPORT void cache_bfs_levels(uint64_t num_nodes_to_cache, std::vector<uint32_t> &node_list,
                                             const bool shuffle = false);
 
@@ -81,6 +241,54 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
                                               const uint32_t io_limit, const bool use_reorder_data = false,
                                               QueryStats *stats = nullptr);
 
+    // Unfiltered cached_beam_search that returns within budget.latency_us where it can.
+    // Before every hop and before the rerank it predicts the step's cost from the hops this
+    // query has made so far, and returns the best results found yet if the step would
+    // overrun. Reads already issued are always waited for, so a single stalled read can
+    // still overrun. Returns true if the results were truncated that way.
+    DISKANN_DLLEXPORT bool cached_beam_search_with_deadline(const T *query, const uint64_t k_search,
+                                                            const uint64_t l_search, uint64_t *res_ids,
+                                                            float *res_dists, const uint64_t beam_width,
+                                                            const SearchBudget &budget,
+                                                            const bool use_reorder_data = false,
+                                                            QueryStats *stats = nullptr);
+
+    // Paginated unfiltered search. begin_search() makes a cursor for `query`; every
+    // next_page() call then returns the next (up to) k_page results, continuing the
+    // search where the previous call stopped instead of starting over. The candidate
+    // list starts at l_search and grows to fit the results handed out so far plus the
+    // next page; the cursor is exhausted once that would take more than max_l_search,
+    // or after lifetime_ms (0: no limit), and then frees its state.
+    DISKANN_DLLEXPORT std::unique_ptr<SearchCursor> begin_search(const T *query, const uint64_t l_search,
+                                                                 const uint64_t beam_width,
+                                                                 const uint64_t max_l_search,
+                                                                 const uint64_t lifetime_ms = 0,
+                                                                 const bool use_reorder_data = false);
+    // returns the number of results written, fewer than k_page once the cursor is exhausted
+    DISKANN_DLLEXPORT uint64_t next_page(SearchCursor &cursor, const uint64_t k_page, uint64_t *res_ids,
+                                         float *res_dists, QueryStats *stats = nullptr);
+
+    // Pipelined variant of the unfiltered cached_beam_search. Rather than issuing a beam of
+    // reads and waiting for all of them, it keeps up to beam_width node reads in flight and
+    // expands each node as soon as its read completes. Needs a reader that implements
+    // submit_reqs()/get_completions() (Linux aio or io_uring).
+    DISKANN_DLLEXPORT void pipelined_beam_search(const T *query, const uint64_t k_search, const uint64_t l_search,
+                                                 uint64_t *res_ids, float *res_dists, const uint64_t beam_width,
+                                                 const bool use_reorder_data = false, QueryStats *stats = nullptr);
+
+    // Searches `num_queries` queries (stored `query_aligned_dim` apart) on the calling thread,
+    // keeping up to `num_inflight_queries` of them in flight. Each query runs the pipelined
+    // search state machine; all of them submit through one io context and the thread
+    // expands whichever query's reads complete first, so a few threads can keep the SSD
+    // queue full. Borrows one thread-data scratch per in-flight query, so load() with
+    // num_threads * num_inflight_queries scratch spaces. Results are k_search per query.
+    // A query's rerank reads go on a context the shared queue does not use.
+    DISKANN_DLLEXPORT void multiplexed_beam_search(const T *queries, const uint64_t num_queries,
+                                                   const uint64_t query_aligned_dim, const uint64_t k_search,
+                                                   const uint64_t l_search, uint64_t *res_ids, float *res_dists,
+                                                   const uint64_t beam_width, const uint64_t num_inflight_queries,
+                                                   const bool use_reorder_data = false, QueryStats *stats = nullptr);
+
     DISKANN_DLLEXPORT LabelT get_converted_label(const std::string &filter_label);
 
     DISKANN_DLLEXPORT uint32_t range_search(const T *query1, const double range, const uint64_t min_l_search,
@@ -108,6 +316,18 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     DISKANN_DLLEXPORT std::vector<std::uint8_t> get_pq_vector(std::uint64_t vid);
     DISKANN_DLLEXPORT uint64_t get_num_points();
 
+    // Takes points out of search results at once, for takedowns. Deleted nodes still
+    // route searches but never enter full_retset, and searches grow L by the deleted
+    // share of the index to make up for them. ids are those searches return. The set
+    // is saved to <disk index>_deleted_ids.bin, which load() reads back; run
+    // compact_disk_index once it grows large. Returns the number newly deleted.
+    DISKANN_DLLEXPORT uint64_t delete_points(const std::vector<uint32_t> &ids);
+    // delete_points() without the save, for callers that delete one point at a time;
+    // they call save_deleted_ids() when the set should reach the disk
+    DISKANN_DLLEXPORT uint64_t mark_points_deleted(const std::vector<uint32_t> &ids);
+    DISKANN_DLLEXPORT void save_deleted_ids();
+    DISKANN_DLLEXPORT uint64_t get_num_deleted();
+
   protected:
     DISKANN_DLLEXPORT void use_medoids_data_as_centroids();
     DISKANN_DLLEXPORT void setup_thread_data(uint64_t nthreads, uint64_t visited_reserve = 4096);
@@ -115,6 +335,28 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     DISKANN_DLLEXPORT void set_universal_label(const LabelT &label);
 
   private:
+    // read_nodes() with the caller's IO context
+    DISKANN_DLLEXPORT std::vector<bool> read_nodes(const std::vector<uint32_t> &node_ids,
+                                                   std::vector<T *> &coord_buffers,
+                                                   std::vector<std::pair<uint32_t, uint32_t *>> &nbr_buffers,
+                                                   IOContext &ctx);
+    // allocates a node cache generation for node_list, with nothing loaded yet
+    DISKANN_DLLEXPORT NodeCacheTable *layout_cache(const std::vector<uint32_t> &node_list);
+    // reads slots [start, end) of `cache` and publishes them; returns the number loaded
+    DISKANN_DLLEXPORT uint64_t load_cache_slots(NodeCacheTable &cache, uint64_t start, uint64_t end, IOContext &ctx);
+
+    // Queries find the current generation through pin_node_cache(), which publishes the
+    // cache epoch in the query's thread data before reading the pointer; clearing the
+    // thread data unpins it. A generation replaced in epoch E is only freed once every
+    // thread data is unpinned or pinned at E or later, so a query never sees it freed.
+    DISKANN_DLLEXPORT NodeCacheTable *pin_node_cache(SSDThreadData<T> *data);
+    // makes `cache` current and retires the previous generation; call with _cache_swap_lock held
+    DISKANN_DLLEXPORT void swap_node_cache(NodeCacheTable *cache);
+    // frees the retired generations no query can still be using
+    DISKANN_DLLEXPORT void reclaim_node_caches();
+    // one round of the cache refresher; returns true if it swapped in a new generation
+    DISKANN_DLLEXPORT bool refresh_node_cache(std::vector<float> &scores, float decay, IOContext &ctx);
+
     DISKANN_DLLEXPORT inline bool point_has_label(uint32_t point_id, uint32_t label_id);
     std::unordered_map<std::string, LabelT> load_label_map(const std::string &map_file);
     DISKANN_DLLEXPORT void parse_label_file(const std::string &map_file, size_t &num_pts_labels);
@@ -123,6 +365,100 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     DISKANN_DLLEXPORT void generate_random_labels(std::vector<LabelT> &labels, const uint32_t num_labels,
                                                   const uint32_t nthreads);
 
+    // state of one query in the pipelined search
+    struct PipelinedQuery
+    {
+        SSDThreadData<T> *data = nullptr;
+        uint64_t k_search = 0;
+        uint64_t l_search = 0;
+        uint64_t max_inflight = 0;
+        float query_norm = 0;
+        QueryStats *stats = nullptr;
+        uint64_t num_expanded = 0;                         // nodes expanded so far
+        NodeCacheTable *node_cache = nullptr;              // pinned by pipeline_start
+        std::vector<char *> free_bufs;                     // unused node-sized slots of sector_scratch
+        std::vector<std::pair<char *, uint32_t>> inflight; // slot -> node id being read into it
+        std::vector<AlignedRead> pending;                  // prepared by pipeline_issue, not yet submitted
+    };
+
+    // normalizes (for MIPS) and copies the query into scratch, fills the PQ distance table;
+    // returns the query norm
+    DISKANN_DLLEXPORT float preprocess_query(const T *query1, SSDQueryScratch<T> *query_scratch, QueryStats *stats);
+
+    DISKANN_DLLEXPORT void pipeline_start(PipelinedQuery &q, const T *query1);
+    // expands cached candidates inline and queues reads for the rest into q.pending
+    DISKANN_DLLEXPORT void pipeline_issue(PipelinedQuery &q);
+    // expands the node whose read into `buf` has completed; from_disk is false when it was
+    // filled from the sector cache
+    DISKANN_DLLEXPORT void pipeline_complete(PipelinedQuery &q, void *buf, bool from_disk = true);
+    // node_coords is nullptr for the decoupled layout, where the node is scored by its PQ distance
+    DISKANN_DLLEXPORT void pipeline_expand(PipelinedQuery &q, uint32_t id, T *node_coords, uint64_t nnbrs,
+                                           uint32_t *node_nbrs);
+    // reaps the num_reads reads a failed search left in flight on ctx, so that its
+    // scratch can be reused; errors are dropped in favour of the one being thrown
+    DISKANN_DLLEXPORT void drain_aborted_reads(IOContext &ctx, uint64_t num_reads);
+
+    // range_search() state handed to beam_search()
+    struct RangeSearchState
+    {
+        double range;
+        uint64_t max_l_search;
+        uint64_t min_beam_width;
+        uint64_t l_search; // current list size; the number of results written at the end
+    };
+
+    // body of cached_beam_search; with a budget it may stop early, and returns true if it did.
+    // With a range state it grows the list in place while enough results fall in range. With
+    // a cursor it resumes from, and saves back, the cursor's state and skips returned nodes.
+    DISKANN_DLLEXPORT bool beam_search(const T *query, const uint64_t k_search, const uint64_t l_search,
+                                       uint64_t *res_ids, float *res_dists, const uint64_t beam_width,
+                                       const bool use_filter, const LabelT &filter_label, const uint32_t io_limit,
+                                       const bool use_reorder_data, QueryStats *stats, const SearchBudget *budget,
+                                       RangeSearchState *range = nullptr, SearchCursor *cursor = nullptr);
+
+    // sorts full_retset, optionally re-ranks with the full precision vectors and copies out k results;
+    // skip_rerank returns the search distances, when the deadline leaves no time for the rerank reads.
+    // The rerank reads go on rerank_ctx if given, else on data->ctx.
+    DISKANN_DLLEXPORT void finish_search(SSDThreadData<T> *data, const uint64_t k_search, uint64_t *indices,
+                                         float *distances, const float query_norm, const bool use_reorder_data,
+                                         QueryStats *stats, const bool skip_rerank = false,
+                                         IOContext *rerank_ctx = nullptr);
+    // replaces the distances of the best full_retset entries with distances to their
+    // full precision vectors, read from the reorder data (use_reorder_data) or the
+    // decoupled vector region. Each sector is read once and adjacent sectors are
+    // merged into one read; sectors prefetched during the search are not read again.
+    DISKANN_DLLEXPORT void rerank_full_precision(SSDThreadData<T> *data, const uint64_t k_search,
+                                                 const bool use_reorder_data, QueryStats *stats,
+                                                 IOContext *rerank_ctx = nullptr);
+    // submits reads for the vectors of the top-k candidates that are expanded and were
+    // already in the top-k on the previous hop, so rerank I/O overlaps the last hops
+    DISKANN_DLLEXPORT void prefetch_rerank_vectors(SSDThreadData<T> *data, const uint64_t k_search,
+                                                   const bool use_reorder_data, std::vector<uint32_t> &prev_topk,
+                                                   QueryStats *stats);
+    // blocking read of `read_reqs` while rerank prefetches may still be in flight on the
+    // same context; prefetches reaped on the way are accounted for
+    DISKANN_DLLEXPORT void read_around_prefetches(SSDThreadData<T> *data, std::vector<AlignedRead> &read_reqs);
+    DISKANN_DLLEXPORT void drain_rerank_prefetches(SSDThreadData<T> *data);
+    // first sector, and sector count, of the full precision vector of node_id
+    DISKANN_DLLEXPORT uint64_t get_rerank_sector(uint32_t node_id, const bool use_reorder_data);
+    DISKANN_DLLEXPORT uint64_t rerank_sectors_per_vec(const bool use_reorder_data);
+
+    // seeds retset and visited from the navigation graph; false if there is none
+    DISKANN_DLLEXPORT bool seed_from_nav_graph(SSDQueryScratch<T> *query_scratch, QueryStats *stats);
+
+    // original id -> id inside the index (differs only for locality layouts)
+    DISKANN_DLLEXPORT inline uint32_t to_disk_id(uint32_t id);
+
+    inline bool is_deleted(uint32_t disk_id) const
+    {
+        return _num_deleted.load(std::memory_order_relaxed) > 0 &&
+               ((_delete_bitmap[disk_id >> 6].load(std::memory_order_relaxed) >> (disk_id & 63)) & 1);
+    }
+    // l_search grown so that about l_search of the candidates are live
+    DISKANN_DLLEXPORT uint64_t deleted_overfetch_l(uint64_t l_search) const;
+    // sets the bits of a disk id and its dummy copies; false if it was set already
+    DISKANN_DLLEXPORT bool mark_deleted(uint32_t disk_id);
+
     // sector # on disk where node_id is present with in the graph part
     DISKANN_DLLEXPORT uint64_t get_node_sector(uint64_t node_id);
 
@@ -135,6 +471,15 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     // returns region of `node_buf` containing [COORD(T)]
     DISKANN_DLLEXPORT T *offset_to_node_coords(char *node_buf);
 
+    // sets nnbrs and returns the neighbour ids of the node at `node_buf`; compressed
+    // lists are decoded into `decode_buf`, which must hold _max_degree ids
+    DISKANN_DLLEXPORT uint32_t *get_node_nbrs(char *node_buf, uint32_t *decode_buf, uint64_t &nnbrs);
+
+    // decoupled layout only: sector # where the coords of node_id start, and
+    // their offset within `sector_buf`
+    DISKANN_DLLEXPORT uint64_t get_vector_sector(uint64_t node_id);
+    DISKANN_DLLEXPORT char *offset_to_vector(char *sector_buf, uint64_t node_id);
+
     // index info for multi-node sectors
     // nhood of node `i` is in sector: [i / nnodes_per_sector]
     // offset in sector: [(i % nnodes_per_sector) * max_node_len]
@@ -147,10 +492,21 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     // coords start at ofsset
     // #nbrs of node `i`: *(unsigned*) (offset + disk_bytes_per_point)
     // nbrs of node `i` : (unsigned*) (offset + disk_bytes_per_point + 1)
+    //
+    // decoupled layout: nodes are [NNBRS][NBR_ID(uint32_t)] only, and the
+    // coords live in a separate vector region starting at _vec_start_sector,
+    // packed _nvecs_per_vec_sector per sector (0 if a vector spans sectors)
+    //
+    // compressed adjacency: [NNBRS] is followed by the encoded ids
+    // (adjacency_codec.h) and _max_node_len fits the longest encoding
 
     uint64_t _max_node_len = 0;
     uint64_t _nnodes_per_sector = 0; // 0 for multi-sector nodes, >0 for multi-node sectors
     uint64_t _max_degree = 0;
+    bool _decoupled_layout = false;
+    bool _compressed_adjacency = false;
+    uint64_t _vec_start_sector = 0;
+    uint64_t _nvecs_per_vec_sector = 0;
 
     // Data used for searching with re-order vectors
     uint64_t _ndims_reorder_vecs = 0;
@@ -172,6 +528,16 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     uint64_t _disk_bytes_per_point = 0; // Number of bytes
 
     std::string _disk_index_file;
+
+    // locality layout (see create_disk_layout): disk id -> original id and its inverse;
+    // both empty when nodes are stored in original id order
+    std::vector<uint32_t> _id_map;
+    std::vector<uint32_t> _id_map_inv;
+
+    // one bit per disk id, see delete_points(); _delete_lock serializes the writers
+    std::unique_ptr<std::atomic<uint64_t>[]> _delete_bitmap;
+    std::atomic<uint64_t> _num_deleted{0};
+    std::mutex _delete_lock;
     std::vector<std::pair<uint32_t, uint32_t>> _node_visit_counter;
 
     // PQ data
@@ -204,19 +570,49 @@ template <typename T, typename LabelT = uint32_t> class PQFlashIndex
     // closest centroid as the starting point of search
     float *_centroid_data = nullptr;
 
-    // nhood_cache; the uint32_t in nhood_Cache are offsets into nhood_cache_buf
-    unsigned *_nhood_cache_buf = nullptr;
-    tsl::robin_map<uint32_t, std::pair<uint32_t, uint32_t *>> _nhood_cache;
-
-    // coord_cache; The T* in coord_cache are offsets into coord_cache_buf
-    T *_coord_cache_buf = nullptr;
-    tsl::robin_map<uint32_t, T *> _coord_cache;
+    // node cache: the current generation (never null, empty until a cache list is loaded)
+    // and the replaced ones, with the epoch they were replaced in, waiting to be freed
+    std::atomic<NodeCacheTable *> _node_cache;
+    std::atomic<uint64_t> _cache_epoch{1};
+    std::vector<std::pair<NodeCacheTable *, uint64_t>> _retired_caches;
+    std::mutex _cache_swap_lock;
+    std::vector<SSDThreadData<T> *> _all_thread_data; // every pin slot, for reclamation
+    std::atomic<uint64_t> _num_cache_loaded{0};
+    std::atomic<bool> _stop_cache_load{false};
+    std::atomic<uint32_t> _num_active_loaders{0};
+    std::vector<std::thread> _cache_loaders;
+
+    // see start_cache_refresh()
+    std::thread _cache_refresher;
+    std::mutex _refresh_lock;
+    std::condition_variable _refresh_cv;
+    std::atomic<bool> _stop_refresh{false};
+    std::atomic<uint64_t> _num_cache_refreshes{0};
+
+    CoResidentMode _co_resident_mode = CoResidentMode::NONE;
+    NodeCacheMode _node_cache_mode = NodeCacheMode::FULL;
+
+    // in-memory navigation graph over a sample of the points; see set_nav_graph_params()
+    std::unique_ptr<Index<T, uint32_t, uint32_t>> _nav_index;
+    std::vector<uint32_t> _nav_to_disk_id; // navigation graph id -> disk id
+    uint32_t _nav_num_seeds = defaults::NAV_GRAPH_NUM_SEEDS;
+    uint32_t _nav_search_l = defaults::NAV_GRAPH_SEARCH_LIST_SIZE;
+
+    // see set_adaptive_beam()
+    uint32_t _adaptive_min_beam_width = 0;
+    uint32_t _early_stop_hops = 0;
+
+    // dynamic sector cache; see set_sector_cache()
+    std::unique_ptr<SectorCache> _sector_cache;
+
+    // in-flight sector reads shared across queries; see set_read_dedup()
+    std::unique_ptr<ReadSingleFlight> _single_flight;
 
     // thread-specific scratch
     ConcurrentQueue<SSDThreadData<T> *> _thread_data;
     uint64_t _max_nthreads;
     bool _load_flag = false;
-    bool _count_visited_nodes = false;
+    std::atomic<bool> _count_visited_nodes{false};
     bool _reorder_data_exists = false;
     uint64_t _reoreder_data_offset = 0;
 
@@ -0,0 +1,73 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "tsl/robin_map.h"
+#include "windows_customizations.h"
+
+namespace diskann
+{
+// Process-wide table of disk blocks (the sectors read for one node) that some
+// query is currently reading, keyed by the block's first sector number. A
+// query that needs a block already in flight waits for that read instead of
+// issuing its own.
+//
+// Protocol: join() a block before reading it. A nullptr result makes the
+// caller the leader, which must read the block and then land() it, also when
+// the read fails. Any other result is a flight to wait() on. Leaders should
+// land their own blocks before waiting on anyone else's, so that two queries
+// waiting on each other's blocks cannot deadlock.
+//
+// Thread-safety: all methods may be called concurrently. The table is split
+// into independently locked stripes by block id.
+class ReadSingleFlight
+{
+  public:
+    struct Flight
+    {
+        std::mutex lock;
+        std::condition_variable landed_cv;
+        bool landed = false;
+        bool ok = false;
+        uint32_t num_waiters = 0;     // final once the flight has left the table
+        std::unique_ptr<char[]> data; // copy of the block, only made when there are waiters
+    };
+
+    DISKANN_DLLEXPORT ReadSingleFlight(uint64_t block_len, uint32_t num_stripes = 64);
+
+    // nullptr if the caller now leads the read of block_id, else the flight to wait on
+    DISKANN_DLLEXPORT std::shared_ptr<Flight> join(uint64_t block_id);
+
+    // leader: publishes the block just read into `src`, or a failed read if `src`
+    // is nullptr, and wakes the waiters
+    DISKANN_DLLEXPORT void land(uint64_t block_id, const char *src);
+
+    // copies the landed block into `dst`; false if the leader's read failed, in
+    // which case the caller has to read the block itself
+    DISKANN_DLLEXPORT bool wait(const std::shared_ptr<Flight> &flight, char *dst);
+
+    DISKANN_DLLEXPORT uint64_t block_len() const;
+    DISKANN_DLLEXPORT uint64_t num_deduped() const;
+
+  private:
+    struct Stripe
+    {
+        std::mutex lock;
+        tsl::robin_map<uint64_t, std::shared_ptr<Flight>> flights;
+    };
+
+    uint64_t _block_len;
+    std::vector<std::unique_ptr<Stripe>> _stripes;
+    std::atomic<uint64_t> _deduped{0};
+
+    Stripe &stripe_of(uint64_t block_id);
+};
+} // namespace diskann
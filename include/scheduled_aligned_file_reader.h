@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <memory>
+
+#include "aligned_file_reader.h"
+#include "io_scheduler.h"
+
+// Puts an IOScheduler in front of another reader. Each thread issues its reads in
+// the priority class it last set with set_thread_class() (class 0 by default).
+// read() waits for slots, splitting batches larger than the class may hold, and
+// frees them when the batch is done. submit_reqs() never waits; its reads are
+// charged to the class at submission and released as get_completions() reaps
+// them, so a thread should not change class while it has submitted reads in flight.
+// A thread with submitted reads in flight does not wait in read() either: its slots
+// are charged, since the reads it would wait on may be its own.
+// Contexts, open() and close() are those of the wrapped reader.
+class ScheduledAlignedFileReader : public AlignedFileReader
+{
+  private:
+    std::shared_ptr<AlignedFileReader> inner;
+    std::shared_ptr<diskann::IOScheduler> scheduler;
+
+  public:
+    ScheduledAlignedFileReader(std::shared_ptr<AlignedFileReader> inner,
+                               std::shared_ptr<diskann::IOScheduler> scheduler);
+
+    static void set_thread_class(uint32_t cls);
+    static uint32_t thread_class();
+
+    IOContext &get_ctx();
+    void register_thread();
+    void deregister_thread();
+    void deregister_all_threads();
+    void register_buffer(IOContext &ctx, void *buf, uint64_t len);
+
+    bool reads_striped_files() const
+    {
+        return inner->reads_striped_files();
+    }
+
+    void open(const std::string &fname);
+    void close();
+
+    void read(std::vector<AlignedRead> &read_reqs, IOContext &ctx, bool async = false);
+    void submit_reqs(std::vector<AlignedRead> &read_reqs, IOContext &ctx);
+    void get_completions(IOContext &ctx, uint64_t min_completions, std::vector<void *> &completed_bufs);
+
+    std::shared_ptr<diskann::IOScheduler> get_scheduler() const
+    {
+        return scheduler;
+    }
+};
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 
 #include "boost_dynamic_bitset_fwd.h"
@@ -157,6 +158,24 @@ template <typename T> class SSDQueryScratch
     tsl::robin_set<size_t> visited;
     NeighborPriorityQueue retset;
     std::vector<Neighbor> full_retset;
+    std::vector<Neighbor> retset_overflow; // candidates retset dropped during a range search
+
+    // co-resident node handling (PQFlashIndex::set_co_resident_mode)
+    tsl::robin_set<uint32_t> full_scored;       // ids already in full_retset
+    tsl::robin_set<uint32_t> expanded_in_place; // ids expanded from another node's sector
+
+    // ids in full_retset scored by their PQ distance because their node came from a
+    // graph-only node cache (PQFlashIndex::set_node_cache_mode); the rerank fixes them
+    tsl::robin_set<uint32_t> pq_scored;
+
+    std::vector<uint32_t> nbr_scratch; // decoded compressed neighbour list, MAX_GRAPH_DEGREE ids
+
+    // full-precision rerank reads. Sectors prefetched during the search take the
+    // front of rerank_scratch and are indexed by sector # in rerank_prefetched.
+    char *rerank_scratch = nullptr; // RERANK_SCRATCH_SECTORS * SECTOR_LEN
+    tsl::robin_map<uint64_t, char *> rerank_prefetched;
+    uint64_t rerank_prefetch_slots = 0; // sectors of rerank_scratch used by prefetches
+    uint64_t rerank_inflight = 0;       // prefetches submitted but not yet reaped
 
     SSDQueryScratch(size_t aligned_dim, size_t visited_reserve);
     ~SSDQueryScratch();
@@ -169,6 +188,9 @@ template <typename T> class SSDThreadData
   public:
     SSDQueryScratch<T> scratch;
     IOContext ctx;
+    // node cache epoch pinned by the query using this scratch, 0 if none; see
+    // PQFlashIndex::pin_node_cache()
+    std::atomic<uint64_t> cache_epoch{0};
 
     SSDThreadData(size_t aligned_dim, size_t visited_reserve);
     void clear();
@@ -0,0 +1,63 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "tsl/robin_map.h"
+#include "windows_customizations.h"
+
+namespace diskann
+{
+// Fixed-size cache of disk blocks (one block = the sectors read for one node,
+// i.e. a single 4KB sector unless nodes span several sectors), keyed by the
+// block's first sector number. Blocks are admitted after they are read from
+// disk and evicted with the CLOCK (second chance) policy once the memory
+// budget is used up.
+//
+// Thread-safety: all methods may be called concurrently. The cache is split
+// into independently locked stripes by block id; lookups copy the block out
+// under the stripe lock so callers never hold references into the cache.
+class SectorCache
+{
+  public:
+    DISKANN_DLLEXPORT SectorCache(uint64_t capacity_bytes, uint64_t block_len, uint32_t num_stripes = 64);
+    DISKANN_DLLEXPORT ~SectorCache();
+
+    // copies the block into `dst` and returns true on a hit
+    DISKANN_DLLEXPORT bool lookup(uint64_t block_id, char *dst);
+
+    // admits a block that was just read from disk; no-op if already present
+    DISKANN_DLLEXPORT void insert(uint64_t block_id, const char *src);
+
+    DISKANN_DLLEXPORT uint64_t capacity_blocks() const;
+    DISKANN_DLLEXPORT uint64_t block_len() const;
+    DISKANN_DLLEXPORT uint64_t num_hits() const;
+    DISKANN_DLLEXPORT uint64_t num_misses() const;
+
+  private:
+    struct Stripe
+    {
+        std::mutex lock;
+        tsl::robin_map<uint64_t, uint32_t> slot_of; // block id -> slot
+        std::vector<uint64_t> block_ids;            // slot -> block id
+        std::vector<uint8_t> referenced;            // CLOCK reference bit per slot
+        uint32_t num_used = 0;
+        uint32_t hand = 0;
+        char *buf = nullptr; // slots_per_stripe * block_len bytes
+    };
+
+    uint64_t _block_len;
+    uint32_t _slots_per_stripe;
+    std::vector<std::unique_ptr<Stripe>> _stripes;
+    std::atomic<uint64_t> _hits{0};
+    std::atomic<uint64_t> _misses{0};
+
+    Stripe &stripe_of(uint64_t block_id);
+};
+} // namespace diskann
@@ -0,0 +1,146 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "aligned_file_reader.h"
+#include "defaults.h"
+#include "index.h"
+#include "pq_flash_index.h"
+#include "windows_customizations.h"
+
+namespace diskann
+{
+// FreshDiskANN-style updates over a read-only SSD index. Inserts go to an in-memory
+// Index, tagged with the ids they will keep on disk, which continue after those of
+// the SSD index. Deletes set a bit that search results are filtered by, and those of
+// SSD points are also marked with PQFlashIndex::mark_points_deleted(), so that the SSD
+// search makes up for them with a longer list. A search queries the SSD index and the
+// in-memory indexes and merges their results.
+//
+// merge() folds the updates into a new SSD index at another prefix and switches to
+// it. It freezes the in-memory index (still searched) and starts a new one for the
+// inserts that arrive meanwhile, links each new point to the SSD graph with a beam
+// search and a prune, then streams the old graph sector by sector into the new file:
+// deleted nodes lose their edges, lists that pointed to them get the deleted nodes'
+// neighbours instead, reverse edges to the new points are added (pruned back to the
+// degree where needed) and the new nodes are appended. Distances between neighbours
+// come from the PQ codes. Deleted ids stay in the new index as unreachable nodes, so
+// ids never change; they are saved to <prefix>_disk.index_deleted_ids.bin.
+//
+// Only L2 indexes in the default layout are supported: no decoupled or compressed
+// layouts, locality map, labels, disk PQ, reorder data, OPQ or striping.
+template <typename T> class StreamingDiskIndex
+{
+  public:
+    // reader_factory makes a fresh reader for every SSD index loaded. max_mem_points
+    // is the capacity of each in-memory index; l and alpha are used by the inserts
+    // into it and by the merge, which searches the SSD index with beam_width.
+    DISKANN_DLLEXPORT StreamingDiskIndex(std::function<std::shared_ptr<AlignedFileReader>()> reader_factory,
+                                         const std::string &index_prefix, uint32_t num_threads,
+                                         uint64_t max_mem_points, uint32_t l = defaults::BUILD_LIST_SIZE,
+                                         float alpha = 1.2f, uint32_t beam_width = 4);
+    DISKANN_DLLEXPORT ~StreamingDiskIndex();
+
+    // adds a point and returns its id
+    DISKANN_DLLEXPORT uint32_t insert(const T *point);
+    // false if the id is unknown or already deleted
+    DISKANN_DLLEXPORT bool remove(uint32_t id);
+    // saves the deletes of SSD points made since the last merge or flush to
+    // <prefix>_disk.index_deleted_ids.bin; also done by the destructor
+    DISKANN_DLLEXPORT void flush_deletes();
+
+    // returns the number of results written to ids and dists (at most k)
+    DISKANN_DLLEXPORT uint64_t search(const T *query, uint64_t k, uint64_t l_search, uint64_t beam_width,
+                                      uint64_t *ids, float *dists);
+
+    // Writes the SSD index with the updates made so far folded in to out_prefix, which
+    // must differ from the current prefix, and switches to it. Inserts, deletes and
+    // searches may go on meanwhile. Returns false if there was nothing to merge.
+    DISKANN_DLLEXPORT bool merge(const std::string &out_prefix);
+    // merge() on a background thread; wait_for_merge() joins it and rethrows its error.
+    // start_merge() throws while a merge runs, and drops the result of a finished one
+    // that was not waited for.
+    DISKANN_DLLEXPORT void start_merge(const std::string &out_prefix);
+    DISKANN_DLLEXPORT bool wait_for_merge();
+
+    DISKANN_DLLEXPORT std::string index_prefix();
+    // points in the SSD index, deleted ones included
+    DISKANN_DLLEXPORT uint64_t num_disk_points();
+    // points held by the in-memory indexes
+    DISKANN_DLLEXPORT uint64_t num_mem_points();
+    DISKANN_DLLEXPORT uint64_t num_deleted();
+
+  private:
+    using MemIndex = Index<T, uint32_t, uint32_t>;
+
+    struct DiskIndex
+    {
+        // declared first so that the index, which refers to it, goes first
+        std::shared_ptr<AlignedFileReader> reader;
+        std::unique_ptr<PQFlashIndex<T>> index;
+        std::string prefix;
+        uint64_t num_points = 0;
+    };
+
+    std::shared_ptr<DiskIndex> load_disk_index(const std::string &prefix);
+    std::shared_ptr<MemIndex> make_mem_index();
+    // writes the merged index for the points below num_new + the disk index's size
+    void write_merged_index(const DiskIndex &disk, MemIndex &frozen, uint64_t num_new,
+                            std::vector<bool> &deleted, const std::string &out_prefix);
+    // marks the deleted ids it holds in a newly loaded SSD index, which also saves them
+    void apply_deletes(DiskIndex &disk);
+
+    std::function<std::shared_ptr<AlignedFileReader>()> _reader_factory;
+    uint32_t _num_threads;
+    uint64_t _max_mem_points;
+    uint32_t _l;
+    float _alpha;
+    uint32_t _beam_width;
+    uint64_t _dim = 0;
+    uint32_t _max_degree = 0;
+    std::vector<T> _start_point; // frozen point of the in-memory indexes: the SSD index's medoid
+
+    // guards the indexes below; inserts hold it shared so a merge can freeze the active one
+    std::shared_timed_mutex _state_lock;
+    std::shared_ptr<DiskIndex> _disk;
+    std::shared_ptr<MemIndex> _frozen; // set while a merge runs, or after one failed
+    uint64_t _frozen_end = 0;          // ids [disk size, _frozen_end) are in _frozen
+    std::shared_ptr<MemIndex> _active;
+    std::atomic<uint64_t> _next_id;
+
+    std::shared_timed_mutex _delete_lock;
+    std::vector<bool> _deleted;
+    uint64_t _num_deleted = 0;
+    std::atomic<bool> _deletes_unsaved{false}; // SSD index marks not yet in its deleted-ids file
+
+    std::mutex _merge_lock;
+    std::thread _merge_thread;
+    std::atomic<bool> _merge_running{false}; // cleared by _merge_thread as it ends
+    bool _merge_result = false;
+    std::exception_ptr _merge_error;
+};
+
+// Offline compaction of an SSD index with deleted points (see PQFlashIndex::delete_points()
+// and StreamingDiskIndex), once they make up min_deleted_fraction of it. Writes the index
+// without them to out_prefix: live points keep their order under new dense ids, lists that
+// pointed to deleted nodes get those nodes' live neighbours instead, pruned back to the
+// degree with alpha, and <out_prefix>_disk.index_old_ids.bin maps each new id to its id
+// in the input. Returns false, writing nothing, below the threshold. Takes the layouts
+// StreamingDiskIndex takes.
+template <typename T>
+DISKANN_DLLEXPORT bool compact_disk_index(const std::string &index_prefix, const std::string &out_prefix,
+                                          uint32_t num_threads,
+                                          float min_deleted_fraction = defaults::COMPACTION_MIN_DELETED_FRACTION,
+                                          float alpha = 1.2f);
+} // namespace diskann
@@ -0,0 +1,104 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+#ifndef _WINDOWS
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "aligned_file_reader.h"
+
+// per-thread bookkeeping for reads split across stripes; IOContext::striped
+// points to one of these
+struct StripedIOState
+{
+    struct Piece
+    {
+        void *req_buf; // buf of the AlignedRead this piece belongs to
+        uint32_t device;
+        uint64_t len;
+        std::chrono::steady_clock::time_point issued;
+    };
+    std::vector<Piece> pieces;
+    std::vector<uint32_t> free_pieces;
+    // pieces still in flight, per request buf
+    tsl::robin_map<void *, uint32_t> remaining;
+    // submit_reqs() requests that a blocking read() reaped; get_completions() reports them first
+    std::vector<void *> requeued;
+};
+
+// Reads a disk index that stripe_disk_index() has spread across several files,
+// typically one per device. Stripe units of `stripe_sectors` sectors go
+// round-robin to the files, so unit u lives in file u % N at unit offset u / N.
+// The first file is the _disk.index itself (it holds sector 0, and with it the
+// header); the others are listed in `<disk index>_stripes.txt`. Without that
+// file the reader behaves like LinuxAlignedFileReader on a single file.
+//
+// Every AlignedRead is split at stripe unit boundaries and each piece goes to
+// its device's file descriptor; all pieces share the thread's aio context.
+// Completion latency and volume are tracked per device.
+class StripedAlignedFileReader : public AlignedFileReader
+{
+  public:
+    struct DeviceStats
+    {
+        std::string path;
+        uint64_t n_reads = 0;
+        uint64_t n_bytes = 0;
+        uint64_t total_us = 0; // summed submit-to-reap latency of all reads
+    };
+
+  private:
+    std::vector<std::string> stripe_paths;
+    std::vector<FileHandle> file_descs;
+    uint64_t stripe_unit = 0; // bytes
+    IOContext bad_ctx;
+
+    std::unique_ptr<std::atomic<uint64_t>[]> dev_reads, dev_bytes, dev_us;
+
+    // reaps until at least min_completions whole requests have completed
+    void reap(IOContext &ctx, uint64_t min_completions, std::vector<void *> &completed_bufs);
+
+  public:
+    StripedAlignedFileReader();
+    ~StripedAlignedFileReader();
+
+    IOContext &get_ctx();
+
+    // register thread-id for a context
+    void register_thread();
+
+    // de-register thread-id for a context
+    void deregister_thread();
+    void deregister_all_threads();
+
+    // Open & close ops
+    // Blocking calls
+    void open(const std::string &fname);
+    void close();
+
+    // process batch of aligned requests in parallel
+    // NOTE :: blocking call; requests of earlier submit_reqs() calls that
+    // complete meanwhile are kept for get_completions()
+    void read(std::vector<AlignedRead> &read_reqs, IOContext &ctx, bool async = false);
+
+    // non-blocking submission and reaping; a request is reported once all of
+    // its pieces have completed
+    void submit_reqs(std::vector<AlignedRead> &read_reqs, IOContext &ctx);
+    void get_completions(IOContext &ctx, uint64_t min_completions, std::vector<void *> &completed_bufs);
+
+    bool reads_striped_files() const
+    {
+        return true;
+    }
+
+    uint64_t num_devices() const
+    {
+        return file_descs.size();
+    }
+    std::vector<DeviceStats> get_device_stats() const;
+};
+
+#endif
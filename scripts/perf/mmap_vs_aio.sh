@@ -0,0 +1,41 @@
+#!/bin/bash
+# Compares the aio and mmap disk readers of search_disk_index on an existing
+# disk index. Both readers return the same bytes, so at a given L the recall is
+# identical and the csv rows can be compared directly for QPS and latency.
+#
+# usage: mmap_vs_aio.sh <data_type> <dist_fn> <index_prefix> <query_file> <gt_file> [L values...]
+# env:   BASE_PATH (default build/apps), T (threads, default 16), W (beamwidth, default 4), K (default 10)
+
+set -e
+
+if [ $# -lt 5 ]; then
+  echo "usage: $0 <data_type> <dist_fn> <index_prefix> <query_file> <gt_file> [L values...]"
+  exit 1
+fi
+
+DATA_TYPE=$1
+DIST_FN=$2
+INDEX_PREFIX=$3
+QUERY_FILE=$4
+GT_FILE=$5
+shift 5
+L_VALUES=${@:-"10 20 50 100"}
+
+BASE_PATH=${BASE_PATH:-build/apps}
+T=${T:-16}
+W=${W:-4}
+K=${K:-10}
+OUT_DIR=${OUT_DIR:-mmap_vs_aio}
+mkdir -p $OUT_DIR
+
+for backend in aio mmap mmap_populate; do
+  # run twice and keep the second pass. aio opens the index with O_DIRECT and
+  # always reads from the device; for mmap the first pass warms the page cache
+  for pass in warm timed; do
+    $BASE_PATH/search_disk_index --data_type $DATA_TYPE --dist_fn $DIST_FN --index_path_prefix $INDEX_PREFIX \
+      --query_file $QUERY_FILE --gt_file $GT_FILE -K $K -L $L_VALUES -T $T -W $W --io_backend $backend \
+      --result_path $OUT_DIR/${backend}_res --csv_file $OUT_DIR/${backend}_${pass}.csv > $OUT_DIR/${backend}_${pass}.log
+  done
+  echo "== $backend"
+  cat $OUT_DIR/${backend}_timed.csv
+done
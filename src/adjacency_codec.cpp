@@ -0,0 +1,123 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <cstring>
+#include <immintrin.h>
+
+#include "adjacency_codec.h"
+
+namespace
+{
+// per control byte: pshufb mask spreading the group's value bytes into 4 uint32
+// lanes, and the number of value bytes in the group
+struct GroupVarintTables
+{
+    alignas(16) uint8_t shuffle[256][16];
+    uint8_t data_len[256];
+
+    GroupVarintTables()
+    {
+        for (uint32_t ctrl = 0; ctrl < 256; ctrl++)
+        {
+            uint8_t src = 0;
+            for (uint32_t lane = 0; lane < 4; lane++)
+            {
+                uint32_t len = ((ctrl >> (2 * lane)) & 0x3) + 1;
+                for (uint32_t b = 0; b < 4; b++)
+                    shuffle[ctrl][4 * lane + b] = b < len ? src++ : 0x80; // 0x80 zeroes the byte
+            }
+            data_len[ctrl] = src;
+        }
+    }
+};
+
+const GroupVarintTables tables;
+
+inline uint32_t byte_len(uint32_t v)
+{
+    return v < (1u << 8) ? 1 : v < (1u << 16) ? 2 : v < (1u << 24) ? 3 : 4;
+}
+
+inline uint32_t read_value(const uint8_t *p, uint32_t len)
+{
+    uint32_t v = 0;
+    for (uint32_t b = 0; b < len; b++)
+        v |= (uint32_t)p[b] << (8 * b);
+    return v;
+}
+
+// decodes the `count` (<= 4) values of the group whose control byte is `ctrl`
+inline void decode_group_scalar(uint8_t ctrl, const uint8_t *p, uint64_t count, uint32_t &prev, uint32_t *out)
+{
+    for (uint64_t lane = 0; lane < count; lane++)
+    {
+        uint32_t len = ((ctrl >> (2 * lane)) & 0x3) + 1;
+        prev += read_value(p, len);
+        out[lane] = prev;
+        p += len;
+    }
+}
+} // namespace
+
+namespace diskann
+{
+uint64_t adjacency_max_encoded_len(uint64_t n)
+{
+    return (n + 3) / 4 + n * sizeof(uint32_t);
+}
+
+uint64_t encode_adjacency(uint32_t *ids, uint64_t n, uint8_t *out)
+{
+    std::sort(ids, ids + n);
+    uint8_t *p = out;
+    uint32_t prev = 0;
+    for (uint64_t i = 0; i < n; i += 4)
+    {
+        uint8_t *ctrl = p++;
+        *ctrl = 0;
+        for (uint64_t lane = 0; lane < 4 && i + lane < n; lane++)
+        {
+            uint32_t delta = ids[i + lane] - prev;
+            prev = ids[i + lane];
+            uint32_t len = byte_len(delta);
+            *ctrl |= (uint8_t)((len - 1) << (2 * lane));
+            for (uint32_t b = 0; b < len; b++)
+                *p++ = (uint8_t)(delta >> (8 * b));
+        }
+    }
+    return (uint64_t)(p - out);
+}
+
+void decode_adjacency(const uint8_t *in, const uint8_t *in_end, uint64_t n, uint32_t *out)
+{
+    const uint8_t *p = in;
+    uint32_t prev = 0;
+    uint64_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        uint8_t ctrl = *p++;
+        if (p + 16 <= in_end)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i *)p);
+            v = _mm_shuffle_epi8(v, _mm_load_si128((const __m128i *)tables.shuffle[ctrl]));
+            // prefix sum of the 4 deltas, offset by the last id of the previous group
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+            v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+            v = _mm_add_epi32(v, _mm_set1_epi32((int)prev));
+            _mm_storeu_si128((__m128i *)(out + i), v);
+            prev = out[i + 3];
+        }
+        else
+        {
+            decode_group_scalar(ctrl, p, 4, prev, out + i);
+        }
+        p += tables.data_len[ctrl];
+    }
+    if (i < n)
+    {
+        uint8_t ctrl = *p++;
+        decode_group_scalar(ctrl, p, n - i, prev, out + i);
+    }
+}
+} // namespace diskann
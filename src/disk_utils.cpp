@@ -9,6 +9,7 @@
 
 #include "logger.h"
 #include "disk_utils.h"
+#include "adjacency_codec.h"
 #include "cached_io.h"
 #include "index.h"
 #include "mkl.h"
@@ -824,9 +825,161 @@ uint32_t optimize_beamwidth(std::unique_ptr<diskann::PQFlashIndex<T, LabelT>> &p
     return best_bw;
 }
 
+std::vector<uint32_t> compute_locality_layout(const std::vector<std::vector<uint32_t>> &graph, const uint32_t start,
+                                              const uint64_t nnodes_per_sector)
+{
+    const uint64_t npts = graph.size();
+    std::vector<uint32_t> new_to_old;
+    new_to_old.reserve(npts);
+    std::vector<bool> placed(npts, false), enqueued(npts, false);
+    std::queue<uint32_t> bfs_queue;
+    uint64_t sector_fill = 0; // nodes already in the sector being filled
+    uint64_t next_root = 0;
+
+    auto place = [&](uint32_t id) {
+        placed[id] = true;
+        new_to_old.push_back(id);
+        sector_fill = (sector_fill + 1) % nnodes_per_sector;
+    };
+
+    if (npts > 0)
+    {
+        bfs_queue.push(start);
+        enqueued[start] = true;
+    }
+    while (new_to_old.size() < npts)
+    {
+        if (bfs_queue.empty())
+        {
+            // next connected component
+            while (enqueued[next_root])
+                next_root++;
+            bfs_queue.push((uint32_t)next_root);
+            enqueued[next_root] = true;
+        }
+        uint32_t cur = bfs_queue.front();
+        bfs_queue.pop();
+        for (auto nbr : graph[cur])
+        {
+            if (!enqueued[nbr])
+            {
+                enqueued[nbr] = true;
+                bfs_queue.push(nbr);
+            }
+        }
+        if (placed[cur])
+            continue;
+
+        // start a node, then fill the rest of its sector with its unplaced neighbours
+        place(cur);
+        for (auto nbr : graph[cur])
+        {
+            if (sector_fill == 0)
+                break;
+            if (!placed[nbr])
+                place(nbr);
+        }
+    }
+    return new_to_old;
+}
+
+void stripe_disk_index(const std::string &disk_index_file, const std::vector<std::string> &extra_stripe_files,
+                       const uint64_t stripe_sectors)
+{
+    if (stripe_sectors == 0)
+        throw diskann::ANNException("stripe_sectors must be positive", -1, __FUNCSIG__, __FILE__, __LINE__);
+    // striping again would deal out the first stripe alone and lose track of the others
+    const std::string manifest_file = disk_index_file + "_stripes.txt";
+    if (file_exists(manifest_file))
+        throw diskann::ANNException(disk_index_file + " is already striped, see " + manifest_file, -1, __FUNCSIG__,
+                                    __FILE__, __LINE__);
+
+    std::vector<std::string> out_files;
+    out_files.push_back(disk_index_file + ".stripe_tmp");
+    out_files.insert(out_files.end(), extra_stripe_files.begin(), extra_stripe_files.end());
+    const uint64_t n_stripes = out_files.size();
+    const uint64_t unit_len = stripe_sectors * defaults::SECTOR_LEN;
+
+    std::ifstream in(disk_index_file, std::ios::binary);
+    if (!in.is_open())
+        throw diskann::ANNException("Could not open " + disk_index_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    in.seekg(0, std::ios::end);
+    uint64_t file_len = (uint64_t)in.tellg();
+    in.seekg(0, std::ios::beg);
+
+    std::vector<std::ofstream> outs(n_stripes);
+    for (uint64_t d = 0; d < n_stripes; d++)
+    {
+        outs[d].open(out_files[d], std::ios::binary | std::ios::trunc);
+        if (!outs[d].is_open())
+            throw diskann::ANNException("Could not open " + out_files[d], -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    // units are read in order and each goes to the end of its stripe file
+    std::unique_ptr<char[]> unit(new char[unit_len]);
+    uint64_t n_units = DIV_ROUND_UP(file_len, unit_len);
+    for (uint64_t u = 0; u < n_units; u++)
+    {
+        uint64_t len = std::min(unit_len, file_len - u * unit_len);
+        in.read(unit.get(), len);
+        outs[u % n_stripes].write(unit.get(), len);
+    }
+    in.close();
+    for (auto &out : outs)
+        out.close();
+
+    for (uint64_t d = 0; d < n_stripes; d++)
+    {
+        if (!outs[d])
+            throw diskann::ANNException("Could not write " + out_files[d], -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+#ifdef _WINDOWS
+    // rename() does not replace an existing file here
+    if (std::remove(disk_index_file.c_str()) != 0)
+        throw diskann::ANNException("Could not remove " + disk_index_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+#endif
+    if (std::rename(out_files[0].c_str(), disk_index_file.c_str()) != 0)
+        throw diskann::ANNException("Could not rename " + out_files[0] + " to " + disk_index_file, -1, __FUNCSIG__,
+                                    __FILE__, __LINE__);
+
+    std::ofstream manifest(manifest_file);
+    manifest << stripe_sectors << std::endl;
+    for (auto &f : extra_stripe_files)
+        manifest << f << std::endl;
+    manifest.close();
+    if (!manifest)
+        throw diskann::ANNException("Could not write " + manifest_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    diskann::cout << "Striped " << disk_index_file << " (" << file_len << " bytes) over " << n_stripes
+                  << " files in units of " << stripe_sectors << " sector(s)" << std::endl;
+}
+
+template <typename T>
+void build_nav_graph(const std::string &sample_prefix, const std::string &nav_index_file, const uint32_t num_threads)
+{
+    std::string sample_data_file = sample_prefix + "_data.bin";
+    uint64_t sample_num, sample_dim;
+    get_bin_metadata(sample_data_file, sample_num, sample_dim);
+    diskann::cout << "Building navigation graph over " << sample_num << " sample points" << std::endl;
+
+    diskann::IndexWriteParameters paras =
+        diskann::IndexWriteParametersBuilder(defaults::NAV_GRAPH_BUILD_LIST_SIZE, defaults::NAV_GRAPH_MAX_DEGREE)
+            .with_saturate_graph(false)
+            .with_num_threads(num_threads)
+            .build();
+    // same space as the disk index graph, which is always built with L2
+    diskann::Index<T> nav_index(diskann::Metric::L2, sample_dim, sample_num,
+                                std::make_shared<diskann::IndexWriteParameters>(paras), nullptr,
+                                paras.num_frozen_points, false, false, false, false, 0, false);
+    nav_index.build(sample_data_file.c_str(), sample_num, paras);
+    nav_index.save(nav_index_file.c_str());
+    copy_file(sample_prefix + "_ids.bin", nav_index_file + "_ids.bin");
+}
+
 template <typename T>
 void create_disk_layout(const std::string base_file, const std::string mem_index_file, const std::string output_file,
-                        const std::string reorder_data_file)
+                        const std::string reorder_data_file, const bool locality_layout,
+                        const bool decoupled_layout, const bool compress_adjacency)
 {
     uint32_t npts, ndims;
 
@@ -848,6 +1001,10 @@ void create_disk_layout(const std::string base_file, const std::string mem_index
     uint32_t npts_reorder_file = 0, ndims_reorder_file = 0;
     if (reorder_data_file != std::string(""))
     {
+        if (decoupled_layout)
+            throw ANNException("Reorder data cannot be appended to a decoupled disk layout, which already keeps "
+                               "full vectors in a separate region",
+                               -1, __FUNCSIG__, __FILE__, __LINE__);
         append_reorder_data = true;
         size_t reorder_data_file_size = get_file_size(reorder_data_file);
         reorder_data_reader.exceptions(std::ofstream::failbit | std::ofstream::badbit);
@@ -901,9 +1058,105 @@ void create_disk_layout(const std::string base_file, const std::string mem_index
     medoid = (uint64_t)medoid_u32;
     if (vamana_frozen_num == 1)
         vamana_frozen_loc = medoid;
-    max_node_len = (((uint64_t)width_u32 + 1) * sizeof(uint32_t)) + (ndims_64 * sizeof(T));
+    // decoupled_layout keeps coords out of the node: graph sectors hold [nnbrs][nbrs]
+    // only and the vectors follow them in their own region
+    uint64_t vec_len = ndims_64 * sizeof(T);
+    uint64_t node_coords_len = decoupled_layout ? 0 : vec_len;
+    max_node_len = (((uint64_t)width_u32 + 1) * sizeof(uint32_t)) + node_coords_len;
     nnodes_per_sector = defaults::SECTOR_LEN / max_node_len; // 0 if max_node_len > SECTOR_LEN
 
+    // with locality_layout, node p on disk is original node new_to_old[p]; neighbour ids,
+    // medoid and frozen point are written as disk ids. Both it and compress_adjacency need
+    // the graph in memory.
+    bool hold_graph = locality_layout || compress_adjacency;
+    std::vector<std::vector<uint32_t>> graph;
+    std::vector<uint32_t> new_to_old, old_to_new;
+    std::ifstream base_random_reader;
+    auto old_id_of = [&](uint64_t disk_id) { return locality_layout ? new_to_old[disk_id] : (uint32_t)disk_id; };
+    auto disk_id_of = [&](uint32_t old_id) { return locality_layout ? old_to_new[old_id] : old_id; };
+
+    // compressed lists vary in length, so the node slot is sized for the longest one
+    std::vector<uint32_t> nbrs_scratch(width_u32);
+    std::vector<uint8_t> encoded_scratch(adjacency_max_encoded_len(width_u32));
+    auto max_encoded_len = [&]() {
+        uint64_t max_len = 0;
+        for (uint64_t disk_id = 0; disk_id < npts_64; disk_id++)
+        {
+            const std::vector<uint32_t> &nbrs = graph[old_id_of(disk_id)];
+            for (size_t i = 0; i < nbrs.size(); i++)
+                nbrs_scratch[i] = disk_id_of(nbrs[i]);
+            max_len = (std::max)(max_len, encode_adjacency(nbrs_scratch.data(), nbrs.size(), encoded_scratch.data()));
+        }
+        return max_len;
+    };
+
+    if (hold_graph)
+    {
+        graph.resize(npts_64);
+        for (uint64_t i = 0; i < npts_64; i++)
+        {
+            uint32_t k;
+            vamana_reader.read((char *)&k, sizeof(uint32_t));
+            graph[i].resize(k);
+            vamana_reader.read((char *)graph[i].data(), k * sizeof(uint32_t));
+            if (k > width_u32)
+                graph[i].resize(width_u32);
+        }
+    }
+    if (compress_adjacency)
+    {
+        // first estimate from the original ids; the locality order changes the deltas
+        max_node_len = node_coords_len + sizeof(uint32_t) + max_encoded_len();
+        nnodes_per_sector = defaults::SECTOR_LEN / max_node_len;
+    }
+
+    if (locality_layout)
+    {
+        // With compressed lists the node length depends on the order, so the plan is redone
+        // with fewer nodes per sector until its nodes fit that many to a sector. The count
+        // only goes down, so this ends; the sectors then hold exactly the planned groups.
+        while (true)
+        {
+            const uint64_t planned_per_sector = (std::max)(nnodes_per_sector, (uint64_t)1);
+            new_to_old = compute_locality_layout(graph, medoid_u32, planned_per_sector);
+            old_to_new.resize(npts_64);
+            for (uint64_t i = 0; i < npts_64; i++)
+                old_to_new[new_to_old[i]] = (uint32_t)i;
+            if (!compress_adjacency)
+                break;
+            max_node_len = node_coords_len + sizeof(uint32_t) + max_encoded_len();
+            uint64_t fits_per_sector = defaults::SECTOR_LEN / max_node_len;
+            if (fits_per_sector > 0 && fits_per_sector < planned_per_sector)
+            {
+                nnodes_per_sector = fits_per_sector;
+                continue;
+            }
+            nnodes_per_sector = (std::min)(fits_per_sector, planned_per_sector);
+            break;
+        }
+        medoid = old_to_new[medoid];
+        if (vamana_frozen_num == 1)
+            vamana_frozen_loc = medoid;
+        base_random_reader.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        base_random_reader.open(base_file, std::ios::binary);
+        diskann::save_bin<uint32_t>(output_file + "_locality_map.bin", new_to_old.data(), npts_64, 1);
+        diskann::cout << "Locality layout computed, id map written to " << output_file + "_locality_map.bin"
+                      << std::endl;
+    }
+    else
+    {
+        // a stale map from an earlier build would scramble this layout
+        std::remove((output_file + "_locality_map.bin").c_str());
+    }
+    // the layout is written as one file; a stripe manifest from an earlier build no longer applies
+    std::remove((output_file + "_stripes.txt").c_str());
+    if (compress_adjacency)
+    {
+        diskann::cout << "Compressed adjacency lists: node length " << max_node_len << "B vs "
+                      << node_coords_len + ((uint64_t)width_u32 + 1) * sizeof(uint32_t) << "B uncompressed"
+                      << std::endl;
+    }
+
     diskann::cout << "medoid: " << medoid << "B" << std::endl;
     diskann::cout << "max_node_len: " << max_node_len << "B" << std::endl;
     diskann::cout << "nnodes_per_sector: " << nnodes_per_sector << "B" << std::endl;
@@ -912,21 +1165,81 @@ void create_disk_layout(const std::string base_file, const std::string mem_index
     std::unique_ptr<char[]> sector_buf = std::make_unique<char[]>(defaults::SECTOR_LEN);
     std::unique_ptr<char[]> multisector_buf = std::make_unique<char[]>(ROUND_UP(max_node_len, defaults::SECTOR_LEN));
     std::unique_ptr<char[]> node_buf = std::make_unique<char[]>(max_node_len);
-    uint32_t &nnbrs = *(uint32_t *)(node_buf.get() + ndims_64 * sizeof(T));
-    uint32_t *nhood_buf = (uint32_t *)(node_buf.get() + (ndims_64 * sizeof(T)) + sizeof(uint32_t));
+
+    // coords of the node at disk position `disk_id`; without a permutation the base
+    // file is consumed in order
+    auto read_coords = [&](uint64_t disk_id, char *buf) {
+        if (!locality_layout)
+        {
+            base_reader.read(buf, vec_len);
+            return;
+        }
+        base_random_reader.seekg(2 * sizeof(uint32_t) + (uint64_t)new_to_old[disk_id] * vec_len);
+        base_random_reader.read(buf, vec_len);
+    };
+
+    // fills `buf` with [coords][nnbrs][nbrs] (no coords if decoupled_layout, nbrs
+    // encoded if compress_adjacency) of the next node in disk order
+    uint64_t next_disk_id = 0;
+    auto fill_node = [&](char *buf) {
+        memset(buf, 0, max_node_len);
+        uint32_t nnbrs;
+        uint32_t *nhood_buf = (uint32_t *)(buf + node_coords_len + sizeof(uint32_t));
+        if (!hold_graph)
+        {
+            // read cur node's nnbrs
+            vamana_reader.read((char *)&nnbrs, sizeof(uint32_t));
+
+            // sanity checks on nnbrs
+            assert(nnbrs > 0);
+            assert(nnbrs <= width_u32);
+
+            // read node's nhood
+            vamana_reader.read((char *)nhood_buf, (std::min)(nnbrs, width_u32) * sizeof(uint32_t));
+            if (nnbrs > width_u32)
+            {
+                vamana_reader.seekg((nnbrs - width_u32) * sizeof(uint32_t), vamana_reader.cur);
+            }
+            nnbrs = (std::min)(nnbrs, width_u32);
+        }
+        else
+        {
+            uint32_t old_id = old_id_of(next_disk_id);
+            nnbrs = (uint32_t)graph[old_id].size();
+            for (uint32_t i = 0; i < nnbrs; i++)
+                nbrs_scratch[i] = disk_id_of(graph[old_id][i]);
+            if (compress_adjacency)
+                encode_adjacency(nbrs_scratch.data(), nnbrs, (uint8_t *)nhood_buf);
+            else
+                memcpy(nhood_buf, nbrs_scratch.data(), nnbrs * sizeof(uint32_t));
+        }
+        // coords of node first
+        if (!decoupled_layout)
+            read_coords(next_disk_id, buf);
+        *(uint32_t *)(buf + node_coords_len) = nnbrs;
+        next_disk_id++;
+    };
 
     // number of sectors (1 for meta data)
     uint64_t n_sectors = nnodes_per_sector > 0 ? ROUND_UP(npts_64, nnodes_per_sector) / nnodes_per_sector
                                                : npts_64 * DIV_ROUND_UP(max_node_len, defaults::SECTOR_LEN);
     uint64_t n_reorder_sectors = 0;
     uint64_t n_data_nodes_per_sector = 0;
+    uint64_t n_vec_sectors = 0;
+    uint64_t nvecs_per_vec_sector = defaults::SECTOR_LEN / vec_len; // 0 if a vector spans sectors
+    uint64_t nsectors_per_vec = DIV_ROUND_UP(vec_len, defaults::SECTOR_LEN);
+    if (decoupled_layout)
+    {
+        n_vec_sectors = nvecs_per_vec_sector > 0 ? DIV_ROUND_UP(npts_64, nvecs_per_vec_sector)
+                                                 : npts_64 * nsectors_per_vec;
+    }
 
     if (append_reorder_data)
     {
         n_data_nodes_per_sector = defaults::SECTOR_LEN / (ndims_reorder_file * sizeof(float));
         n_reorder_sectors = ROUND_UP(npts_64, n_data_nodes_per_sector) / n_data_nodes_per_sector;
     }
-    uint64_t disk_index_file_size = (n_sectors + n_reorder_sectors + 1) * defaults::SECTOR_LEN;
+    uint64_t disk_index_file_size = (n_sectors + n_reorder_sectors + n_vec_sectors + 1) * defaults::SECTOR_LEN;
 
     std::vector<uint64_t> output_file_meta;
     output_file_meta.push_back(npts_64);
@@ -944,10 +1257,19 @@ void create_disk_layout(const std::string base_file, const std::string mem_index
         output_file_meta.push_back(n_data_nodes_per_sector);
     }
     output_file_meta.push_back(disk_index_file_size);
+    if (decoupled_layout || compress_adjacency)
+    {
+        // layout extension; readers that stop at the file size ignore it
+        uint64_t layout_flags = (decoupled_layout ? DISK_LAYOUT_DECOUPLED : 0) |
+                                (compress_adjacency ? DISK_LAYOUT_COMPRESSED_ADJACENCY : 0);
+        output_file_meta.push_back(layout_flags);
+        output_file_meta.push_back(width_u32);
+        output_file_meta.push_back(decoupled_layout ? n_sectors + 1 : 0);
+        output_file_meta.push_back(decoupled_layout ? vec_len : 0);
+    }
 
     diskann_writer.write(sector_buf.get(), defaults::SECTOR_LEN);
 
-    std::unique_ptr<T[]> cur_node_coords = std::make_unique<T[]>(ndims_64);
     diskann::cout << "# sectors: " << n_sectors << std::endl;
     uint64_t cur_node_id = 0;
 
@@ -963,32 +1285,7 @@ void create_disk_layout(const std::string base_file, const std::string mem_index
             for (uint64_t sector_node_id = 0; sector_node_id < nnodes_per_sector && cur_node_id < npts_64;
                  sector_node_id++)
             {
-                memset(node_buf.get(), 0, max_node_len);
-                // read cur node's nnbrs
-                vamana_reader.read((char *)&nnbrs, sizeof(uint32_t));
-
-                // sanity checks on nnbrs
-                assert(nnbrs > 0);
-                assert(nnbrs <= width_u32);
-
-                // read node's nhood
-                vamana_reader.read((char *)nhood_buf, (std::min)(nnbrs, width_u32) * sizeof(uint32_t));
-                if (nnbrs > width_u32)
-                {
-                    vamana_reader.seekg((nnbrs - width_u32) * sizeof(uint32_t), vamana_reader.cur);
-                }
-
-                // write coords of node first
-                //  T *node_coords = data + ((uint64_t) ndims_64 * cur_node_id);
-                base_reader.read((char *)cur_node_coords.get(), sizeof(T) * ndims_64);
-                memcpy(node_buf.get(), cur_node_coords.get(), ndims_64 * sizeof(T));
-
-                // write nnbrs
-                *(uint32_t *)(node_buf.get() + ndims_64 * sizeof(T)) = (std::min)(nnbrs, width_u32);
-
-                // write nhood next
-                memcpy(node_buf.get() + ndims_64 * sizeof(T) + sizeof(uint32_t), nhood_buf,
-                       (std::min)(nnbrs, width_u32) * sizeof(uint32_t));
+                fill_node(node_buf.get());
 
                 // get offset into sector_buf
                 char *sector_node_buf = sector_buf.get() + (sector_node_id * max_node_len);
@@ -1011,39 +1308,30 @@ void create_disk_layout(const std::string base_file, const std::string mem_index
                 diskann::cout << "Sector #" << i * nsectors_per_node << "written" << std::endl;
             }
             memset(multisector_buf.get(), 0, nsectors_per_node * defaults::SECTOR_LEN);
-
-            memset(node_buf.get(), 0, max_node_len);
-            // read cur node's nnbrs
-            vamana_reader.read((char *)&nnbrs, sizeof(uint32_t));
-
-            // sanity checks on nnbrs
-            assert(nnbrs > 0);
-            assert(nnbrs <= width_u32);
-
-            // read node's nhood
-            vamana_reader.read((char *)nhood_buf, (std::min)(nnbrs, width_u32) * sizeof(uint32_t));
-            if (nnbrs > width_u32)
-            {
-                vamana_reader.seekg((nnbrs - width_u32) * sizeof(uint32_t), vamana_reader.cur);
-            }
-
-            // write coords of node first
-            //  T *node_coords = data + ((uint64_t) ndims_64 * cur_node_id);
-            base_reader.read((char *)cur_node_coords.get(), sizeof(T) * ndims_64);
-            memcpy(multisector_buf.get(), cur_node_coords.get(), ndims_64 * sizeof(T));
-
-            // write nnbrs
-            *(uint32_t *)(multisector_buf.get() + ndims_64 * sizeof(T)) = (std::min)(nnbrs, width_u32);
-
-            // write nhood next
-            memcpy(multisector_buf.get() + ndims_64 * sizeof(T) + sizeof(uint32_t), nhood_buf,
-                   (std::min)(nnbrs, width_u32) * sizeof(uint32_t));
+            fill_node(multisector_buf.get());
 
             // flush sector to disk
             diskann_writer.write(multisector_buf.get(), nsectors_per_node * defaults::SECTOR_LEN);
         }
     }
 
+    if (decoupled_layout)
+    {
+        diskann::cout << "Graph written. Appending " << n_vec_sectors << " vector sectors..." << std::endl;
+        // the graph pass did not touch base_reader, so it is still at the first vector
+        uint64_t vec_sector_len =
+            nvecs_per_vec_sector > 0 ? defaults::SECTOR_LEN : nsectors_per_vec * defaults::SECTOR_LEN;
+        uint64_t nvecs_per_write = (std::max)(nvecs_per_vec_sector, (uint64_t)1);
+        std::unique_ptr<char[]> vec_sector_buf = std::make_unique<char[]>(vec_sector_len);
+        for (uint64_t disk_id = 0; disk_id < npts_64; disk_id += nvecs_per_write)
+        {
+            memset(vec_sector_buf.get(), 0, vec_sector_len);
+            for (uint64_t j = 0; j < nvecs_per_write && disk_id + j < npts_64; j++)
+                read_coords(disk_id + j, vec_sector_buf.get() + j * vec_len);
+            diskann_writer.write(vec_sector_buf.get(), vec_sector_len);
+        }
+    }
+
     if (append_reorder_data)
     {
         diskann::cout << "Index written. Appending reorder data..." << std::endl;
@@ -1064,6 +1352,13 @@ void create_disk_layout(const std::string base_file, const std::string mem_index
                  sector_node_id++)
             {
                 memset(vec_buf.get(), 0, vec_len);
+                if (locality_layout)
+                {
+                    uint64_t disk_id = sector * n_data_nodes_per_sector + sector_node_id;
+                    if (disk_id >= npts_64)
+                        break;
+                    reorder_data_reader.seekg(2 * sizeof(uint32_t) + (uint64_t)new_to_old[disk_id] * vec_len);
+                }
                 reorder_data_reader.read(vec_buf.get(), vec_len);
 
                 // copy node buf into sector_node_buf
@@ -1092,7 +1387,7 @@ int build_disk_index(const char *dataFilePath, const char *indexFilePath, const
     {
         param_list.push_back(cur_param);
     }
-    if (param_list.size() < 5 || param_list.size() > 9)
+    if (param_list.size() < 5 || param_list.size() > 13)
     {
         diskann::cout << "Correct usage of parameters is R (max degree)\n"
                          "L (indexing list size, better if >= R)\n"
@@ -1105,7 +1400,15 @@ int build_disk_index(const char *dataFilePath, const char *indexFilePath, const
                          ": optional paramter, use only when using disk PQ\n"
                          "build_PQ_byte (number of PQ bytes for inde build; set 0 to use "
                          "full precision vectors)\n"
-                         "QD Quantized Dimension to overwrite the derived dim from B "
+                         "QD Quantized Dimension to overwrite the derived dim from B\n"
+                         "locality (set 1 to reorder nodes so graph neighbours share "
+                         "sectors: optional parameter)\n"
+                         "decoupled (set 1 to keep adjacency lists and vectors in separate "
+                         "disk regions: optional parameter, not with reorder)\n"
+                         "compress (set 1 to store neighbour lists delta + group varint "
+                         "encoded: optional parameter)\n"
+                         "nav (set 1 to build an in-memory navigation graph over the sample "
+                         "points: optional parameter)"
                       << std::endl;
         return -1;
     }
@@ -1148,6 +1451,30 @@ int build_disk_index(const char *dataFilePath, const char *indexFilePath, const
         build_pq_bytes = atoi(param_list[7].c_str());
     }
 
+    bool locality_layout = false;
+    if (param_list.size() >= 10)
+    {
+        locality_layout = (1 == atoi(param_list[9].c_str()));
+    }
+
+    bool decoupled_layout = false;
+    if (param_list.size() >= 11)
+    {
+        decoupled_layout = (1 == atoi(param_list[10].c_str()));
+    }
+
+    bool compress_adjacency = false;
+    if (param_list.size() >= 12)
+    {
+        compress_adjacency = (1 == atoi(param_list[11].c_str()));
+    }
+
+    bool nav_graph = false;
+    if (param_list.size() >= 13)
+    {
+        nav_graph = (1 == atoi(param_list[12].c_str()));
+    }
+
     std::string base_file(dataFilePath);
     std::string data_file_to_use = base_file;
     std::string labels_file_original = label_file;
@@ -1296,15 +1623,18 @@ int build_disk_index(const char *dataFilePath, const char *indexFilePath, const
     timer.reset();
     if (!use_disk_pq)
     {
-        diskann::create_disk_layout<T>(data_file_to_use.c_str(), mem_index_path, disk_index_path);
+        diskann::create_disk_layout<T>(data_file_to_use.c_str(), mem_index_path, disk_index_path, "",
+                                       locality_layout, decoupled_layout, compress_adjacency);
     }
     else
     {
         if (!reorder_data)
-            diskann::create_disk_layout<uint8_t>(disk_pq_compressed_vectors_path, mem_index_path, disk_index_path);
+            diskann::create_disk_layout<uint8_t>(disk_pq_compressed_vectors_path, mem_index_path, disk_index_path, "",
+                                                 locality_layout, decoupled_layout, compress_adjacency);
         else
             diskann::create_disk_layout<uint8_t>(disk_pq_compressed_vectors_path, mem_index_path, disk_index_path,
-                                                 data_file_to_use.c_str());
+                                                 data_file_to_use.c_str(), locality_layout, decoupled_layout,
+                                                 compress_adjacency);
     }
     diskann::cout << timer.elapsed_seconds_for_step("generating disk layout") << std::endl;
 
@@ -1313,6 +1643,20 @@ int build_disk_index(const char *dataFilePath, const char *indexFilePath, const
         ten_percent_points > MAX_SAMPLE_POINTS_FOR_WARMUP ? MAX_SAMPLE_POINTS_FOR_WARMUP : ten_percent_points;
     double sample_sampling_rate = num_sample_points / points_num;
     gen_random_slice<T>(data_file_to_use.c_str(), sample_base_prefix, sample_sampling_rate);
+    std::string nav_index_path = disk_index_path + "_nav.index";
+    if (nav_graph)
+    {
+        timer.reset();
+        build_nav_graph<T>(sample_base_prefix, nav_index_path, num_threads);
+        diskann::cout << timer.elapsed_seconds_for_step("building navigation graph") << std::endl;
+    }
+    else
+    {
+        // ids of a navigation graph from an earlier build no longer match this index
+        std::remove(nav_index_path.c_str());
+        std::remove((nav_index_path + ".data").c_str());
+        std::remove((nav_index_path + "_ids.bin").c_str());
+    }
     if (use_filters)
     {
         copy_file(labels_file_to_use, disk_labels_file);
@@ -1338,17 +1682,33 @@ int build_disk_index(const char *dataFilePath, const char *indexFilePath, const
     return 0;
 }
 
+template DISKANN_DLLEXPORT void build_nav_graph<int8_t>(const std::string &sample_prefix,
+                                                        const std::string &nav_index_file, const uint32_t num_threads);
+template DISKANN_DLLEXPORT void build_nav_graph<uint8_t>(const std::string &sample_prefix,
+                                                         const std::string &nav_index_file, const uint32_t num_threads);
+template DISKANN_DLLEXPORT void build_nav_graph<float>(const std::string &sample_prefix,
+                                                       const std::string &nav_index_file, const uint32_t num_threads);
+
 template DISKANN_DLLEXPORT void create_disk_layout<int8_t>(const std::string base_file,
                                                            const std::string mem_index_file,
                                                            const std::string output_file,
-                                                           const std::string reorder_data_file);
+                                                           const std::string reorder_data_file,
+                                                           const bool locality_layout,
+                                                           const bool decoupled_layout,
+                                                           const bool compress_adjacency);
 template DISKANN_DLLEXPORT void create_disk_layout<uint8_t>(const std::string base_file,
                                                             const std::string mem_index_file,
                                                             const std::string output_file,
-                                                            const std::string reorder_data_file);
+                                                            const std::string reorder_data_file,
+                                                            const bool locality_layout,
+                                                            const bool decoupled_layout,
+                                                            const bool compress_adjacency);
 template DISKANN_DLLEXPORT void create_disk_layout<float>(const std::string base_file, const std::string mem_index_file,
                                                           const std::string output_file,
-                                                          const std::string reorder_data_file);
+                                                          const std::string reorder_data_file,
+                                                          const bool locality_layout,
+                                                          const bool decoupled_layout,
+                                                          const bool compress_adjacency);
 
 template DISKANN_DLLEXPORT int8_t *load_warmup<int8_t>(const std::string &cache_warmup_file, uint64_t &warmup_num,
                                                        uint64_t warmup_dim, uint64_t warmup_aligned_dim);
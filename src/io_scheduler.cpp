@@ -0,0 +1,136 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+
+#include "io_scheduler.h"
+#include "timer.h"
+#include "utils.h"
+
+namespace diskann
+{
+IOScheduler::IOScheduler(const std::vector<ClassConfig> &classes, uint32_t device_depth) : _device_depth(device_depth)
+{
+    if (classes.empty() || device_depth == 0)
+    {
+        throw ANNException("IOScheduler needs at least one class and a positive device depth", -1, __FUNCSIG__,
+                           __FILE__, __LINE__);
+    }
+    for (auto &config : classes)
+    {
+        if (config.weight == 0)
+        {
+            throw ANNException("IOScheduler class weights must be positive", -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        _classes.emplace_back();
+        _classes.back().config = config;
+    }
+}
+
+uint32_t IOScheduler::num_classes() const
+{
+    return (uint32_t)_classes.size();
+}
+
+void IOScheduler::check_class(uint32_t cls) const
+{
+    if (cls >= _classes.size())
+    {
+        throw ANNException("IOScheduler: unknown class " + std::to_string(cls), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+}
+
+uint32_t IOScheduler::max_grant(uint32_t cls) const
+{
+    check_class(cls);
+    uint32_t class_depth = _classes[cls].config.max_depth;
+    return class_depth > 0 ? (std::min)(class_depth, _device_depth) : _device_depth;
+}
+
+int64_t IOScheduler::next_class() const
+{
+    int64_t best = -1;
+    for (uint64_t c = 0; c < _classes.size(); c++)
+    {
+        const ClassState &state = _classes[c];
+        if (state.waiting.empty())
+            continue;
+        if (state.config.max_depth > 0 && state.in_flight + state.waiting.front().n > state.config.max_depth)
+            continue;
+        if (best < 0 || state.vtime < _classes[best].vtime)
+            best = (int64_t)c;
+    }
+    return best;
+}
+
+void IOScheduler::acquire(uint32_t cls, uint32_t n)
+{
+    n = (std::max)(1u, (std::min)(n, max_grant(cls)));
+    ClassState &state = _classes[cls];
+    Timer wait_timer;
+
+    std::unique_lock<std::mutex> guard(_lock);
+    // a class coming back from idle starts at the current virtual time, so it
+    // cannot claim the share it did not use
+    if (state.waiting.empty())
+        state.vtime = (std::max)(state.vtime, _vclock);
+    uint64_t ticket = _next_ticket++;
+    state.waiting.push_back({ticket, n});
+    _cv.wait(guard, [&] {
+        return state.waiting.front().ticket == ticket && next_class() == (int64_t)cls &&
+               _in_flight + n <= _device_depth;
+    });
+    state.waiting.pop_front();
+
+    _in_flight += n;
+    state.in_flight += n;
+    _vclock = state.vtime;
+    state.vtime += (double)n / state.config.weight;
+    state.stats.n_grants++;
+    state.stats.n_reads += n;
+    state.stats.wait_us += wait_timer.elapsed();
+    guard.unlock();
+    // the next waiter may fit in what is left
+    _cv.notify_all();
+}
+
+void IOScheduler::charge(uint32_t cls, uint32_t n)
+{
+    check_class(cls);
+    std::lock_guard<std::mutex> guard(_lock);
+    _in_flight += n;
+    _classes[cls].in_flight += n;
+    _classes[cls].stats.n_reads += n;
+}
+
+void IOScheduler::release(uint32_t cls, uint32_t n)
+{
+    check_class(cls);
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        ClassState &state = _classes[cls];
+        n = (std::min)(n, state.in_flight);
+        state.in_flight -= n;
+        _in_flight -= n;
+    }
+    _cv.notify_all();
+}
+
+std::vector<IOScheduler::ClassStats> IOScheduler::get_class_stats()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    std::vector<ClassStats> stats;
+    for (auto &state : _classes)
+        stats.push_back(state.stats);
+    return stats;
+}
+
+uint64_t IOScheduler::num_waiting()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    uint64_t n = 0;
+    for (auto &state : _classes)
+        n += state.waiting.size();
+    return n;
+}
+} // namespace diskann
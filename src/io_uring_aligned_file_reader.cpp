@@ -0,0 +1,380 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "io_uring_aligned_file_reader.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include "tsl/robin_map.h"
+#include "utils.h"
+#define URING_ENTRIES 1024
+
+namespace
+{
+void prep_read(IoUringContext *uctx, int fd, struct io_uring_sqe *sqe, AlignedRead &req)
+{
+    int fd_or_idx = uctx->fixed_file ? 0 : fd;
+    char *buf = (char *)req.buf;
+    if (uctx->fixed_buf != nullptr && buf >= uctx->fixed_buf && buf + req.len <= uctx->fixed_buf + uctx->fixed_buf_len)
+    {
+        io_uring_prep_read_fixed(sqe, fd_or_idx, req.buf, (unsigned)req.len, req.offset, 0);
+    }
+    else
+    {
+        io_uring_prep_read(sqe, fd_or_idx, req.buf, (unsigned)req.len, req.offset);
+    }
+    if (uctx->fixed_file)
+        sqe->flags |= IOSQE_FIXED_FILE;
+    // completions are identified by the request buffer, as get_completions() reports them
+    io_uring_sqe_set_data(sqe, req.buf);
+}
+
+// a read that returned fewer bytes than asked for leaves the rest of its buffer stale
+inline int read_result(int res, uint64_t len)
+{
+    return (res >= 0 && (uint64_t)res != len) ? -EIO : res;
+}
+
+int submit_or_throw(struct io_uring *ring, unsigned wait_nr)
+{
+    int ret = wait_nr > 0 ? io_uring_submit_and_wait(ring, wait_nr) : io_uring_submit(ring);
+    if (ret < 0)
+    {
+        std::stringstream stream;
+        stream << "io_uring_submit() failed; returned " << ret << "=" << ::strerror(-ret);
+        throw diskann::ANNException(stream.str(), ret, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    return ret;
+}
+
+void execute_io(IoUringContext *uctx, int fd, std::vector<AlignedRead> &read_reqs)
+{
+    struct io_uring *ring = &uctx->ring;
+    uint64_t n_reqs = read_reqs.size();
+    uint64_t n_submitted = 0, n_completed = 0;
+    int first_error = 0;
+    // the ring may also hold reads from submit_reqs(); their completions are kept for
+    // get_completions(), so this batch's are told apart by buffer (and counted, in case
+    // a buffer appears twice)
+    tsl::robin_map<void *, std::pair<uint64_t, uint64_t>> own_reads;
+    for (auto &req : read_reqs)
+    {
+        auto &own = own_reads[req.buf];
+        own.first = req.len;
+        own.second++;
+    }
+
+    while (n_completed < n_reqs)
+    {
+        // fill as much of the submission queue as is free
+        uint64_t n_prepped = 0;
+        while (n_submitted + n_prepped < n_reqs)
+        {
+            struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+            if (sqe == nullptr)
+                break;
+            prep_read(uctx, fd, sqe, read_reqs[n_submitted + n_prepped]);
+            n_prepped++;
+        }
+
+        // one syscall submits the batch and waits for the first completion
+        submit_or_throw(ring, 1);
+        n_submitted += n_prepped;
+
+        unsigned head, n_seen = 0;
+        struct io_uring_cqe *cqe;
+        io_uring_for_each_cqe(ring, head, cqe)
+        {
+            void *buf = io_uring_cqe_get_data(cqe);
+            auto own = own_reads.find(buf);
+            if (own == own_reads.end())
+            {
+                uctx->requeued.emplace_back(buf, cqe->res);
+            }
+            else
+            {
+                int res = read_result(cqe->res, own->second.first);
+                if (res < 0 && first_error == 0)
+                    first_error = res;
+                if (--own.value().second == 0)
+                    own_reads.erase(own);
+                n_completed++;
+            }
+            n_seen++;
+        }
+        io_uring_cq_advance(ring, n_seen);
+    }
+
+    if (first_error != 0)
+    {
+        std::stringstream stream;
+        stream << "io_uring read failed; res=" << first_error << "=" << ::strerror(-first_error);
+        throw diskann::ANNException(stream.str(), first_error, __FUNCSIG__, __FILE__, __LINE__);
+    }
+}
+} // namespace
+
+IoUringAlignedFileReader::IoUringAlignedFileReader(bool sqpoll, uint32_t sqpoll_idle_ms)
+    : sqpoll(sqpoll), sqpoll_idle_ms(sqpoll_idle_ms)
+{
+    this->file_desc = -1;
+}
+
+IoUringAlignedFileReader::~IoUringAlignedFileReader()
+{
+    int64_t ret;
+    // check to make sure file_desc is closed
+    ret = ::fcntl(this->file_desc, F_GETFD);
+    if (ret == -1)
+    {
+        if (errno != EBADF)
+        {
+            std::cerr << "close() not called" << std::endl;
+            // close file desc
+            ret = ::close(this->file_desc);
+            // error checks
+            if (ret == -1)
+            {
+                std::cerr << "close() failed; returned " << ret << ", errno=" << errno << ":" << ::strerror(errno)
+                          << std::endl;
+            }
+        }
+    }
+}
+
+IOContext &IoUringAlignedFileReader::get_ctx()
+{
+    std::unique_lock<std::mutex> lk(ctx_mut);
+    if (ctx_map.find(std::this_thread::get_id()) == ctx_map.end())
+    {
+        std::cerr << "bad thread access; returning empty IOContext" << std::endl;
+        return this->bad_ctx;
+    }
+    else
+    {
+        return ctx_map[std::this_thread::get_id()];
+    }
+}
+
+void IoUringAlignedFileReader::register_thread()
+{
+    auto my_id = std::this_thread::get_id();
+    std::unique_lock<std::mutex> lk(ctx_mut);
+    if (ctx_map.find(my_id) != ctx_map.end())
+    {
+        std::cerr << "multiple calls to register_thread from the same thread" << std::endl;
+        return;
+    }
+
+    IoUringContext *uctx = new IoUringContext();
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    if (this->sqpoll)
+    {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = this->sqpoll_idle_ms;
+        if (this->sqpoll_wq_fd != -1)
+        {
+            params.flags |= IORING_SETUP_ATTACH_WQ;
+            params.wq_fd = (uint32_t)this->sqpoll_wq_fd;
+        }
+    }
+
+    int ret = io_uring_queue_init_params(URING_ENTRIES, &uctx->ring, &params);
+    if (ret != 0)
+    {
+        lk.unlock();
+        std::cerr << "io_uring_queue_init_params() failed; returned " << ret << ":" << ::strerror(-ret) << std::endl;
+        delete uctx;
+        return;
+    }
+    if (this->sqpoll && this->sqpoll_wq_fd == -1)
+        this->sqpoll_wq_fd = uctx->ring.ring_fd;
+
+    // register the index file so that each request skips the fd table lookup
+    if (this->file_desc != -1)
+    {
+        ret = io_uring_register_files(&uctx->ring, &this->file_desc, 1);
+        uctx->fixed_file = (ret == 0);
+        if (ret != 0)
+        {
+            std::cerr << "io_uring_register_files() failed; returned " << ret << ":" << ::strerror(-ret)
+                      << ". Using regular file descriptor." << std::endl;
+        }
+    }
+
+    diskann::cout << "allocating io_uring ring: " << uctx->ring.ring_fd << " to thread-id:" << my_id << std::endl;
+    ctx_map[my_id].uring = uctx;
+    lk.unlock();
+}
+
+void IoUringAlignedFileReader::deregister_thread()
+{
+    auto my_id = std::this_thread::get_id();
+    std::unique_lock<std::mutex> lk(ctx_mut);
+    auto iter = ctx_map.find(my_id);
+    assert(iter != ctx_map.end());
+    if (iter == ctx_map.end())
+        return;
+
+    IoUringContext *uctx = iter->second.uring;
+    ctx_map.erase(my_id);
+    // later rings must not attach to the poller through a closed (or reused) fd
+    if (uctx != nullptr && uctx->ring.ring_fd == this->sqpoll_wq_fd)
+    {
+        this->sqpoll_wq_fd = -1;
+        for (auto &entry : ctx_map)
+        {
+            if (entry.second.uring != nullptr)
+            {
+                this->sqpoll_wq_fd = entry.second.uring->ring.ring_fd;
+                break;
+            }
+        }
+    }
+    lk.unlock();
+
+    if (uctx != nullptr)
+    {
+        io_uring_queue_exit(&uctx->ring);
+        delete uctx;
+    }
+    std::cerr << "returned ring from thread-id:" << my_id << std::endl;
+}
+
+void IoUringAlignedFileReader::deregister_all_threads()
+{
+    std::unique_lock<std::mutex> lk(ctx_mut);
+    for (auto x = ctx_map.begin(); x != ctx_map.end(); x++)
+    {
+        IoUringContext *uctx = x.value().uring;
+        if (uctx != nullptr)
+        {
+            io_uring_queue_exit(&uctx->ring);
+            delete uctx;
+        }
+    }
+    ctx_map.clear();
+    this->sqpoll_wq_fd = -1;
+}
+
+void IoUringAlignedFileReader::register_buffer(IOContext &ctx, void *buf, uint64_t len)
+{
+    IoUringContext *uctx = ctx.uring;
+    if (uctx == nullptr || uctx->fixed_buf != nullptr)
+        return;
+
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = len;
+    int ret = io_uring_register_buffers(&uctx->ring, &iov, 1);
+    if (ret != 0)
+    {
+        // typically RLIMIT_MEMLOCK; reads into the buffer still work, just unpinned
+        std::cerr << "io_uring_register_buffers() failed; returned " << ret << ":" << ::strerror(-ret) << std::endl;
+        return;
+    }
+    uctx->fixed_buf = (char *)buf;
+    uctx->fixed_buf_len = len;
+}
+
+void IoUringAlignedFileReader::open(const std::string &fname)
+{
+    int flags = O_DIRECT | O_RDONLY | O_LARGEFILE;
+    this->file_desc = ::open(fname.c_str(), flags);
+    // error checks
+    assert(this->file_desc != -1);
+    std::cerr << "Opened file : " << fname << std::endl;
+}
+
+void IoUringAlignedFileReader::close()
+{
+    ::fcntl(this->file_desc, F_GETFD);
+    ::close(this->file_desc);
+}
+
+void IoUringAlignedFileReader::read(std::vector<AlignedRead> &read_reqs, IOContext &ctx, bool async)
+{
+    if (async == true)
+    {
+        diskann::cout << "Async currently not supported in linux." << std::endl;
+    }
+    assert(this->file_desc != -1);
+    if (ctx.uring == nullptr)
+    {
+        throw diskann::ANNException("IoUringAlignedFileReader::read called with an unregistered context", -1,
+                                    __FUNCSIG__, __FILE__, __LINE__);
+    }
+    execute_io(ctx.uring, this->file_desc, read_reqs);
+}
+
+void IoUringAlignedFileReader::submit_reqs(std::vector<AlignedRead> &read_reqs, IOContext &ctx)
+{
+    assert(this->file_desc != -1);
+    IoUringContext *uctx = ctx.uring;
+    struct io_uring *ring = &uctx->ring;
+    for (auto &req : read_reqs)
+    {
+        struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+        if (sqe == nullptr)
+        {
+            // submission queue full: hand what we have to the kernel first
+            submit_or_throw(ring, 0);
+            sqe = io_uring_get_sqe(ring);
+        }
+        prep_read(uctx, this->file_desc, sqe, req);
+        uctx->pending_len[req.buf] = req.len;
+    }
+    submit_or_throw(ring, 0);
+}
+
+void IoUringAlignedFileReader::get_completions(IOContext &ctx, uint64_t min_completions,
+                                               std::vector<void *> &completed_bufs)
+{
+    IoUringContext *uctx = ctx.uring;
+    struct io_uring *ring = &uctx->ring;
+    uint64_t n_reaped = 0;
+    int first_error = 0;
+    auto reap = [&](void *buf, int res) {
+        auto pending = uctx->pending_len.find(buf);
+        if (pending != uctx->pending_len.end())
+        {
+            res = read_result(res, pending->second);
+            uctx->pending_len.erase(pending);
+        }
+        if (res < 0 && first_error == 0)
+            first_error = res;
+        completed_bufs.push_back(buf);
+        n_reaped++;
+    };
+
+    // completions a blocking read() came across first
+    for (auto &done : uctx->requeued)
+        reap(done.first, done.second);
+    uctx->requeued.clear();
+
+    do
+    {
+        if (n_reaped < min_completions)
+            submit_or_throw(ring, (unsigned)(min_completions - n_reaped));
+
+        unsigned head, n_seen = 0;
+        struct io_uring_cqe *cqe;
+        io_uring_for_each_cqe(ring, head, cqe)
+        {
+            reap(io_uring_cqe_get_data(cqe), cqe->res);
+            n_seen++;
+        }
+        io_uring_cq_advance(ring, n_seen);
+    } while (n_reaped < min_completions);
+
+    if (first_error != 0)
+    {
+        std::stringstream stream;
+        stream << "io_uring read failed; res=" << first_error << "=" << ::strerror(-first_error);
+        throw diskann::ANNException(stream.str(), first_error, __FUNCSIG__, __FILE__, __LINE__);
+    }
+}
@@ -3,13 +3,52 @@
 
 #include "linux_aligned_file_reader.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <sstream>
 #include "tsl/robin_map.h"
 #include "utils.h"
 #define MAX_EVENTS 1024
 
+namespace diskann
+{
+void merge_requests(std::vector<AlignedRead> &read_reqs, std::vector<MergedRead> &merged, std::vector<iovec> &iovs,
+                    std::vector<std::pair<AlignedRead *, AlignedRead *>> &dups)
+{
+    std::vector<AlignedRead *> order(read_reqs.size());
+    for (uint64_t i = 0; i < read_reqs.size(); i++)
+        order[i] = &read_reqs[i];
+    std::sort(order.begin(), order.end(), [](const AlignedRead *a, const AlignedRead *b) {
+        return a->offset < b->offset || (a->offset == b->offset && a->len < b->len);
+    });
+
+    AlignedRead *prev = nullptr;
+    for (AlignedRead *req : order)
+    {
+        if (prev != nullptr && req->offset == prev->offset && req->len == prev->len)
+        {
+            dups.emplace_back(prev, req);
+            continue;
+        }
+        MergedRead *last = merged.empty() ? nullptr : &merged.back();
+        if (last != nullptr && last->offset + last->len == req->offset && last->n_iovs < MAX_IOVS_PER_READ)
+        {
+            last->len += req->len;
+            last->n_iovs++;
+        }
+        else
+        {
+            merged.push_back({req->offset, req->len, iovs.size(), 1});
+        }
+        iovs.push_back({req->buf, req->len});
+        prev = req;
+    }
+}
+} // namespace diskann
+
 namespace
 {
 typedef struct io_event io_event_t;
@@ -28,18 +67,28 @@ void execute_io(io_context_t ctx, int fd, std::vector<AlignedRead> &read_reqs, u
     }
 #endif
 
+    std::vector<diskann::MergedRead> merged;
+    std::vector<iovec> iovs;
+    std::vector<std::pair<AlignedRead *, AlignedRead *>> dups;
+    merged.reserve(read_reqs.size());
+    iovs.reserve(read_reqs.size());
+    diskann::merge_requests(read_reqs, merged, iovs, dups);
+
     // break-up requests into chunks of size MAX_EVENTS each
-    uint64_t n_iters = ROUND_UP(read_reqs.size(), MAX_EVENTS) / MAX_EVENTS;
+    uint64_t n_iters = ROUND_UP(merged.size(), MAX_EVENTS) / MAX_EVENTS;
     for (uint64_t iter = 0; iter < n_iters; iter++)
     {
-        uint64_t n_ops = std::min((uint64_t)read_reqs.size() - (iter * MAX_EVENTS), (uint64_t)MAX_EVENTS);
+        uint64_t n_ops = std::min((uint64_t)merged.size() - (iter * MAX_EVENTS), (uint64_t)MAX_EVENTS);
         std::vector<iocb_t *> cbs(n_ops, nullptr);
         std::vector<io_event_t> evts(n_ops);
         std::vector<struct iocb> cb(n_ops);
         for (uint64_t j = 0; j < n_ops; j++)
         {
-            io_prep_pread(cb.data() + j, fd, read_reqs[j + iter * MAX_EVENTS].buf, read_reqs[j + iter * MAX_EVENTS].len,
-                          read_reqs[j + iter * MAX_EVENTS].offset);
+            const diskann::MergedRead &m = merged[j + iter * MAX_EVENTS];
+            if (m.n_iovs == 1)
+                io_prep_pread(cb.data() + j, fd, iovs[m.iov_start].iov_base, m.len, m.offset);
+            else
+                io_prep_preadv(cb.data() + j, fd, iovs.data() + m.iov_start, (int)m.n_iovs, m.offset);
         }
 
         // initialize `cbs` using `cb` array
@@ -58,10 +107,13 @@ void execute_io(io_context_t ctx, int fd, std::vector<AlignedRead> &read_reqs, u
             // if requests didn't get accepted
             if (ret != (int64_t)n_ops)
             {
-                std::cerr << "io_submit() failed; returned " << ret << ", expected=" << n_ops << ", ernno=" << errno
-                          << "=" << ::strerror(-ret) << ", try #" << n_tries + 1;
-                std::cout << "ctx: " << ctx << "\n";
-                exit(-1);
+                // the part that was accepted still lands in the callers' buffers: wait for it
+                if (ret > 0)
+                    io_getevents(ctx, ret, ret, evts.data(), nullptr);
+                std::stringstream stream;
+                stream << "io_submit() failed; returned " << ret << ", expected=" << n_ops << ", ernno=" << errno
+                       << "=" << ::strerror(-ret) << ", try #" << n_tries + 1;
+                throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
             }
             else
             {
@@ -70,9 +122,10 @@ void execute_io(io_context_t ctx, int fd, std::vector<AlignedRead> &read_reqs, u
                 // if requests didn't complete
                 if (ret != (int64_t)n_ops)
                 {
-                    std::cerr << "io_getevents() failed; returned " << ret << ", expected=" << n_ops
-                              << ", ernno=" << errno << "=" << ::strerror(-ret) << ", try #" << n_tries + 1;
-                    exit(-1);
+                    std::stringstream stream;
+                    stream << "io_getevents() failed; returned " << ret << ", expected=" << n_ops
+                           << ", ernno=" << errno << "=" << ::strerror(-ret) << ", try #" << n_tries + 1;
+                    throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
                 }
                 else
                 {
@@ -88,12 +141,16 @@ void execute_io(io_context_t ctx, int fd, std::vector<AlignedRead> &read_reqs, u
         }
         */
     }
+
+    for (auto &dup : dups)
+        memcpy(dup.second->buf, dup.first->buf, dup.first->len);
 }
 } // namespace
 
 LinuxAlignedFileReader::LinuxAlignedFileReader()
 {
     this->file_desc = -1;
+    this->bad_ctx.aio_ctx = (io_context_t)-1;
 }
 
 LinuxAlignedFileReader::~LinuxAlignedFileReader()
@@ -118,7 +175,7 @@ LinuxAlignedFileReader::~LinuxAlignedFileReader()
     }
 }
 
-io_context_t &LinuxAlignedFileReader::get_ctx()
+IOContext &LinuxAlignedFileReader::get_ctx()
 {
     std::unique_lock<std::mutex> lk(ctx_mut);
     // perform checks only in DEBUG mode
@@ -155,7 +212,7 @@ void LinuxAlignedFileReader::register_thread()
     else
     {
         diskann::cout << "allocating ctx: " << ctx << " to thread-id:" << my_id << std::endl;
-        ctx_map[my_id] = ctx;
+        ctx_map[my_id].aio_ctx = ctx;
     }
     lk.unlock();
 }
@@ -167,7 +224,7 @@ void LinuxAlignedFileReader::deregister_thread()
     assert(ctx_map.find(my_id) != ctx_map.end());
 
     lk.unlock();
-    io_context_t ctx = this->get_ctx();
+    io_context_t ctx = this->get_ctx().aio_ctx;
     io_destroy(ctx);
     //  assert(ret == 0);
     lk.lock();
@@ -181,7 +238,7 @@ void LinuxAlignedFileReader::deregister_all_threads()
     std::unique_lock<std::mutex> lk(ctx_mut);
     for (auto x = ctx_map.begin(); x != ctx_map.end(); x++)
     {
-        io_context_t ctx = x.value();
+        io_context_t ctx = x.value().aio_ctx;
         io_destroy(ctx);
         //  assert(ret == 0);
         //  lk.lock();
@@ -213,12 +270,80 @@ void LinuxAlignedFileReader::close()
     //  assert(ret != -1);
 }
 
-void LinuxAlignedFileReader::read(std::vector<AlignedRead> &read_reqs, io_context_t &ctx, bool async)
+void LinuxAlignedFileReader::read(std::vector<AlignedRead> &read_reqs, IOContext &ctx, bool async)
 {
     if (async == true)
     {
         diskann::cout << "Async currently not supported in linux." << std::endl;
     }
     assert(this->file_desc != -1);
-    execute_io(ctx, this->file_desc, read_reqs);
+    execute_io(ctx.aio_ctx, this->file_desc, read_reqs);
+}
+
+void LinuxAlignedFileReader::submit_reqs(std::vector<AlignedRead> &read_reqs, IOContext &ctx)
+{
+    assert(this->file_desc != -1);
+    uint64_t n_ops = read_reqs.size();
+    if (n_ops == 0)
+        return;
+
+    // the kernel copies the control blocks in io_submit, so they only need to
+    // live for the duration of this call
+    std::vector<iocb_t> cb(n_ops);
+    std::vector<iocb_t *> cbs(n_ops, nullptr);
+    for (uint64_t j = 0; j < n_ops; j++)
+    {
+        io_prep_pread(cb.data() + j, this->file_desc, read_reqs[j].buf, read_reqs[j].len, read_reqs[j].offset);
+        cb[j].data = read_reqs[j].buf;
+        cbs[j] = cb.data() + j;
+    }
+
+    uint64_t n_submitted = 0;
+    while (n_submitted < n_ops)
+    {
+        int64_t ret = io_submit(ctx.aio_ctx, (int64_t)(n_ops - n_submitted), cbs.data() + n_submitted);
+        if (ret <= 0)
+        {
+            std::stringstream stream;
+            stream << "io_submit() failed; returned " << ret << ", expected=" << n_ops - n_submitted
+                   << ", ernno=" << errno << "=" << ::strerror(-ret);
+            throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        n_submitted += (uint64_t)ret;
+    }
+}
+
+void LinuxAlignedFileReader::get_completions(IOContext &ctx, uint64_t min_completions,
+                                             std::vector<void *> &completed_bufs)
+{
+    io_event_t evts[MAX_EVENTS];
+    // every reaped buf is handed back, failed or not, so the caller can tell which reads are still in flight
+    int64_t first_error = 0;
+    uint64_t n_reaped = 0;
+    do
+    {
+        // one call reaps at most MAX_EVENTS, and asking for more is EINVAL
+        int64_t n_wait = (int64_t)(std::min)(min_completions - n_reaped, (uint64_t)MAX_EVENTS);
+        int64_t ret = io_getevents(ctx.aio_ctx, n_wait, MAX_EVENTS, evts, nullptr);
+        if (ret < n_wait)
+        {
+            std::stringstream stream;
+            stream << "io_getevents() failed; returned " << ret << ", expected>=" << n_wait
+                   << ", ernno=" << errno << "=" << ::strerror(-ret);
+            throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        for (int64_t i = 0; i < ret; i++)
+        {
+            if ((int64_t)evts[i].res < 0 && first_error == 0)
+                first_error = (int64_t)evts[i].res;
+            completed_bufs.push_back(evts[i].data);
+        }
+        n_reaped += ret;
+    } while (n_reaped < min_completions);
+    if (first_error != 0)
+    {
+        std::stringstream stream;
+        stream << "async read failed; res=" << first_error << "=" << ::strerror(-first_error);
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
 }
@@ -0,0 +1,190 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "mmap_aligned_file_reader.h"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tsl/robin_map.h"
+#include "utils.h"
+
+MmapAlignedFileReader::MmapAlignedFileReader(bool populate, bool hugepages)
+    : populate(populate), hugepages(hugepages)
+{
+    this->file_desc = -1;
+}
+
+MmapAlignedFileReader::~MmapAlignedFileReader()
+{
+    if (this->base != nullptr)
+    {
+        std::cerr << "close() not called" << std::endl;
+        this->close();
+    }
+}
+
+IOContext &MmapAlignedFileReader::get_ctx()
+{
+    std::unique_lock<std::mutex> lk(ctx_mut);
+    if (ctx_map.find(std::this_thread::get_id()) == ctx_map.end())
+    {
+        std::cerr << "bad thread access; returning empty IOContext" << std::endl;
+        return this->bad_ctx;
+    }
+    else
+    {
+        return ctx_map[std::this_thread::get_id()];
+    }
+}
+
+void MmapAlignedFileReader::register_thread()
+{
+    auto my_id = std::this_thread::get_id();
+    std::unique_lock<std::mutex> lk(ctx_mut);
+    if (ctx_map.find(my_id) != ctx_map.end())
+    {
+        std::cerr << "multiple calls to register_thread from the same thread" << std::endl;
+        return;
+    }
+    std::vector<void *> *done = new std::vector<void *>();
+    done->reserve(MAX_IO_DEPTH);
+    ctx_map[my_id].mmap_done = done;
+}
+
+void MmapAlignedFileReader::deregister_thread()
+{
+    auto my_id = std::this_thread::get_id();
+    std::unique_lock<std::mutex> lk(ctx_mut);
+    auto iter = ctx_map.find(my_id);
+    assert(iter != ctx_map.end());
+    if (iter == ctx_map.end())
+        return;
+
+    delete iter->second.mmap_done;
+    ctx_map.erase(my_id);
+}
+
+void MmapAlignedFileReader::deregister_all_threads()
+{
+    std::unique_lock<std::mutex> lk(ctx_mut);
+    for (auto x = ctx_map.begin(); x != ctx_map.end(); x++)
+        delete x.value().mmap_done;
+    ctx_map.clear();
+}
+
+void MmapAlignedFileReader::open(const std::string &fname)
+{
+    this->file_desc = ::open(fname.c_str(), O_RDONLY | O_LARGEFILE);
+    if (this->file_desc == -1)
+    {
+        std::stringstream stream;
+        stream << "open(" << fname << ") failed; errno=" << errno << ":" << ::strerror(errno);
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    struct stat sb;
+    if (::fstat(this->file_desc, &sb) != 0)
+    {
+        std::stringstream stream;
+        stream << "fstat(" << fname << ") failed; errno=" << errno << ":" << ::strerror(errno);
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    this->file_sz = (uint64_t)sb.st_size;
+
+    int flags = MAP_SHARED;
+    if (this->populate)
+        flags |= MAP_POPULATE;
+    void *addr = ::mmap(nullptr, this->file_sz, PROT_READ, flags, this->file_desc, 0);
+    if (addr == MAP_FAILED)
+    {
+        std::stringstream stream;
+        stream << "mmap(" << fname << ") failed; errno=" << errno << ":" << ::strerror(errno);
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    this->base = (char *)addr;
+
+    // beam search touches scattered sectors, so readahead around a fault only
+    // pulls in pages the query will not use
+    ::madvise(this->base, this->file_sz, MADV_RANDOM);
+#ifdef MADV_HUGEPAGE
+    if (this->hugepages && ::madvise(this->base, this->file_sz, MADV_HUGEPAGE) != 0)
+    {
+        std::cerr << "madvise(MADV_HUGEPAGE) failed; errno=" << errno << ":" << ::strerror(errno)
+                  << ". Using regular pages." << std::endl;
+    }
+#endif
+    // no MADV_WILLNEED: without populate the pages come in as searches touch them
+
+    std::cerr << "Mapped file : " << fname << " (" << this->file_sz << " bytes)" << std::endl;
+}
+
+void MmapAlignedFileReader::close()
+{
+    if (this->base != nullptr)
+    {
+        ::munmap(this->base, this->file_sz);
+        this->base = nullptr;
+    }
+    if (this->file_desc != -1)
+    {
+        ::close(this->file_desc);
+        this->file_desc = -1;
+    }
+}
+
+void MmapAlignedFileReader::copy_reqs(std::vector<AlignedRead> &read_reqs)
+{
+    assert(this->base != nullptr);
+    for (auto &req : read_reqs)
+    {
+        if (req.offset + req.len > this->file_sz)
+        {
+            std::stringstream stream;
+            stream << "read past end of mapped file; offset=" << req.offset << ", len=" << req.len
+                   << ", file size=" << this->file_sz;
+            throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        memcpy(req.buf, this->base + req.offset, req.len);
+    }
+}
+
+void MmapAlignedFileReader::read(std::vector<AlignedRead> &read_reqs, IOContext &ctx, bool async)
+{
+    if (async == true)
+    {
+        diskann::cout << "Async currently not supported in linux." << std::endl;
+    }
+    copy_reqs(read_reqs);
+}
+
+void MmapAlignedFileReader::submit_reqs(std::vector<AlignedRead> &read_reqs, IOContext &ctx)
+{
+    if (ctx.mmap_done == nullptr)
+    {
+        throw diskann::ANNException("MmapAlignedFileReader::submit_reqs called with an unregistered context", -1,
+                                    __FUNCSIG__, __FILE__, __LINE__);
+    }
+    copy_reqs(read_reqs);
+    for (auto &req : read_reqs)
+        ctx.mmap_done->push_back(req.buf);
+}
+
+void MmapAlignedFileReader::get_completions(IOContext &ctx, uint64_t min_completions,
+                                            std::vector<void *> &completed_bufs)
+{
+    std::vector<void *> &done = *ctx.mmap_done;
+    if (done.size() < min_completions)
+    {
+        std::stringstream stream;
+        stream << "get_completions() asked for " << min_completions << " reads but only " << done.size()
+               << " are outstanding";
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    completed_bufs.insert(completed_bufs.end(), done.begin(), done.end());
+    done.clear();
+}
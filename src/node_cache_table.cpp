@@ -0,0 +1,61 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <cstring>
+
+#include "node_cache_table.h"
+
+namespace diskann
+{
+NodeCacheTable::NodeCacheTable(const std::vector<uint32_t> &node_ids, uint64_t coord_bytes, uint64_t max_degree)
+    : _node_ids(node_ids), _coord_bytes(coord_bytes)
+{
+    if (node_ids.size() >= EMPTY_ID)
+    {
+        throw ANNException("NodeCacheTable: too many nodes", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    for (uint32_t node_id : node_ids)
+    {
+        if (node_id == EMPTY_ID)
+        {
+            throw ANNException("NodeCacheTable: invalid node id", -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+    }
+    _slot_len = slot_len(coord_bytes, max_degree);
+
+    uint64_t index_len = 2;
+    uint32_t index_bits = 1;
+    while (index_len < 2 * node_ids.size())
+    {
+        index_len *= 2;
+        index_bits++;
+    }
+    _index_mask = index_len - 1;
+    _index_shift = 64 - index_bits;
+    _index.assign(index_len, IndexEntry{EMPTY_ID, 0});
+    _loaded.reset(new std::atomic<bool>[node_ids.size()]);
+    for (uint32_t slot = 0; slot < node_ids.size(); slot++)
+    {
+        _loaded[slot] = false;
+        uint64_t pos = ((uint64_t)node_ids[slot] * 0x9E3779B97F4A7C15ULL) >> _index_shift;
+        while (_index[pos].node_id != EMPTY_ID && _index[pos].node_id != node_ids[slot])
+            pos = (pos + 1) & _index_mask;
+        // a duplicate id keeps its first slot
+        if (_index[pos].node_id == EMPTY_ID)
+            _index[pos] = IndexEntry{node_ids[slot], slot};
+    }
+
+    // last, as the destructor that frees it does not run if the constructor throws
+    if (!node_ids.empty())
+    {
+        alloc_aligned((void **)&_slots, node_ids.size() * _slot_len, 64);
+        memset(_slots, 0, node_ids.size() * _slot_len);
+    }
+}
+
+NodeCacheTable::~NodeCacheTable()
+{
+    if (_slots != nullptr)
+        aligned_free(_slots);
+}
+} // namespace diskann
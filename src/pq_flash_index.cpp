@@ -4,8 +4,10 @@
 #include "common_includes.h"
 
 #include "timer.h"
+#include "index.h"
 #include "pq_flash_index.h"
 #include "cosine_similarity.h"
+#include "adjacency_codec.h"
 
 #ifdef _WINDOWS
 #include "windows_aligned_file_reader.h"
@@ -28,7 +30,8 @@ namespace diskann
 
 template <typename T, typename LabelT>
 PQFlashIndex<T, LabelT>::PQFlashIndex(std::shared_ptr<AlignedFileReader> &fileReader, diskann::Metric m)
-    : reader(fileReader), metric(m), _thread_data(nullptr)
+    : reader(fileReader), metric(m), _node_cache(new NodeCacheTable(std::vector<uint32_t>(), 0, 0)),
+      _thread_data(nullptr)
 {
     if (m == diskann::Metric::COSINE || m == diskann::Metric::INNER_PRODUCT)
     {
@@ -53,6 +56,11 @@ PQFlashIndex<T, LabelT>::PQFlashIndex(std::shared_ptr<AlignedFileReader> &fileRe
 
 template <typename T, typename LabelT> PQFlashIndex<T, LabelT>::~PQFlashIndex()
 {
+    // the refresher and the background cache loaders write into the cache generations freed below
+    stop_cache_refresh();
+    _stop_cache_load = true;
+    wait_for_cache_load();
+
 #ifndef EXEC_ENV_OLS
     if (data != nullptr)
     {
@@ -62,12 +70,10 @@ template <typename T, typename LabelT> PQFlashIndex<T, LabelT>::~PQFlashIndex()
 
     if (_centroid_data != nullptr)
         aligned_free(_centroid_data);
-    // delete backing bufs for nhood and coord cache
-    if (_nhood_cache_buf != nullptr)
-    {
-        delete[] _nhood_cache_buf;
-        diskann::aligned_free(_coord_cache_buf);
-    }
+    // delete all node cache generations
+    delete _node_cache.load();
+    for (auto &retired : _retired_caches)
+        delete retired.first;
 
     if (_load_flag)
     {
@@ -102,7 +108,36 @@ inline char *PQFlashIndex<T, LabelT>::offset_to_node(char *sector_buf, uint64_t
 
 template <typename T, typename LabelT> inline uint32_t *PQFlashIndex<T, LabelT>::offset_to_node_nhood(char *node_buf)
 {
-    return (unsigned *)(node_buf + _disk_bytes_per_point);
+    return (unsigned *)(node_buf + (_decoupled_layout ? 0 : _disk_bytes_per_point));
+}
+
+template <typename T, typename LabelT>
+inline uint32_t *PQFlashIndex<T, LabelT>::get_node_nbrs(char *node_buf, uint32_t *decode_buf, uint64_t &nnbrs)
+{
+    uint32_t *node_nhood = offset_to_node_nhood(node_buf);
+    nnbrs = *node_nhood;
+    if (!_compressed_adjacency)
+        return node_nhood + 1;
+    decode_adjacency((const uint8_t *)(node_nhood + 1), (const uint8_t *)node_buf + _max_node_len, nnbrs, decode_buf);
+    return decode_buf;
+}
+
+template <typename T, typename LabelT> inline uint64_t PQFlashIndex<T, LabelT>::get_vector_sector(uint64_t node_id)
+{
+    return _vec_start_sector + (_nvecs_per_vec_sector > 0
+                                    ? node_id / _nvecs_per_vec_sector
+                                    : node_id * DIV_ROUND_UP(_disk_bytes_per_point, defaults::SECTOR_LEN));
+}
+
+template <typename T, typename LabelT>
+inline char *PQFlashIndex<T, LabelT>::offset_to_vector(char *sector_buf, uint64_t node_id)
+{
+    return sector_buf + (_nvecs_per_vec_sector == 0 ? 0 : (node_id % _nvecs_per_vec_sector) * _disk_bytes_per_point);
+}
+
+template <typename T, typename LabelT> inline uint32_t PQFlashIndex<T, LabelT>::to_disk_id(uint32_t id)
+{
+    return _id_map_inv.empty() ? id : _id_map_inv[id];
 }
 
 template <typename T, typename LabelT> inline T *PQFlashIndex<T, LabelT>::offset_to_node_coords(char *node_buf)
@@ -123,7 +158,10 @@ void PQFlashIndex<T, LabelT>::setup_thread_data(uint64_t nthreads, uint64_t visi
             SSDThreadData<T> *data = new SSDThreadData<T>(this->_aligned_dim, visited_reserve);
             this->reader->register_thread();
             data->ctx = this->reader->get_ctx();
+            this->reader->register_buffer(data->ctx, data->scratch.sector_scratch,
+                                          defaults::MAX_N_SECTOR_READS * defaults::SECTOR_LEN);
             this->_thread_data.push(data);
+            this->_all_thread_data.push_back(data);
         }
     }
     _load_flag = true;
@@ -133,13 +171,31 @@ template <typename T, typename LabelT>
 std::vector<bool> PQFlashIndex<T, LabelT>::read_nodes(const std::vector<uint32_t> &node_ids,
                                                       std::vector<T *> &coord_buffers,
                                                       std::vector<std::pair<uint32_t, uint32_t *>> &nbr_buffers)
+{
+    // borrow thread data and issue reads
+    ScratchStoreManager<SSDThreadData<T>> manager(this->_thread_data);
+    auto this_thread_data = manager.scratch_space();
+    return read_nodes(node_ids, coord_buffers, nbr_buffers, this_thread_data->ctx);
+}
+
+template <typename T, typename LabelT>
+std::vector<bool> PQFlashIndex<T, LabelT>::read_nodes(const std::vector<uint32_t> &node_ids,
+                                                      std::vector<T *> &coord_buffers,
+                                                      std::vector<std::pair<uint32_t, uint32_t *>> &nbr_buffers,
+                                                      IOContext &ctx)
 {
     std::vector<AlignedRead> read_reqs;
     std::vector<bool> retval(node_ids.size(), true);
 
     char *buf = nullptr;
     auto num_sectors = _nnodes_per_sector > 0 ? 1 : DIV_ROUND_UP(_max_node_len, defaults::SECTOR_LEN);
-    alloc_aligned((void **)&buf, node_ids.size() * num_sectors * defaults::SECTOR_LEN, defaults::SECTOR_LEN);
+    // with the decoupled layout coords need a second read from the vector region
+    uint64_t num_vec_sectors = 0;
+    if (_decoupled_layout)
+        num_vec_sectors = _nvecs_per_vec_sector > 0 ? 1 : DIV_ROUND_UP(_disk_bytes_per_point, defaults::SECTOR_LEN);
+    alloc_aligned((void **)&buf, node_ids.size() * (num_sectors + num_vec_sectors) * defaults::SECTOR_LEN,
+                  defaults::SECTOR_LEN);
+    char *vec_buf = buf + node_ids.size() * num_sectors * defaults::SECTOR_LEN;
 
     // create read requests
     for (size_t i = 0; i < node_ids.size(); ++i)
@@ -152,15 +208,21 @@ std::vector<bool> PQFlashIndex<T, LabelT>::read_nodes(const std::vector<uint32_t
         read.offset = get_node_sector(node_id) * defaults::SECTOR_LEN;
         read_reqs.push_back(read);
     }
+    for (size_t i = 0; i < node_ids.size() && _decoupled_layout; ++i)
+    {
+        if (coord_buffers[i] == nullptr)
+            continue;
+        AlignedRead read;
+        read.len = num_vec_sectors * defaults::SECTOR_LEN;
+        read.buf = vec_buf + i * num_vec_sectors * defaults::SECTOR_LEN;
+        read.offset = get_vector_sector(node_ids[i]) * defaults::SECTOR_LEN;
+        read_reqs.push_back(read);
+    }
 
-    // borrow thread data and issue reads
-    ScratchStoreManager<SSDThreadData<T>> manager(this->_thread_data);
-    auto this_thread_data = manager.scratch_space();
-    IOContext &ctx = this_thread_data->ctx;
     reader->read(read_reqs, ctx);
 
     // copy reads into buffers
-    for (uint32_t i = 0; i < read_reqs.size(); i++)
+    for (uint32_t i = 0; i < node_ids.size(); i++)
     {
 #if defined(_WINDOWS) && defined(USE_BING_INFRA) // this block is to handle failed reads in
                                                  // production settings
@@ -175,16 +237,20 @@ std::vector<bool> PQFlashIndex<T, LabelT>::read_nodes(const std::vector<uint32_t
 
         if (coord_buffers[i] != nullptr)
         {
-            T *node_coords = offset_to_node_coords(node_buf);
+            T *node_coords = _decoupled_layout
+                                 ? (T *)offset_to_vector(vec_buf + i * num_vec_sectors * defaults::SECTOR_LEN,
+                                                         node_ids[i])
+                                 : offset_to_node_coords(node_buf);
             memcpy(coord_buffers[i], node_coords, _disk_bytes_per_point);
         }
 
         if (nbr_buffers[i].second != nullptr)
         {
-            uint32_t *node_nhood = offset_to_node_nhood(node_buf);
-            auto num_nbrs = *node_nhood;
-            nbr_buffers[i].first = num_nbrs;
-            memcpy(nbr_buffers[i].second, node_nhood + 1, num_nbrs * sizeof(uint32_t));
+            uint64_t num_nbrs;
+            uint32_t *node_nbrs = get_node_nbrs(node_buf, nbr_buffers[i].second, num_nbrs);
+            nbr_buffers[i].first = (uint32_t)num_nbrs;
+            if (node_nbrs != nbr_buffers[i].second)
+                memcpy(nbr_buffers[i].second, node_nbrs, num_nbrs * sizeof(uint32_t));
         }
     }
 
@@ -193,57 +259,357 @@ std::vector<bool> PQFlashIndex<T, LabelT>::read_nodes(const std::vector<uint32_t
     return retval;
 }
 
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::set_node_cache_mode(NodeCacheMode mode)
+{
+    if (_node_cache.load()->size() > 0 || _num_active_loaders > 0)
+    {
+        throw ANNException("The node cache mode cannot change once a cache list is loaded", -1, __FUNCSIG__,
+                           __FILE__, __LINE__);
+    }
+    _node_cache_mode = mode;
+}
+
+template <typename T, typename LabelT> uint64_t PQFlashIndex<T, LabelT>::node_cache_bytes_per_node() const
+{
+    // the decoupled layout never reads coords during traversal, so it caches neighbourhoods only
+    uint64_t coord_bytes = _decoupled_layout || _node_cache_mode == NodeCacheMode::GRAPH_ONLY
+                               ? 0
+                               : _aligned_dim * sizeof(T);
+    return NodeCacheTable::slot_len(coord_bytes, _max_degree);
+}
+
+template <typename T, typename LabelT>
+NodeCacheTable *PQFlashIndex<T, LabelT>::layout_cache(const std::vector<uint32_t> &node_list)
+{
+    bool cache_coords = !_decoupled_layout && _node_cache_mode == NodeCacheMode::FULL;
+    return new NodeCacheTable(node_list, cache_coords ? _aligned_dim * sizeof(T) : 0, _max_degree);
+}
+
+template <typename T, typename LabelT>
+uint64_t PQFlashIndex<T, LabelT>::load_cache_slots(NodeCacheTable &cache, uint64_t start, uint64_t end,
+                                                   IOContext &ctx)
+{
+    std::vector<uint32_t> nodes_to_read;
+    std::vector<T *> coord_buffers;
+    std::vector<std::pair<uint32_t, uint32_t *>> nbr_buffers;
+    for (uint64_t slot = start; slot < end; slot++)
+    {
+        nodes_to_read.push_back(cache.node_id(slot));
+        coord_buffers.push_back(cache.has_coords() ? (T *)cache.coords(slot) : nullptr);
+        nbr_buffers.emplace_back(0, cache.nhood(slot) + 1);
+    }
+
+    // issue the reads
+    auto read_status = read_nodes(nodes_to_read, coord_buffers, nbr_buffers, ctx);
+
+    // check for success and publish; a node whose read failed stays a cache miss
+    uint64_t num_loaded = 0;
+    for (size_t i = 0; i < read_status.size(); i++)
+    {
+        if (read_status[i] == true)
+        {
+            *cache.nhood(start + i) = nbr_buffers[i].first;
+            cache.set_loaded(start + i);
+            num_loaded++;
+        }
+    }
+    return num_loaded;
+}
+
+template <typename T, typename LabelT>
+NodeCacheTable *PQFlashIndex<T, LabelT>::pin_node_cache(SSDThreadData<T> *data)
+{
+    // both sequentially consistent: a reclaimer that still sees the thread unpinned
+    // has swapped the pointer before this load
+    data->cache_epoch.store(_cache_epoch.load());
+    return _node_cache.load();
+}
+
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::swap_node_cache(NodeCacheTable *cache)
+{
+    NodeCacheTable *old_cache = _node_cache.exchange(cache);
+    _retired_caches.emplace_back(old_cache, ++_cache_epoch);
+}
+
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::reclaim_node_caches()
+{
+    std::lock_guard<std::mutex> guard(_cache_swap_lock);
+    // background loaders may still be writing into a retired generation
+    if (_retired_caches.empty() || _num_active_loaders > 0)
+        return;
+
+    uint64_t oldest_pin = (std::numeric_limits<uint64_t>::max)();
+    for (auto data : _all_thread_data)
+    {
+        uint64_t epoch = data->cache_epoch.load();
+        if (epoch != 0)
+            oldest_pin = (std::min)(oldest_pin, epoch);
+    }
+    auto still_pinned = std::remove_if(_retired_caches.begin(), _retired_caches.end(),
+                                       [oldest_pin](const std::pair<NodeCacheTable *, uint64_t> &retired) {
+                                           if (retired.second > oldest_pin)
+                                               return false;
+                                           delete retired.first;
+                                           return true;
+                                       });
+    _retired_caches.erase(still_pinned, _retired_caches.end());
+}
+
 template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::load_cache_list(std::vector<uint32_t> &node_list)
 {
     diskann::cout << "Loading the cache list into memory.." << std::flush;
-    size_t num_cached_nodes = node_list.size();
+    NodeCacheTable *cache = layout_cache(node_list);
 
     // borrow thread data
     ScratchStoreManager<SSDThreadData<T>> manager(this->_thread_data);
     auto this_thread_data = manager.scratch_space();
     IOContext &ctx = this_thread_data->ctx;
 
-    // Allocate space for neighborhood cache
-    _nhood_cache_buf = new uint32_t[num_cached_nodes * (_max_degree + 1)];
-    memset(_nhood_cache_buf, 0, num_cached_nodes * (_max_degree + 1));
+    uint64_t num_loaded = 0;
+    size_t BLOCK_SIZE = 8;
+    for (size_t start = 0; start < node_list.size(); start += BLOCK_SIZE)
+        num_loaded += load_cache_slots(*cache, start, (std::min)(node_list.size(), start + BLOCK_SIZE), ctx);
 
-    // Allocate space for coordinate cache
-    size_t coord_cache_buf_len = num_cached_nodes * _aligned_dim;
-    diskann::alloc_aligned((void **)&_coord_cache_buf, coord_cache_buf_len * sizeof(T), 8 * sizeof(T));
-    memset(_coord_cache_buf, 0, coord_cache_buf_len * sizeof(T));
+    std::lock_guard<std::mutex> guard(_cache_swap_lock);
+    swap_node_cache(cache);
+    _num_cache_loaded = num_loaded;
+    diskann::cout << "..done." << std::endl;
+}
 
-    size_t BLOCK_SIZE = 8;
-    size_t num_blocks = DIV_ROUND_UP(num_cached_nodes, BLOCK_SIZE);
-    for (size_t block = 0; block < num_blocks; block++)
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::load_cache_list_async(const std::vector<uint32_t> &node_list, uint32_t num_threads)
+{
+    NodeCacheTable *cache = layout_cache(node_list);
     {
-        size_t start_idx = block * BLOCK_SIZE;
-        size_t end_idx = (std::min)(num_cached_nodes, (block + 1) * BLOCK_SIZE);
+        std::lock_guard<std::mutex> guard(_cache_swap_lock);
+        swap_node_cache(cache);
+        _num_cache_loaded = 0;
+    }
+    diskann::cout << "Loading " << node_list.size() << " cache nodes in the background with " << num_threads
+                  << " threads" << std::endl;
+
+    // each thread has its own IO context and keeps a whole beam's worth of reads in flight
+    auto next_slot = std::make_shared<std::atomic<uint64_t>>(0);
+    num_threads = (std::max)(num_threads, 1u);
+    _num_active_loaders += num_threads;
+    for (uint32_t t = 0; t < num_threads; t++)
+    {
+        _cache_loaders.emplace_back([this, cache, next_slot]() {
+            this->reader->register_thread();
+            IOContext ctx = this->reader->get_ctx();
+            try
+            {
+                const uint64_t batch = defaults::MAX_N_SECTOR_READS;
+                const uint64_t num_slots = cache->size();
+                uint64_t start;
+                while (!_stop_cache_load && (start = next_slot->fetch_add(batch)) < num_slots)
+                    _num_cache_loaded += load_cache_slots(*cache, start, (std::min)(num_slots, start + batch), ctx);
+            }
+            catch (const std::exception &e)
+            {
+                diskann::cerr << "Background cache load stopped: " << e.what() << std::endl;
+            }
+            this->reader->deregister_thread();
+            _num_active_loaders--;
+        });
+    }
+}
+
+template <typename T, typename LabelT> uint64_t PQFlashIndex<T, LabelT>::wait_for_cache_load()
+{
+    for (auto &loader : _cache_loaders)
+        loader.join();
+    _cache_loaders.clear();
+    return _num_cache_loaded;
+}
+
+template <typename T, typename LabelT> uint64_t PQFlashIndex<T, LabelT>::num_cache_nodes_loaded() const
+{
+    return _num_cache_loaded;
+}
 
-        // Copy offset into buffers to read into
-        std::vector<uint32_t> nodes_to_read;
-        std::vector<T *> coord_buffers;
-        std::vector<std::pair<uint32_t, uint32_t *>> nbr_buffers;
-        for (size_t node_idx = start_idx; node_idx < end_idx; node_idx++)
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::save_cache_list(const std::string &path, const std::vector<uint32_t> &node_list)
+{
+    diskann::save_bin<uint32_t>(path, const_cast<uint32_t *>(node_list.data()), node_list.size(), 1);
+}
+
+template <typename T, typename LabelT>
+bool PQFlashIndex<T, LabelT>::read_cache_list(const std::string &path, std::vector<uint32_t> &node_list)
+{
+    if (!file_exists(path))
+        return false;
+    uint32_t *ids = nullptr;
+    size_t num_ids, dim;
+    diskann::load_bin<uint32_t>(path, ids, num_ids, dim);
+    std::unique_ptr<uint32_t[]> ids_holder(ids);
+    if (dim != 1)
+    {
+        throw ANNException("Cache list " + path + " should have one column", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    node_list.assign(ids, ids + num_ids);
+    for (auto id : node_list)
+    {
+        if (id >= _num_points)
         {
-            nodes_to_read.push_back(node_list[node_idx]);
-            coord_buffers.push_back(_coord_cache_buf + node_idx * _aligned_dim);
-            nbr_buffers.emplace_back(0, _nhood_cache_buf + node_idx * (_max_degree + 1));
+            throw ANNException("Cache list " + path + " has node " + std::to_string(id) + " past the end of the index",
+                               -1, __FUNCSIG__, __FILE__, __LINE__);
         }
+    }
+    return true;
+}
 
-        // issue the reads
-        auto read_status = read_nodes(nodes_to_read, coord_buffers, nbr_buffers);
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::start_cache_refresh(uint32_t interval_ms, float decay)
+{
+    if (_cache_refresher.joinable())
+    {
+        throw ANNException("Cache refresh is already running", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    if (interval_ms == 0 || decay < 0 || decay >= 1)
+    {
+        throw ANNException("Cache refresh needs a positive interval and a decay in [0, 1)", -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+    }
 
-        // check for success and insert into the cache.
-        for (size_t i = 0; i < read_status.size(); i++)
+    this->_node_visit_counter.resize(this->_num_points);
+    for (uint32_t i = 0; i < _node_visit_counter.size(); i++)
+    {
+        this->_node_visit_counter[i].first = i;
+        this->_node_visit_counter[i].second = 0;
+    }
+    this->_count_visited_nodes = true;
+    _stop_refresh = false;
+
+    _cache_refresher = std::thread([this, interval_ms, decay]() {
+        this->reader->register_thread();
+        IOContext ctx = this->reader->get_ctx();
+        std::vector<float> scores(this->_num_points, 0.0f);
+        std::unique_lock<std::mutex> guard(_refresh_lock);
+        auto stopped = [this] { return _stop_refresh.load(); };
+        while (!_refresh_cv.wait_for(guard, std::chrono::milliseconds(interval_ms), stopped))
         {
-            if (read_status[i] == true)
+            guard.unlock();
+            try
+            {
+                if (refresh_node_cache(scores, decay, ctx))
+                    _num_cache_refreshes++;
+                reclaim_node_caches();
+            }
+            catch (const std::exception &e)
             {
-                _coord_cache.insert(std::make_pair(nodes_to_read[i], coord_buffers[i]));
-                _nhood_cache.insert(std::make_pair(nodes_to_read[i], nbr_buffers[i]));
+                diskann::cerr << "Cache refresh failed: " << e.what() << std::endl;
             }
+            guard.lock();
+        }
+        guard.unlock();
+        this->reader->deregister_thread();
+    });
+}
+
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::stop_cache_refresh()
+{
+    if (!_cache_refresher.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> guard(_refresh_lock);
+        _stop_refresh = true;
+    }
+    _refresh_cv.notify_all();
+    _cache_refresher.join();
+    this->_count_visited_nodes = false;
+}
+
+template <typename T, typename LabelT> uint64_t PQFlashIndex<T, LabelT>::num_cache_refreshes() const
+{
+    return _num_cache_refreshes;
+}
+
+template <typename T, typename LabelT>
+bool PQFlashIndex<T, LabelT>::refresh_node_cache(std::vector<float> &scores, float decay, IOContext &ctx)
+{
+    for (uint64_t i = 0; i < scores.size(); i++)
+    {
+        uint32_t visits = reinterpret_cast<std::atomic<uint32_t> &>(this->_node_visit_counter[i].second).exchange(0);
+        scores[i] = scores[i] * decay + (float)visits;
+    }
+    // the loaders are still filling the current generation
+    if (_num_active_loaders > 0)
+        return false;
+
+    // only this thread replaces or frees generations while the refresher runs, apart
+    // from a concurrent load_cache_list(), which is checked for before the swap
+    NodeCacheTable *old_cache = _node_cache.load();
+    const uint64_t num_nodes = old_cache->size();
+    if (num_nodes == 0)
+        return false;
+
+    std::vector<uint32_t> hot;
+    for (uint32_t i = 0; i < scores.size(); i++)
+    {
+        if (scores[i] > 0)
+            hot.push_back(i);
+    }
+    if (hot.size() > num_nodes)
+    {
+        std::nth_element(hot.begin(), hot.begin() + num_nodes, hot.end(),
+                         [&scores](uint32_t left, uint32_t right) { return scores[left] > scores[right]; });
+        hot.resize(num_nodes);
+    }
+
+    // loaded nodes that stay are copied from the old generation into the first slots, the
+    // rest are read from disk; too few hot nodes are topped up with cached ones
+    std::vector<uint32_t> next_list, added;
+    std::vector<uint64_t> kept_slots; // old slot of next_list[i]
+    tsl::robin_set<uint32_t> next_set;
+    for (auto id : hot)
+    {
+        next_set.insert(id);
+        int64_t slot = old_cache->find(id);
+        if (slot >= 0 && old_cache->loaded(slot))
+        {
+            next_list.push_back(id);
+            kept_slots.push_back(slot);
+        }
+        else
+        {
+            added.push_back(id);
         }
     }
-    diskann::cout << "..done." << std::endl;
+    if ((float)added.size() < defaults::CACHE_REFRESH_MIN_CHANGE * num_nodes || added.empty())
+        return false;
+    for (uint64_t slot = 0; slot < num_nodes && next_set.size() < num_nodes; slot++)
+    {
+        if (old_cache->loaded(slot) && next_set.insert(old_cache->node_id(slot)).second)
+        {
+            next_list.push_back(old_cache->node_id(slot));
+            kept_slots.push_back(slot);
+        }
+    }
+    next_list.insert(next_list.end(), added.begin(), added.end());
+
+    // both generations have the same slot layout, so kept slots are copied whole
+    std::unique_ptr<NodeCacheTable> next_cache(layout_cache(next_list));
+    for (uint64_t slot = 0; slot < kept_slots.size(); slot++)
+    {
+        memcpy(next_cache->coords(slot), old_cache->coords(kept_slots[slot]), next_cache->slot_len());
+        next_cache->set_loaded(slot);
+    }
+    uint64_t num_loaded = kept_slots.size();
+    const uint64_t batch = defaults::MAX_N_SECTOR_READS;
+    for (uint64_t start = kept_slots.size(); start < next_list.size(); start += batch)
+    {
+        if (_stop_refresh)
+            return false;
+        num_loaded += load_cache_slots(*next_cache, start, (std::min)((uint64_t)next_list.size(), start + batch), ctx);
+    }
+
+    std::lock_guard<std::mutex> guard(_cache_swap_lock);
+    if (_node_cache.load() != old_cache)
+        return false;
+    swap_node_cache(next_cache.release());
+    _num_cache_loaded = num_loaded;
+    return true;
 }
 
 #ifdef EXEC_ENV_OLS
@@ -271,6 +637,11 @@ void PQFlashIndex<T, LabelT>::generate_cache_list_from_sample_queries(std::strin
         }
         return;
     }
+    if (_cache_refresher.joinable())
+    {
+        throw ANNException("Cannot generate a cache list while the cache refresh is running", -1, __FUNCSIG__,
+                           __FILE__, __LINE__);
+    }
 
     this->_count_visited_nodes = true;
     this->_node_visit_counter.clear();
@@ -812,10 +1183,48 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
 
     this->_num_points = npts_u64;
     this->_n_chunks = nchunks_u64;
+
+#ifndef EXEC_ENV_OLS
+    // index written with a locality layout: node ids inside the index are disk ids
+    std::string locality_map_file = std::string(_disk_index_file) + "_locality_map.bin";
+    if (file_exists(locality_map_file))
+    {
+        uint32_t *map_data = nullptr;
+        size_t map_num, map_dim;
+        diskann::load_bin<uint32_t>(locality_map_file, map_data, map_num, map_dim);
+        if (map_num != _num_points || map_dim != 1)
+        {
+            delete[] map_data;
+            throw ANNException("Locality map does not match the number of points in the index", -1, __FUNCSIG__,
+                               __FILE__, __LINE__);
+        }
+        _id_map.assign(map_data, map_data + map_num);
+        delete[] map_data;
+        _id_map_inv.resize(_num_points);
+        for (uint64_t i = 0; i < _num_points; i++)
+            _id_map_inv[_id_map[i]] = (uint32_t)i;
+
+        // PQ codes are stored by original id; lay them out by disk id
+        uint8_t *disk_order_data = new uint8_t[_num_points * _n_chunks];
+        for (uint64_t i = 0; i < _num_points; i++)
+            memcpy(disk_order_data + i * _n_chunks, this->data + (uint64_t)_id_map[i] * _n_chunks, _n_chunks);
+        delete[] this->data;
+        this->data = disk_order_data;
+        diskann::cout << "Loaded locality map from " << locality_map_file << std::endl;
+    }
+#endif
+
     if (file_exists(labels_file))
     {
         parse_label_file(labels_file, num_pts_in_label_file);
         assert(num_pts_in_label_file == this->_num_points);
+        if (!_id_map.empty())
+        {
+            // label lists stay where they are; only the per-point offsets move
+            std::vector<uint32_t> orig_offsets(_pts_to_label_offsets, _pts_to_label_offsets + _num_points);
+            for (uint64_t i = 0; i < _num_points; i++)
+                _pts_to_label_offsets[i] = orig_offsets[_id_map[i]];
+        }
         _label_map = load_label_map(labels_map_file);
         if (file_exists(labels_to_medoids))
         {
@@ -837,7 +1246,7 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
                         if (cnt == 0)
                             label = (LabelT)std::stoul(token);
                         else
-                            medoids.push_back((uint32_t)stoul(token));
+                            medoids.push_back(to_disk_id((uint32_t)stoul(token)));
                         cnt++;
                     }
                     _filter_to_medoid_ids[label].swap(medoids);
@@ -874,9 +1283,9 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
                 while (std::getline(iss, token, ','))
                 {
                     if (cnt == 0)
-                        dummy_id = (uint32_t)stoul(token);
+                        dummy_id = to_disk_id((uint32_t)stoul(token));
                     else
-                        real_id = (uint32_t)stoul(token);
+                        real_id = to_disk_id((uint32_t)stoul(token));
                     cnt++;
                 }
                 _dummy_pts.insert(dummy_id);
@@ -893,6 +1302,27 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
         }
     }
 
+    uint64_t bitmap_words = DIV_ROUND_UP(_num_points, 64);
+    _delete_bitmap.reset(new std::atomic<uint64_t>[bitmap_words]);
+    for (uint64_t w = 0; w < bitmap_words; w++)
+        _delete_bitmap[w] = 0;
+    _num_deleted = 0;
+#ifndef EXEC_ENV_OLS
+    std::string deleted_ids_file = std::string(_disk_index_file) + "_deleted_ids.bin";
+    if (file_exists(deleted_ids_file))
+    {
+        std::unique_ptr<uint32_t[]> deleted_ids;
+        size_t num_deleted_ids, deleted_ids_dim;
+        diskann::load_bin<uint32_t>(deleted_ids_file, deleted_ids, num_deleted_ids, deleted_ids_dim);
+        for (size_t i = 0; i < num_deleted_ids; i++)
+        {
+            if (deleted_ids[i] < _num_points)
+                mark_deleted(to_disk_id(deleted_ids[i]));
+        }
+        diskann::cout << "Loaded " << _num_deleted << " deleted points from " << deleted_ids_file << std::endl;
+    }
+#endif
+
 #ifdef EXEC_ENV_OLS
     _pq_table.load_pq_centroid_bin(files, pq_table_bin.c_str(), nchunks_u64);
 #else
@@ -974,15 +1404,6 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
     READ_U64(index_metadata, _nnodes_per_sector);
     _max_degree = ((_max_node_len - _disk_bytes_per_point) / sizeof(uint32_t)) - 1;
 
-    if (_max_degree > defaults::MAX_GRAPH_DEGREE)
-    {
-        std::stringstream stream;
-        stream << "Error loading index. Ensure that max graph degree (R) does "
-                  "not exceed "
-               << defaults::MAX_GRAPH_DEGREE << std::endl;
-        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
-    }
-
     // setting up concept of frozen points in disk index for streaming-DiskANN
     READ_U64(index_metadata, this->_num_frozen_points);
     uint64_t file_frozen_id;
@@ -1009,6 +1430,46 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
         READ_U64(index_metadata, this->_nvecs_per_sector);
     }
 
+    // optional layout extension after the file size:
+    // [layout_flags][max_degree][vec_start_sector][vec_len]
+    uint32_t n_fields_read = this->_reorder_data_exists ? 11 : 8;
+    if (nr > n_fields_read + 1)
+    {
+        uint64_t file_size_on_header, layout_flags, vec_len;
+        READ_U64(index_metadata, file_size_on_header);
+        READ_U64(index_metadata, layout_flags);
+        READ_U64(index_metadata, _max_degree);
+        READ_U64(index_metadata, _vec_start_sector);
+        READ_U64(index_metadata, vec_len);
+        _decoupled_layout = (layout_flags & DISK_LAYOUT_DECOUPLED) != 0;
+        _compressed_adjacency = (layout_flags & DISK_LAYOUT_COMPRESSED_ADJACENCY) != 0;
+        if (_compressed_adjacency)
+            diskann::cout << "Neighbour lists are compressed" << std::endl;
+        if (_decoupled_layout)
+        {
+            if (vec_len != _disk_bytes_per_point)
+            {
+                std::stringstream stream;
+                stream << "Vector length in decoupled disk index (" << vec_len
+                       << "B) does not match the expected point size (" << _disk_bytes_per_point << "B)"
+                       << std::endl;
+                throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+            }
+            _nvecs_per_vec_sector = defaults::SECTOR_LEN / vec_len;
+            diskann::cout << "Decoupled layout: vectors start at sector " << _vec_start_sector << ", "
+                          << _nvecs_per_vec_sector << " per sector" << std::endl;
+        }
+    }
+
+    if (_max_degree > defaults::MAX_GRAPH_DEGREE)
+    {
+        std::stringstream stream;
+        stream << "Error loading index. Ensure that max graph degree (R) does "
+                  "not exceed "
+               << defaults::MAX_GRAPH_DEGREE << std::endl;
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
     diskann::cout << "Disk-Index File Meta-data: ";
     diskann::cout << "# nodes per sector: " << _nnodes_per_sector;
     diskann::cout << ", max node len (bytes): " << _max_node_len;
@@ -1023,6 +1484,11 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
 #ifndef EXEC_ENV_OLS
     // open AlignedFileReader handle to index_file
     std::string index_fname(_disk_index_file);
+    if (file_exists(index_fname + "_stripes.txt") && !reader->reads_striped_files())
+    {
+        throw ANNException(index_fname + " is striped across several files; load it with StripedAlignedFileReader",
+                           -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
     reader->open(index_fname);
     this->setup_thread_data(num_threads);
     this->_max_nthreads = num_threads;
@@ -1049,6 +1515,8 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
                    << std::endl;
             throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
         }
+        for (size_t i = 0; i < _num_medoids; i++)
+            _medoids[i] = to_disk_id(_medoids[i]);
 #ifdef EXEC_ENV_OLS
         if (!files.fileExists(centroids_file))
         {
@@ -1102,6 +1570,35 @@ int PQFlashIndex<T, LabelT>::load_from_separate_paths(uint32_t num_threads, cons
         diskann::cout << "Setting re-scaling factor of base vectors to " << this->_max_base_norm << std::endl;
         delete[] norm_val;
     }
+
+#ifndef EXEC_ENV_OLS
+    std::string nav_index_file = std::string(_disk_index_file) + "_nav.index";
+    std::string nav_ids_file = nav_index_file + "_ids.bin";
+    if (file_exists(nav_index_file) && file_exists(nav_ids_file))
+    {
+        uint32_t *nav_ids = nullptr;
+        size_t nav_num, nav_ids_dim;
+        diskann::load_bin<uint32_t>(nav_ids_file, nav_ids, nav_num, nav_ids_dim);
+        _nav_to_disk_id.resize(nav_num);
+        for (size_t i = 0; i < nav_num; i++)
+        {
+            if (nav_ids[i] >= _num_points)
+            {
+                delete[] nav_ids;
+                throw ANNException("Navigation graph refers to a point outside the index", -1, __FUNCSIG__, __FILE__,
+                                   __LINE__);
+            }
+            _nav_to_disk_id[i] = to_disk_id(nav_ids[i]);
+        }
+        delete[] nav_ids;
+
+        _nav_index = std::make_unique<Index<T, uint32_t, uint32_t>>(diskann::Metric::L2, _data_dim, 0, nullptr, nullptr,
+                                                                   0, false, false, false, false, 0, false);
+        _nav_index->load(nav_index_file.c_str(), num_threads, _nav_search_l);
+        diskann::cout << "Loaded navigation graph over " << nav_num << " points from " << nav_index_file
+                      << std::endl;
+    }
+#endif
     diskann::cout << "done.." << std::endl;
     return 0;
 }
@@ -1178,6 +1675,31 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                                                  const uint32_t io_limit, const bool use_reorder_data,
                                                  QueryStats *stats)
 {
+    beam_search(query1, k_search, l_search, indices, distances, beam_width, use_filter, filter_label, io_limit,
+                use_reorder_data, stats, nullptr);
+}
+
+template <typename T, typename LabelT>
+bool PQFlashIndex<T, LabelT>::cached_beam_search_with_deadline(const T *query1, const uint64_t k_search,
+                                                               const uint64_t l_search, uint64_t *indices,
+                                                               float *distances, const uint64_t beam_width,
+                                                               const SearchBudget &budget,
+                                                               const bool use_reorder_data, QueryStats *stats)
+{
+    LabelT dummy_filter = 0;
+    return beam_search(query1, k_search, l_search, indices, distances, beam_width, false, dummy_filter,
+                       std::numeric_limits<uint32_t>::max(), use_reorder_data, stats,
+                       budget.latency_us > 0 ? &budget : nullptr);
+}
+
+template <typename T, typename LabelT>
+bool PQFlashIndex<T, LabelT>::beam_search(const T *query1, const uint64_t k_search, const uint64_t l_search,
+                                          uint64_t *indices, float *distances, const uint64_t beam_width,
+                                          const bool use_filter, const LabelT &filter_label, const uint32_t io_limit,
+                                          const bool use_reorder_data, QueryStats *stats, const SearchBudget *budget,
+                                          RangeSearchState *range, SearchCursor *cursor)
+{
+    Timer budget_timer;
     int32_t filter_num = 0;
     if (use_filter)
     {
@@ -1186,7 +1708,7 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
         {
             if (!_use_universal_label)
             {
-                return;
+                return false;
             }
             else
             {
@@ -1205,44 +1727,49 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
     IOContext &ctx = data->ctx;
     auto query_scratch = &(data->scratch);
     auto pq_query_scratch = query_scratch->_pq_scratch;
+    // unpinned when the manager returns the scratch
+    NodeCacheTable *node_cache = pin_node_cache(data);
 
     // reset query scratch
     query_scratch->reset();
 
-    // copy query to thread specific aligned and allocated memory (for distance
-    // calculations we need aligned data)
-    float query_norm = 0;
-    T *aligned_query_T = query_scratch->aligned_query_T;
-    float *query_float = pq_query_scratch->aligned_query_float;
-    float *query_rotated = pq_query_scratch->rotated_query;
-
-    // if inner product, we laso normalize the query and set the last coordinate
-    // to 0 (this is the extra coordindate used to convert MIPS to L2 search)
-    if (metric == diskann::Metric::INNER_PRODUCT)
+    // rerank prefetches land in the scratch; it must not go back to the pool with any in flight,
+    // which finish_search() sees to unless the search throws first
+    struct RerankPrefetchGuard
     {
-        for (size_t i = 0; i < this->_data_dim - 1; i++)
+        PQFlashIndex<T, LabelT> *index;
+        SSDThreadData<T> *data;
+        ~RerankPrefetchGuard()
         {
-            aligned_query_T[i] = query1[i];
-            query_norm += query1[i] * query1[i];
+            if (data->scratch.rerank_inflight > 0)
+            {
+                index->drain_aborted_reads(data->ctx, data->scratch.rerank_inflight);
+                data->scratch.rerank_inflight = 0;
+            }
         }
-        aligned_query_T[this->_data_dim - 1] = 0;
+    } prefetch_guard{this, data};
 
-        query_norm = std::sqrt(query_norm);
-
-        for (size_t i = 0; i < this->_data_dim - 1; i++)
+    // a cursor's state lives in the scratch for the duration of the call
+    struct CursorStateGuard
+    {
+        SearchCursor *cursor;
+        SSDQueryScratch<T> *scratch;
+        ~CursorStateGuard()
         {
-            aligned_query_T[i] = (T)(aligned_query_T[i] / query_norm);
+            if (cursor != nullptr)
+                cursor->swap_state(*scratch);
         }
-        pq_query_scratch->set(this->_data_dim, aligned_query_T);
-    }
-    else
-    {
-        for (size_t i = 0; i < this->_data_dim; i++)
-        {
-            aligned_query_T[i] = query1[i];
-        }
-        pq_query_scratch->set(this->_data_dim, aligned_query_T);
-    }
+    } cursor_guard{cursor, query_scratch};
+    if (cursor != nullptr)
+        cursor->swap_state(*query_scratch);
+    const bool resumed = cursor != nullptr && cursor->_started;
+
+    // copy query to thread specific aligned and allocated memory (for distance
+    // calculations we need aligned data)
+    float query_norm = preprocess_query(query1, query_scratch, stats);
+    T *aligned_query_T = query_scratch->aligned_query_T;
+    float *query_float = pq_query_scratch->aligned_query_float;
+    float *pq_dists = pq_query_scratch->aligned_pqtable_dist_scratch;
 
     // pointers to buffers for data
     T *data_buf = query_scratch->coord_scratch;
@@ -1254,18 +1781,6 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
     const uint64_t num_sectors_per_node =
         _nnodes_per_sector > 0 ? 1 : DIV_ROUND_UP(_max_node_len, defaults::SECTOR_LEN);
 
-    Timer pqdist_timer, sort_timer;
-
-    // query <-> PQ chunk centers distances
-    pqdist_timer.reset();
-    _pq_table.preprocess_query(query_rotated); // center the query and rotate if
-                                               // we have a rotation matrix
-    float *pq_dists = pq_query_scratch->aligned_pqtable_dist_scratch;
-    _pq_table.populate_chunk_distances(query_rotated, pq_dists);
-    if (stats != nullptr) {
-        stats->pqdist_us += (float)pqdist_timer.elapsed();
-    }
-
     // query <-> neighbor list
     float *dist_scratch = pq_query_scratch->aligned_dist_scratch;
     uint8_t *pq_coord_scratch = pq_query_scratch->aligned_pq_coord_scratch;
@@ -1276,13 +1791,49 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
         diskann::aggregate_coords(ids, n_ids, this->data, this->_n_chunks, pq_coord_scratch);
         diskann::pq_dist_lookup(pq_coord_scratch, n_ids, this->_n_chunks, pq_dists, dists_out);
     };
+
+    // distance recorded in full_retset for an expanded node; the decoupled layout has
+    // no coords next to the node, and a graph-only cache no coords for its nodes, so
+    // their PQ distance stands in until the final rerank
+    auto expanded_dist = [&](uint32_t id, T *aligned_coords) {
+        float dist;
+        if (_decoupled_layout || aligned_coords == nullptr)
+        {
+            compute_dists(&id, 1, &dist);
+            if (!_decoupled_layout)
+                query_scratch->pq_scored.insert(id);
+        }
+        else if (!_use_disk_index_pq)
+            dist = _dist_cmp->compare(aligned_query_T, aligned_coords, (uint32_t)_aligned_dim);
+        else if (metric == diskann::Metric::INNER_PRODUCT)
+            dist = _disk_pq_table.inner_product(query_float, (uint8_t *)aligned_coords);
+        else // disk_pq does not support OPQ yet
+            dist = _disk_pq_table.l2_distance(query_float, (uint8_t *)aligned_coords);
+        return dist;
+    };
     Timer query_timer, io_timer, cpu_timer;
 
     tsl::robin_set<uint64_t> &visited = query_scratch->visited;
     NeighborPriorityQueue &retset = query_scratch->retset;
-    retset.reserve(l_search);
+    retset.reserve(deleted_overfetch_l(l_search));
     std::vector<Neighbor> &full_retset = query_scratch->full_retset;
 
+    // range and cursor searches grow retset as they go, so what falls off it meanwhile is kept
+    std::vector<Neighbor> &retset_overflow = query_scratch->retset_overflow;
+    auto insert_candidate = [&](const Neighbor &nbr) {
+        if (range != nullptr || cursor != nullptr)
+            retset.insert(nbr, retset_overflow);
+        else
+            retset.insert(nbr);
+    };
+    if (resumed)
+    {
+        std::vector<Neighbor> dropped;
+        dropped.swap(retset_overflow);
+        for (auto &nbr : dropped)
+            retset.insert(nbr, retset_overflow);
+    }
+
     uint32_t best_medoid = 0;
     float best_dist = (std::numeric_limits<float>::max)();
     if (!use_filter)
@@ -1355,8 +1906,71 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
 
     //! =================
     
-    retset.insert(Neighbor(best_medoid, dist_scratch[0]));
-    visited.insert(best_medoid);
+    // the navigation graph, when there is one, replaces the medoid as entry point; a
+    // resumed cursor already has its candidates
+    if (!resumed && (use_filter || !seed_from_nav_graph(query_scratch, stats)))
+    {
+        retset.insert(Neighbor(best_medoid, dist_scratch[0]));
+        visited.insert(best_medoid);
+    }
+
+    // scores (and in EXPAND mode expands) the other nodes in the sector read for `read_id`
+    auto process_co_resident = [&](char *sector_buf, uint32_t read_id) {
+        uint64_t first_id = (read_id / _nnodes_per_sector) * _nnodes_per_sector;
+        uint64_t last_id = (std::min)(first_id + _nnodes_per_sector, _num_points);
+        for (uint64_t co_id = first_id; co_id < last_id; co_id++)
+        {
+            uint32_t id = (uint32_t)co_id;
+            if (id == read_id || !query_scratch->full_scored.insert(id).second)
+                continue;
+            if (_dummy_pts.find(id) != _dummy_pts.end() || is_deleted(id) ||
+                (use_filter && !point_has_label(id, filter_num) && !point_has_label(id, _universal_filter_num)))
+                continue;
+
+            char *node_disk_buf = offset_to_node(sector_buf, id);
+            if (!_decoupled_layout)
+                memcpy(data_buf, offset_to_node_coords(node_disk_buf), _disk_bytes_per_point);
+            float dist = expanded_dist(id, data_buf);
+            full_retset.push_back(Neighbor(id, dist));
+            if (stats != nullptr)
+                stats->n_resident_scored++;
+
+            bool promising = retset.size() < retset.capacity() || dist < retset[retset.size() - 1].distance;
+            if (!promising)
+                continue;
+            if (_co_resident_mode == CoResidentMode::SCORE)
+            {
+                if (visited.insert(id).second)
+                    insert_candidate(Neighbor(id, dist));
+                continue;
+            }
+
+            // EXPAND: walk its neighbourhood now; it is never read on its own
+            visited.insert(id);
+            query_scratch->expanded_in_place.insert(id);
+            uint64_t nnbrs;
+            uint32_t *node_nbrs = get_node_nbrs(node_disk_buf, query_scratch->nbr_scratch.data(), nnbrs);
+            compute_dists(node_nbrs, nnbrs, dist_scratch);
+            for (uint64_t m = 0; m < nnbrs; ++m)
+            {
+                uint32_t nbr_id = node_nbrs[m];
+                if (visited.insert(nbr_id).second)
+                {
+                    if (!use_filter && _dummy_pts.find(nbr_id) != _dummy_pts.end())
+                        continue;
+                    if (use_filter && !point_has_label(nbr_id, filter_num) &&
+                        !point_has_label(nbr_id, _universal_filter_num))
+                        continue;
+                    insert_candidate(Neighbor(nbr_id, dist_scratch[m]));
+                }
+            }
+            if (stats != nullptr)
+            {
+                stats->n_resident_expanded++;
+                stats->n_cmps += (uint32_t)nnbrs;
+            }
+        }
+    };
 
     uint32_t cmps = 0;
     uint32_t hops = 0;
@@ -1369,8 +1983,11 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
     frontier_nhoods.reserve(2 * beam_width);
     std::vector<AlignedRead> frontier_read_reqs;
     frontier_read_reqs.reserve(2 * beam_width);
-    std::vector<std::pair<uint32_t, std::pair<uint32_t, uint32_t *>>> cached_nhoods;
+    std::vector<std::pair<uint32_t, uint64_t>> cached_nhoods; // node id, node cache slot
     cached_nhoods.reserve(2 * beam_width);
+    // frontier sectors another query is already reading, with the read we would have issued
+    std::vector<std::pair<std::shared_ptr<ReadSingleFlight::Flight>, AlignedRead>> joined_flights;
+    std::vector<AlignedRead> fallback_read_reqs;
 
     int cur = 0;
     // if (stats != nullptr) {
@@ -1382,24 +1999,93 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
 
     std::string iter_ids = "";
 
-    while (retset.has_unexpanded_node() && num_ios < io_limit)
+    // rerank vectors of settled candidates are read while the last hops run; needs a
+    // reader with submit_reqs()
+#ifndef _WINDOWS
+    const bool prefetch_rerank = _decoupled_layout || (use_reorder_data && _reorder_data_exists);
+#else
+    const bool prefetch_rerank = false;
+#endif
+    std::vector<uint32_t> prev_topk;
+
+    // see set_adaptive_beam(); a range search widens max_beam_width as its list grows
+    uint64_t max_beam_width = beam_width;
+    uint64_t cur_beam_width =
+        _adaptive_min_beam_width > 0 ? (std::min)((uint64_t)_adaptive_min_beam_width, beam_width) : beam_width;
+    float best_kth_dist = (std::numeric_limits<float>::max)();
+    uint32_t hops_without_gain = 0;
+
+    // deadline bookkeeping: running estimates of a hop's wall time and of its read wait,
+    // which also stands in for the round trip of the rerank reads
+    const bool will_rerank =
+        _decoupled_layout || use_reorder_data || (node_cache->size() > 0 && !node_cache->has_coords());
+    float hop_us_est = 0, hop_io_us_est = 0;
+    bool truncated = false;
+    Timer hop_timer;
+
+    // range search: once the list has converged, keep going with a list twice as long if at
+    // least half of the current one is in range, picking up where the search stands
+    auto grow_range_list = [&]() {
+        uint64_t in_range = 0;
+        for (auto &nbr : full_retset)
+            in_range += nbr.distance <= (float)range->range ? 1 : 0;
+        if (in_range < range->l_search / 2 || range->l_search * 2 > range->max_l_search)
+            return false;
+        range->l_search *= 2;
+        max_beam_width = (std::max)(range->min_beam_width, range->l_search / 5);
+        max_beam_width = (std::min)({max_beam_width, (uint64_t)100,
+                                     defaults::MAX_N_SECTOR_READS / num_sectors_per_node});
+        cur_beam_width = max_beam_width;
+        retset.reserve(deleted_overfetch_l(range->l_search));
+        std::vector<Neighbor> dropped;
+        dropped.swap(retset_overflow);
+        for (auto &nbr : dropped)
+            retset.insert(nbr, retset_overflow);
+        return retset.has_unexpanded_node();
+    };
+
+    while ((retset.has_unexpanded_node() || (range != nullptr && grow_range_list())) && num_ios < io_limit)
     {
+        if (budget != nullptr && hops > 0)
+        {
+            float reserve_us = hop_us_est;
+            if (budget->policy == BudgetPolicy::RERANK && will_rerank)
+                reserve_us += hop_io_us_est;
+            if ((float)budget_timer.elapsed() + reserve_us > (float)budget->latency_us)
+            {
+                truncated = true;
+                break;
+            }
+        }
+        hop_timer.reset();
+        float hop_io_us = 0;
+
         // clear iteration state
         frontier.clear();
         frontier_nhoods.clear();
         frontier_read_reqs.clear();
         cached_nhoods.clear();
+        joined_flights.clear();
         sector_scratch_idx = 0;
         // find new beam
         uint32_t num_seen = 0;
-        while (retset.has_unexpanded_node() && frontier.size() < beam_width && num_seen < beam_width)
+        while (retset.has_unexpanded_node() && frontier.size() < cur_beam_width && num_seen < cur_beam_width)
         {
             auto nbr = retset.closest_unexpanded();
+            if (_co_resident_mode == CoResidentMode::EXPAND &&
+                query_scratch->expanded_in_place.find(nbr.id) != query_scratch->expanded_in_place.end())
+            {
+                if (stats != nullptr)
+                    stats->n_resident_ios_saved++;
+                continue;
+            }
             num_seen++;
-            auto iter = _nhood_cache.find(nbr.id);
-            if (iter != _nhood_cache.end())
+            int64_t cache_slot = node_cache->find(nbr.id);
+            if (cache_slot >= 0 && node_cache->loaded(cache_slot))
             {
-                cached_nhoods.push_back(std::make_pair(nbr.id, iter->second));
+                // processed after the frontier reads are issued, so the slot has time to arrive
+                node_cache->prefetch(cache_slot);
+                cached_nhoods.push_back(std::make_pair(nbr.id, (uint64_t)cache_slot));
                 if (stats != nullptr)
                 {
                     stats->n_cache_hits++;
@@ -1446,7 +2132,26 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                 fnhood.second = sector_scratch + num_sectors_per_node * sector_scratch_idx * defaults::SECTOR_LEN;
                 sector_scratch_idx++;
                 frontier_nhoods.push_back(fnhood);
-                frontier_read_reqs.emplace_back(get_node_sector((size_t)id) * defaults::SECTOR_LEN,
+                uint64_t sector = get_node_sector((size_t)id);
+                if (_sector_cache != nullptr && _sector_cache->lookup(sector, fnhood.second))
+                {
+                    if (stats != nullptr)
+                        stats->n_sector_cache_hits++;
+                    continue;
+                }
+                if (_single_flight != nullptr)
+                {
+                    auto flight = _single_flight->join(sector);
+                    if (flight != nullptr)
+                    {
+                        joined_flights.emplace_back(std::move(flight),
+                                                    AlignedRead(sector * defaults::SECTOR_LEN,
+                                                                num_sectors_per_node * defaults::SECTOR_LEN,
+                                                                fnhood.second));
+                        continue;
+                    }
+                }
+                frontier_read_reqs.emplace_back(sector * defaults::SECTOR_LEN,
                                                 num_sectors_per_node * defaults::SECTOR_LEN, fnhood.second);
                 if (stats != nullptr)
                 {
@@ -1455,41 +2160,97 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                 }
                 num_ios++;
             }
-            io_timer.reset();
+            if (!frontier_read_reqs.empty())
+            {
+                io_timer.reset();
 #ifdef USE_BING_INFRA
-            reader->read(frontier_read_reqs, ctx,
-                         true); // asynhronous reader for Bing.
+                reader->read(frontier_read_reqs, ctx,
+                             true); // asynhronous reader for Bing.
 #else
-            reader->read(frontier_read_reqs, ctx); // synchronous IO linux
+                try
+                {
+                    if (query_scratch->rerank_inflight > 0)
+                        read_around_prefetches(data, frontier_read_reqs);
+                    else
+                        reader->read(frontier_read_reqs, ctx); // synchronous IO linux
+                }
+                catch (...)
+                {
+                    // release anyone waiting on our reads; they fall back to reading themselves
+                    if (_single_flight != nullptr)
+                    {
+                        for (auto &req : frontier_read_reqs)
+                            _single_flight->land(req.offset / defaults::SECTOR_LEN, nullptr);
+                    }
+                    throw;
+                }
 #endif
-            if (stats != nullptr)
+                hop_io_us += (float)io_timer.elapsed();
+                if (stats != nullptr)
+                {
+                    stats->io_us += (float)io_timer.elapsed();
+                }
+                // land our own reads before waiting on other queries' ones
+                if (_single_flight != nullptr)
+                {
+                    for (auto &req : frontier_read_reqs)
+                        _single_flight->land(req.offset / defaults::SECTOR_LEN, (char *)req.buf);
+                }
+                if (_sector_cache != nullptr)
+                {
+                    for (auto &req : frontier_read_reqs)
+                        _sector_cache->insert(req.offset / defaults::SECTOR_LEN, (char *)req.buf);
+                }
+            }
+            if (!joined_flights.empty())
             {
-                stats->io_us += (float)io_timer.elapsed();
+                io_timer.reset();
+                fallback_read_reqs.clear();
+                for (auto &joined : joined_flights)
+                {
+                    if (_single_flight->wait(joined.first, (char *)joined.second.buf))
+                    {
+                        if (stats != nullptr)
+                            stats->n_dedup_reads++;
+                    }
+                    else
+                    {
+                        fallback_read_reqs.push_back(joined.second);
+                    }
+                }
+                if (!fallback_read_reqs.empty())
+                {
+                    if (query_scratch->rerank_inflight > 0)
+                        read_around_prefetches(data, fallback_read_reqs);
+                    else
+                        reader->read(fallback_read_reqs, ctx);
+                    if (stats != nullptr)
+                    {
+                        stats->n_4k += (unsigned)fallback_read_reqs.size();
+                        stats->n_ios += (unsigned)fallback_read_reqs.size();
+                    }
+                }
+                hop_io_us += (float)io_timer.elapsed();
+                if (stats != nullptr)
+                {
+                    stats->io_us += (float)io_timer.elapsed();
+                }
             }
         }
 
         // process cached nhoods
         for (auto &cached_nhood : cached_nhoods)
         {
-            auto global_cache_iter = _coord_cache.find(cached_nhood.first);
-            T *node_fp_coords_copy = global_cache_iter->second;
-            float cur_expanded_dist;
-            if (!_use_disk_index_pq)
-            {
-                cur_expanded_dist = _dist_cmp->compare(aligned_query_T, node_fp_coords_copy, (uint32_t)_aligned_dim);
-            }
-            else
-            {
-                if (metric == diskann::Metric::INNER_PRODUCT)
-                    cur_expanded_dist = _disk_pq_table.inner_product(query_float, (uint8_t *)node_fp_coords_copy);
-                else
-                    cur_expanded_dist = _disk_pq_table.l2_distance( // disk_pq does not support OPQ yet
-                        query_float, (uint8_t *)node_fp_coords_copy);
-            }
-            full_retset.push_back(Neighbor((uint32_t)cached_nhood.first, cur_expanded_dist));
+            T *node_fp_coords_copy = node_cache->has_coords() ? (T *)node_cache->coords(cached_nhood.second) : nullptr;
+            float cur_expanded_dist = expanded_dist(cached_nhood.first, node_fp_coords_copy);
+            if ((_co_resident_mode == CoResidentMode::NONE ||
+                 query_scratch->full_scored.insert(cached_nhood.first).second) &&
+                !is_deleted(cached_nhood.first))
+                full_retset.push_back(Neighbor((uint32_t)cached_nhood.first, cur_expanded_dist));
 
-            uint64_t nnbrs = cached_nhood.second.first;
-            uint32_t *node_nbrs = cached_nhood.second.second;
+            uint32_t *cached_node_nhood = node_cache->nhood(cached_nhood.second);
+            uint64_t nnbrs = *cached_node_nhood;
+            uint32_t *node_nbrs = cached_node_nhood + 1;
 
             // compute node_nbrs <-> query dists in PQ space
             cpu_timer.reset();
@@ -1517,7 +2278,7 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                     cmps++;
                     float dist = dist_scratch[m];
                     Neighbor nn(id, dist);
-                    retset.insert(nn);
+                    insert_candidate(nn);
                 }
             }
         }
@@ -1537,24 +2298,18 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
         {
 #endif
             char *node_disk_buf = offset_to_node(frontier_nhood.second, frontier_nhood.first);
-            uint32_t *node_buf = offset_to_node_nhood(node_disk_buf);
-            uint64_t nnbrs = (uint64_t)(*node_buf);
-            T *node_fp_coords = offset_to_node_coords(node_disk_buf);
-            memcpy(data_buf, node_fp_coords, _disk_bytes_per_point);
-            float cur_expanded_dist;
-            if (!_use_disk_index_pq)
-            {
-                cur_expanded_dist = _dist_cmp->compare(aligned_query_T, data_buf, (uint32_t)_aligned_dim);
-            }
-            else
+            uint64_t nnbrs;
+            uint32_t *node_nbrs = get_node_nbrs(node_disk_buf, query_scratch->nbr_scratch.data(), nnbrs);
+            if (!_decoupled_layout)
             {
-                if (metric == diskann::Metric::INNER_PRODUCT)
-                    cur_expanded_dist = _disk_pq_table.inner_product(query_float, (uint8_t *)data_buf);
-                else
-                    cur_expanded_dist = _disk_pq_table.l2_distance(query_float, (uint8_t *)data_buf);
+                T *node_fp_coords = offset_to_node_coords(node_disk_buf);
+                memcpy(data_buf, node_fp_coords, _disk_bytes_per_point);
             }
-            full_retset.push_back(Neighbor(frontier_nhood.first, cur_expanded_dist));
-            uint32_t *node_nbrs = (node_buf + 1);
+            float cur_expanded_dist = expanded_dist(frontier_nhood.first, data_buf);
+            if ((_co_resident_mode == CoResidentMode::NONE ||
+                 query_scratch->full_scored.insert(frontier_nhood.first).second) &&
+                !is_deleted(frontier_nhood.first))
+                full_retset.push_back(Neighbor(frontier_nhood.first, cur_expanded_dist));
             // compute node_nbrs <-> query dist in PQ space
             cpu_timer.reset();
             compute_dists(node_nbrs, nnbrs, dist_scratch);
@@ -1587,7 +2342,7 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
                     }
 
                     Neighbor nn(id, dist);
-                    retset.insert(nn);
+                    insert_candidate(nn);
                 }
             }
 
@@ -1595,73 +2350,202 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
             {
                 stats->cpu_us += (float)cpu_timer.elapsed();
             }
+
+            if (_co_resident_mode != CoResidentMode::NONE && _nnodes_per_sector > 1)
+                process_co_resident(frontier_nhood.second, frontier_nhood.first);
         }
 
-        hops++;
-    }
+        if (prefetch_rerank)
+            prefetch_rerank_vectors(data, k_search, !_decoupled_layout, prev_topk, stats);
 
-    // re-sort by distance
-    std::sort(full_retset.begin(), full_retset.end());
+        hops++;
 
-    if (use_reorder_data)
-    {
-        if (!(this->_reorder_data_exists))
+        if (budget != nullptr)
         {
-            throw ANNException("Requested use of reordering data which does "
-                               "not exist in index "
-                               "file",
-                               -1, __FUNCSIG__, __FILE__, __LINE__);
+            // lean towards the recent hops, so a stalling device shows up within a hop or two
+            float hop_us = (float)hop_timer.elapsed();
+            hop_us_est = hops == 1 ? hop_us : 0.5f * hop_us_est + 0.5f * hop_us;
+            hop_io_us_est = hops == 1 ? hop_io_us : 0.5f * hop_io_us_est + 0.5f * hop_io_us;
         }
 
-        std::vector<AlignedRead> vec_read_reqs;
-
-        if (full_retset.size() > k_search * FULL_PRECISION_REORDER_MULTIPLIER)
-            full_retset.erase(full_retset.begin() + k_search * FULL_PRECISION_REORDER_MULTIPLIER, full_retset.end());
-
-        for (size_t i = 0; i < full_retset.size(); ++i)
+        if (_adaptive_min_beam_width > 0 || _early_stop_hops > 0)
         {
-            // MULTISECTORFIX
-            vec_read_reqs.emplace_back(VECTOR_SECTOR_NO(((size_t)full_retset[i].id)) * defaults::SECTOR_LEN,
-                                       defaults::SECTOR_LEN, sector_scratch + i * defaults::SECTOR_LEN);
-
-            if (stats != nullptr)
+            // far from the query most hops bring a closer k-th candidate; once they stop,
+            // the list has converged and a wider beam explores it in fewer round trips
+            bool gained = retset.size() < k_search;
+            if (!gained && retset[k_search - 1].distance < best_kth_dist)
             {
-                stats->n_4k++;
-                stats->n_ios++;
+                best_kth_dist = retset[k_search - 1].distance;
+                gained = true;
+            }
+            if (gained)
+            {
+                hops_without_gain = 0;
+            }
+            else
+            {
+                hops_without_gain++;
+                if (_adaptive_min_beam_width > 0)
+                    cur_beam_width = (std::min)(2 * cur_beam_width, max_beam_width);
+                if (_early_stop_hops > 0 && hops_without_gain >= _early_stop_hops)
+                {
+                    if (stats != nullptr)
+                        stats->early_stopped = 1;
+                    break;
+                }
             }
         }
+    }
+
+    bool skip_rerank = false;
+    if (budget != nullptr && will_rerank && (float)budget_timer.elapsed() + hop_io_us_est > (float)budget->latency_us)
+    {
+        skip_rerank = true;
+        truncated = true;
+    }
+    uint64_t num_results = k_search;
+    if (range != nullptr)
+    {
+        range->l_search = (std::min)(range->l_search, (uint64_t)full_retset.size());
+        num_results = range->l_search;
+    }
+    if (cursor != nullptr)
+    {
+        // page out the best nodes not returned yet; finish_search() works on a copy, as the
+        // rerank cuts full_retset down and the cursor needs all of it for the next pages
+        std::vector<Neighbor> remaining;
+        for (auto &nbr : full_retset)
+        {
+            if (cursor->_returned.find(nbr.id) == cursor->_returned.end())
+                remaining.push_back(nbr);
+        }
+        num_results = (std::min)(k_search, (uint64_t)remaining.size());
+        full_retset.swap(remaining);
+        finish_search(data, num_results, indices, distances, query_norm, use_reorder_data, stats, skip_rerank);
+        for (uint64_t i = 0; i < num_results; i++)
+            cursor->_returned.insert(full_retset[i].id);
+        full_retset.swap(remaining);
+        cursor->_page_size = num_results;
+        cursor->_started = true;
+    }
+    else
+    {
+        finish_search(data, num_results, indices, distances, query_norm, use_reorder_data, stats, skip_rerank);
+    }
 
-        io_timer.reset();
 #ifdef USE_BING_INFRA
-        reader->read(vec_read_reqs, ctx, true); // async reader windows.
-#else
-        reader->read(vec_read_reqs, ctx); // synchronous IO linux
+    ctx.m_completeCount = 0;
 #endif
-        if (stats != nullptr)
+
+    if (stats != nullptr)
+    {
+        stats->total_us = (float)query_timer.elapsed();
+        stats->truncated = truncated ? 1 : 0;
+    }
+    return truncated;
+}
+
+template <typename T, typename LabelT>
+float PQFlashIndex<T, LabelT>::preprocess_query(const T *query1, SSDQueryScratch<T> *query_scratch,
+                                                QueryStats *stats)
+{
+    auto pq_query_scratch = query_scratch->_pq_scratch;
+    float query_norm = 0;
+    T *aligned_query_T = query_scratch->aligned_query_T;
+    float *query_rotated = pq_query_scratch->rotated_query;
+
+    // if inner product, we laso normalize the query and set the last coordinate
+    // to 0 (this is the extra coordindate used to convert MIPS to L2 search)
+    if (metric == diskann::Metric::INNER_PRODUCT)
+    {
+        for (size_t i = 0; i < this->_data_dim - 1; i++)
         {
-            stats->io_us += io_timer.elapsed();
+            aligned_query_T[i] = query1[i];
+            query_norm += query1[i] * query1[i];
         }
+        aligned_query_T[this->_data_dim - 1] = 0;
+
+        query_norm = std::sqrt(query_norm);
 
-        for (size_t i = 0; i < full_retset.size(); ++i)
+        for (size_t i = 0; i < this->_data_dim - 1; i++)
+        {
+            aligned_query_T[i] = (T)(aligned_query_T[i] / query_norm);
+        }
+        pq_query_scratch->set(this->_data_dim, aligned_query_T);
+    }
+    else
+    {
+        for (size_t i = 0; i < this->_data_dim; i++)
         {
-            auto id = full_retset[i].id;
-            // MULTISECTORFIX
-            auto location = (sector_scratch + i * defaults::SECTOR_LEN) + VECTOR_SECTOR_OFFSET(id);
-            full_retset[i].distance = _dist_cmp->compare(aligned_query_T, (T *)location, (uint32_t)this->_data_dim);
+            aligned_query_T[i] = query1[i];
         }
+        pq_query_scratch->set(this->_data_dim, aligned_query_T);
+    }
+
+    // query <-> PQ chunk centers distances
+    Timer pqdist_timer;
+    _pq_table.preprocess_query(query_rotated); // center the query and rotate if
+                                               // we have a rotation matrix
+    float *pq_dists = pq_query_scratch->aligned_pqtable_dist_scratch;
+    _pq_table.populate_chunk_distances(query_rotated, pq_dists);
+    if (stats != nullptr) {
+        stats->pqdist_us += (float)pqdist_timer.elapsed();
+    }
+
+    return query_norm;
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::finish_search(SSDThreadData<T> *data, const uint64_t k_search, uint64_t *indices,
+                                            float *distances, const float query_norm, const bool use_reorder_data,
+                                            QueryStats *stats, const bool skip_rerank, IOContext *rerank_ctx)
+{
+    std::vector<Neighbor> &full_retset = data->scratch.full_retset;
+
+    // re-sort by distance
+    std::sort(full_retset.begin(), full_retset.end());
+
+    if (skip_rerank)
+    {
+        // the reads still have to complete before the buffers can be reused
+        drain_rerank_prefetches(data);
+    }
+    else if (_decoupled_layout || (!use_reorder_data && !data->scratch.pq_scored.empty()))
+    {
+        rerank_full_precision(data, k_search, false, stats, rerank_ctx);
+    }
 
-        std::sort(full_retset.begin(), full_retset.end());
+    if (use_reorder_data)
+    {
+        if (!(this->_reorder_data_exists))
+        {
+            throw ANNException("Requested use of reordering data which does "
+                               "not exist in index "
+                               "file",
+                               -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        if (!skip_rerank)
+            rerank_full_precision(data, k_search, true, stats, rerank_ctx);
     }
 
-    // copy k_search values
+    // copy k_search values; with deleted points there may be fewer
     for (uint64_t i = 0; i < k_search; i++)
     {
+        if (i >= full_retset.size())
+        {
+            indices[i] = std::numeric_limits<uint32_t>::max();
+            if (distances != nullptr)
+                distances[i] = std::numeric_limits<float>::max();
+            continue;
+        }
         indices[i] = full_retset[i].id;
         auto key = (uint32_t)indices[i];
         if (_dummy_pts.find(key) != _dummy_pts.end())
         {
             indices[i] = _dummy_to_real_map[key];
         }
+        if (!_id_map.empty())
+            indices[i] = _id_map[indices[i]];
 
         if (distances != nullptr)
         {
@@ -1678,60 +2562,863 @@ void PQFlashIndex<T, LabelT>::cached_beam_search(const T *query1, const uint64_t
         }
     }
 
-#ifdef USE_BING_INFRA
-    ctx.m_completeCount = 0;
-#endif
-
-    if (stats != nullptr)
-    {
-        stats->total_us = (float)query_timer.elapsed();
-    }
 }
 
-// range search returns results of all neighbors within distance of range.
-// indices and distances need to be pre-allocated of size l_search and the
-// return value is the number of matching hits.
 template <typename T, typename LabelT>
-uint32_t PQFlashIndex<T, LabelT>::range_search(const T *query1, const double range, const uint64_t min_l_search,
-                                               const uint64_t max_l_search, std::vector<uint64_t> &indices,
-                                               std::vector<float> &distances, const uint64_t min_beam_width,
-                                               QueryStats *stats)
+uint64_t PQFlashIndex<T, LabelT>::get_rerank_sector(uint32_t node_id, const bool use_reorder_data)
 {
-    uint32_t res_count = 0;
+    if (use_reorder_data)
+        return VECTOR_SECTOR_NO(node_id);
+    // outside the decoupled layout the full precision vector is stored with the node
+    return _decoupled_layout ? get_vector_sector(node_id) : get_node_sector(node_id);
+}
 
-    bool stop_flag = false;
+template <typename T, typename LabelT>
+uint64_t PQFlashIndex<T, LabelT>::rerank_sectors_per_vec(const bool use_reorder_data)
+{
+    // MULTISECTORFIX: reorder vectors are assumed to fit in one sector
+    if (use_reorder_data)
+        return 1;
+    if (!_decoupled_layout)
+        return _nnodes_per_sector > 0 ? 1 : DIV_ROUND_UP(_max_node_len, defaults::SECTOR_LEN);
+    if (_nvecs_per_vec_sector > 0)
+        return 1;
+    return DIV_ROUND_UP(_disk_bytes_per_point, defaults::SECTOR_LEN);
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::rerank_full_precision(SSDThreadData<T> *data, const uint64_t k_search,
+                                                    const bool use_reorder_data, QueryStats *stats,
+                                                    IOContext *rerank_ctx)
+{
+    IOContext &ctx = rerank_ctx != nullptr ? *rerank_ctx : data->ctx;
+    auto &scratch = data->scratch;
+    T *aligned_query_T = scratch.aligned_query_T;
+    float *query_float = scratch._pq_scratch->aligned_query_float;
+    T *data_buf = scratch.coord_scratch;
+    std::vector<Neighbor> &full_retset = scratch.full_retset;
+    Timer io_timer;
+
+    // entries past the rerank window keep their search distances and are dropped
+    if (full_retset.size() > k_search * FULL_PRECISION_REORDER_MULTIPLIER)
+        full_retset.erase(full_retset.begin() + k_search * FULL_PRECISION_REORDER_MULTIPLIER, full_retset.end());
+
+    io_timer.reset();
+    drain_rerank_prefetches(data);
+    if (stats != nullptr)
+        stats->io_us += io_timer.elapsed();
+
+    const uint64_t num_sectors_per_vec = rerank_sectors_per_vec(use_reorder_data);
+    char *read_scratch = scratch.rerank_scratch + scratch.rerank_prefetch_slots * defaults::SECTOR_LEN;
+    // in the coupled layout only nodes scored from a graph-only cache lack an exact distance
+    const bool pq_scored_only = !use_reorder_data && !_decoupled_layout;
+    auto needs_rerank = [&](uint32_t id) {
+        return !pq_scored_only || scratch.pq_scored.find(id) != scratch.pq_scored.end();
+    };
+    const uint64_t read_slots = defaults::RERANK_SCRATCH_SECTORS - scratch.rerank_prefetch_slots;
+
+    auto rerank_distance = [&](char *sector_buf, uint32_t id) {
+        if (use_reorder_data)
+            return _dist_cmp->compare(aligned_query_T, (T *)(sector_buf + VECTOR_SECTOR_OFFSET(id)),
+                                      (uint32_t)this->_data_dim);
+        char *vec = _decoupled_layout ? offset_to_vector(sector_buf, id)
+                                      : (char *)offset_to_node_coords(offset_to_node(sector_buf, id));
+        memcpy(data_buf, vec, _disk_bytes_per_point);
+        if (!_use_disk_index_pq)
+            return _dist_cmp->compare(aligned_query_T, data_buf, (uint32_t)_aligned_dim);
+        else if (metric == diskann::Metric::INNER_PRODUCT)
+            return _disk_pq_table.inner_product(query_float, (uint8_t *)data_buf);
+        else
+            return _disk_pq_table.l2_distance(query_float, (uint8_t *)data_buf);
+    };
 
-    uint32_t l_search = (uint32_t)min_l_search; // starting size of the candidate list
-    while (!stop_flag)
+    std::vector<uint64_t> missing;
+    tsl::robin_map<uint64_t, char *> batch_bufs;
+    std::vector<AlignedRead> vec_read_reqs;
+    size_t start = 0;
+    while (start < full_retset.size())
     {
-        indices.resize(l_search);
-        distances.resize(l_search);
-        uint64_t cur_bw = min_beam_width > (l_search / 5) ? min_beam_width : l_search / 5;
-        cur_bw = (cur_bw > 100) ? 100 : cur_bw;
-        for (auto &x : distances)
-            x = std::numeric_limits<float>::max();
-        this->cached_beam_search(query1, l_search, l_search, indices.data(), distances.data(), cur_bw, false, stats);
-        for (uint32_t i = 0; i < l_search; i++)
+        // take candidates until the sectors still to be read fill the read area
+        missing.clear();
+        batch_bufs.clear();
+        size_t end = start;
+        for (; end < full_retset.size(); end++)
         {
-            if (distances[i] > (float)range)
+            if (!needs_rerank(full_retset[end].id))
+                continue;
+            uint64_t sector = get_rerank_sector(full_retset[end].id, use_reorder_data);
+            if (scratch.rerank_prefetched.find(sector) != scratch.rerank_prefetched.end() ||
+                batch_bufs.find(sector) != batch_bufs.end())
+                continue;
+            if ((missing.size() + 1) * num_sectors_per_vec > read_slots)
+                break;
+            batch_bufs[sector] = nullptr;
+            missing.push_back(sector);
+        }
+        if (end == start)
+            throw ANNException("Vector does not fit in the rerank scratch", -1, __FUNCSIG__, __FILE__, __LINE__);
+
+        // one read per run of adjacent vectors
+        std::sort(missing.begin(), missing.end());
+        vec_read_reqs.clear();
+        uint64_t slot = 0;
+        for (size_t i = 0; i < missing.size();)
+        {
+            size_t j = i + 1;
+            while (j < missing.size() && missing[j] == missing[j - 1] + num_sectors_per_vec &&
+                   (j - i + 1) * num_sectors_per_vec <= defaults::MAX_COALESCED_READ_SECTORS)
+                j++;
+            char *buf = read_scratch + slot * defaults::SECTOR_LEN;
+            vec_read_reqs.emplace_back(missing[i] * defaults::SECTOR_LEN,
+                                       (j - i) * num_sectors_per_vec * defaults::SECTOR_LEN, buf);
+            for (size_t m = i; m < j; m++)
+                batch_bufs[missing[m]] = buf + (m - i) * num_sectors_per_vec * defaults::SECTOR_LEN;
+            slot += (j - i) * num_sectors_per_vec;
+            if (stats != nullptr)
             {
-                res_count = i;
+                stats->n_4k += (unsigned)((j - i) * num_sectors_per_vec);
+                stats->n_ios++;
+            }
+            i = j;
+        }
+
+        if (!vec_read_reqs.empty())
+        {
+            io_timer.reset();
+#ifdef USE_BING_INFRA
+            reader->read(vec_read_reqs, ctx, true); // async reader windows.
+#else
+            reader->read(vec_read_reqs, ctx); // synchronous IO linux
+#endif
+            if (stats != nullptr)
+                stats->io_us += io_timer.elapsed();
+        }
+
+        for (size_t i = start; i < end; ++i)
+        {
+            uint32_t id = full_retset[i].id;
+            if (!needs_rerank(id))
+                continue;
+            uint64_t sector = get_rerank_sector(id, use_reorder_data);
+            auto iter = scratch.rerank_prefetched.find(sector);
+            char *sector_buf = iter != scratch.rerank_prefetched.end() ? iter->second : batch_bufs[sector];
+            full_retset[i].distance = rerank_distance(sector_buf, id);
+        }
+        start = end;
+    }
+
+    std::sort(full_retset.begin(), full_retset.end());
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::prefetch_rerank_vectors(SSDThreadData<T> *data, const uint64_t k_search,
+                                                      const bool use_reorder_data, std::vector<uint32_t> &prev_topk,
+                                                      QueryStats *stats)
+{
+    auto &scratch = data->scratch;
+    NeighborPriorityQueue &retset = scratch.retset;
+    const uint64_t num_sectors_per_vec = rerank_sectors_per_vec(use_reorder_data);
+    // the rest of the scratch is left for the reads rerank still has to issue
+    const uint64_t max_slots = defaults::RERANK_SCRATCH_SECTORS / 2;
+
+    std::vector<AlignedRead> vec_read_reqs;
+    std::vector<uint32_t> topk;
+    for (size_t i = 0; i < retset.size() && i < k_search; i++)
+    {
+        const Neighbor &nbr = retset[i];
+        topk.push_back(nbr.id);
+        if (!nbr.expanded || std::find(prev_topk.begin(), prev_topk.end(), nbr.id) == prev_topk.end())
+            continue;
+        uint64_t sector = get_rerank_sector(nbr.id, use_reorder_data);
+        if (scratch.rerank_prefetched.find(sector) != scratch.rerank_prefetched.end() ||
+            scratch.rerank_prefetch_slots + num_sectors_per_vec > max_slots)
+            continue;
+
+        char *buf = scratch.rerank_scratch + scratch.rerank_prefetch_slots * defaults::SECTOR_LEN;
+        scratch.rerank_prefetch_slots += num_sectors_per_vec;
+        scratch.rerank_prefetched[sector] = buf;
+        vec_read_reqs.emplace_back(sector * defaults::SECTOR_LEN, num_sectors_per_vec * defaults::SECTOR_LEN, buf);
+        if (stats != nullptr)
+        {
+            stats->n_4k += (unsigned)num_sectors_per_vec;
+            stats->n_ios++;
+            stats->n_rerank_prefetched++;
+        }
+    }
+    prev_topk.swap(topk);
+
+    if (!vec_read_reqs.empty())
+    {
+        reader->submit_reqs(vec_read_reqs, data->ctx);
+        scratch.rerank_inflight += vec_read_reqs.size();
+    }
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::read_around_prefetches(SSDThreadData<T> *data, std::vector<AlignedRead> &read_reqs)
+{
+    auto &scratch = data->scratch;
+    const char *prefetch_lo = scratch.rerank_scratch;
+    const char *prefetch_hi = prefetch_lo + defaults::RERANK_SCRATCH_SECTORS * defaults::SECTOR_LEN;
+
+    reader->submit_reqs(read_reqs, data->ctx);
+    uint64_t n_left = read_reqs.size();
+    std::vector<void *> completed;
+    auto count_completed = [&]() {
+        for (void *buf : completed)
+        {
+            if ((char *)buf >= prefetch_lo && (char *)buf < prefetch_hi)
+                scratch.rerank_inflight--;
+            else
+                n_left--;
+        }
+    };
+    while (n_left > 0)
+    {
+        completed.clear();
+        try
+        {
+            reader->get_completions(data->ctx, 1, completed);
+        }
+        catch (...)
+        {
+            // the prefetches are left to the caller's guard; the reads of this call are reaped here
+            count_completed();
+            drain_aborted_reads(data->ctx, n_left + scratch.rerank_inflight);
+            scratch.rerank_inflight = 0;
+            throw;
+        }
+        count_completed();
+    }
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::drain_rerank_prefetches(SSDThreadData<T> *data)
+{
+    auto &scratch = data->scratch;
+    std::vector<void *> completed;
+    while (scratch.rerank_inflight > 0)
+    {
+        completed.clear();
+        try
+        {
+            reader->get_completions(data->ctx, scratch.rerank_inflight, completed);
+        }
+        catch (...)
+        {
+            // what a failed call reaped is no longer in flight
+            scratch.rerank_inflight -= (std::min)(scratch.rerank_inflight, (uint64_t)completed.size());
+            throw;
+        }
+        scratch.rerank_inflight -= completed.size();
+    }
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::pipeline_start(PipelinedQuery &q, const T *query1)
+{
+    auto query_scratch = &(q.data->scratch);
+    query_scratch->reset();
+    q.node_cache = pin_node_cache(q.data);
+    q.query_norm = preprocess_query(query1, query_scratch, q.stats);
+
+    // carve sector_scratch into node-sized slots, one per in-flight read
+    const uint64_t num_sectors_per_node =
+        _nnodes_per_sector > 0 ? 1 : DIV_ROUND_UP(_max_node_len, defaults::SECTOR_LEN);
+    const uint64_t num_slots = defaults::MAX_N_SECTOR_READS / num_sectors_per_node;
+    q.max_inflight = (std::min)(q.max_inflight, num_slots);
+    q.free_bufs.clear();
+    for (uint64_t i = num_slots; i > 0; i--)
+        q.free_bufs.push_back(query_scratch->sector_scratch + (i - 1) * num_sectors_per_node * defaults::SECTOR_LEN);
+    q.inflight.clear();
+    q.pending.clear();
+    q.num_expanded = 0;
+
+    query_scratch->retset.reserve(deleted_overfetch_l(q.l_search));
+    if (seed_from_nav_graph(query_scratch, q.stats))
+        return;
+
+    float *query_float = query_scratch->_pq_scratch->aligned_query_float;
+    uint32_t best_medoid = 0;
+    float best_dist = (std::numeric_limits<float>::max)();
+    for (uint64_t cur_m = 0; cur_m < _num_medoids; cur_m++)
+    {
+        float cur_expanded_dist =
+            _dist_cmp_float->compare(query_float, _centroid_data + _aligned_dim * cur_m, (uint32_t)_aligned_dim);
+        if (cur_expanded_dist < best_dist)
+        {
+            best_medoid = _medoids[cur_m];
+            best_dist = cur_expanded_dist;
+        }
+    }
+
+    float *dist_scratch = query_scratch->_pq_scratch->aligned_dist_scratch;
+    diskann::aggregate_coords(&best_medoid, 1, this->data, this->_n_chunks,
+                              query_scratch->_pq_scratch->aligned_pq_coord_scratch);
+    diskann::pq_dist_lookup(query_scratch->_pq_scratch->aligned_pq_coord_scratch, 1, this->_n_chunks,
+                            query_scratch->_pq_scratch->aligned_pqtable_dist_scratch, dist_scratch);
+    query_scratch->retset.insert(Neighbor(best_medoid, dist_scratch[0]));
+    query_scratch->visited.insert(best_medoid);
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::pipeline_expand(PipelinedQuery &q, uint32_t id, T *node_coords, uint64_t nnbrs,
+                                              uint32_t *node_nbrs)
+{
+    auto query_scratch = &(q.data->scratch);
+    auto pq_query_scratch = query_scratch->_pq_scratch;
+    QueryStats *stats = q.stats;
+    Timer cpu_timer;
+
+    float cur_expanded_dist;
+    if (node_coords == nullptr)
+    {
+        diskann::aggregate_coords(&id, 1, this->data, this->_n_chunks, pq_query_scratch->aligned_pq_coord_scratch);
+        diskann::pq_dist_lookup(pq_query_scratch->aligned_pq_coord_scratch, 1, this->_n_chunks,
+                                pq_query_scratch->aligned_pqtable_dist_scratch, &cur_expanded_dist);
+        if (!_decoupled_layout)
+            query_scratch->pq_scored.insert(id);
+    }
+    else if (!_use_disk_index_pq)
+    {
+        cur_expanded_dist = _dist_cmp->compare(query_scratch->aligned_query_T, node_coords, (uint32_t)_aligned_dim);
+    }
+    else
+    {
+        if (metric == diskann::Metric::INNER_PRODUCT)
+            cur_expanded_dist = _disk_pq_table.inner_product(pq_query_scratch->aligned_query_float,
+                                                             (uint8_t *)node_coords);
+        else
+            cur_expanded_dist = _disk_pq_table.l2_distance(pq_query_scratch->aligned_query_float,
+                                                           (uint8_t *)node_coords);
+    }
+    if (!is_deleted(id))
+        query_scratch->full_retset.push_back(Neighbor(id, cur_expanded_dist));
+    q.num_expanded++;
+
+    // compute node_nbrs <-> query dists in PQ space
+    float *dist_scratch = pq_query_scratch->aligned_dist_scratch;
+    diskann::aggregate_coords(node_nbrs, nnbrs, this->data, this->_n_chunks,
+                              pq_query_scratch->aligned_pq_coord_scratch);
+    diskann::pq_dist_lookup(pq_query_scratch->aligned_pq_coord_scratch, nnbrs, this->_n_chunks,
+                            pq_query_scratch->aligned_pqtable_dist_scratch, dist_scratch);
+
+    for (uint64_t m = 0; m < nnbrs; ++m)
+    {
+        uint32_t nbr = node_nbrs[m];
+        if (query_scratch->visited.insert(nbr).second)
+        {
+            if (_dummy_pts.find(nbr) != _dummy_pts.end())
+                continue;
+            query_scratch->retset.insert(Neighbor(nbr, dist_scratch[m]));
+        }
+    }
+
+    if (stats != nullptr)
+    {
+        stats->n_cmps += (uint32_t)nnbrs;
+        stats->n_nnbrs += (uint32_t)nnbrs;
+        stats->n_dist += 1;
+        stats->cpu_us += (float)cpu_timer.elapsed();
+        stats->compute_dist_us += (float)cpu_timer.elapsed();
+    }
+}
+
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::pipeline_issue(PipelinedQuery &q)
+{
+    auto query_scratch = &(q.data->scratch);
+    NeighborPriorityQueue &retset = query_scratch->retset;
+    QueryStats *stats = q.stats;
+    const uint64_t num_sectors_per_node =
+        _nnodes_per_sector > 0 ? 1 : DIV_ROUND_UP(_max_node_len, defaults::SECTOR_LEN);
+
+    // closest_unexpanded() marks the candidate expanded, so a node whose read is
+    // in flight is never picked twice
+    while (retset.has_unexpanded_node() && q.inflight.size() < q.max_inflight)
+    {
+        auto nbr = retset.closest_unexpanded();
+        if (this->_count_visited_nodes)
+        {
+            reinterpret_cast<std::atomic<uint32_t> &>(this->_node_visit_counter[nbr.id].second).fetch_add(1);
+        }
+
+        int64_t cache_slot = q.node_cache->find(nbr.id);
+        if (cache_slot >= 0 && q.node_cache->loaded(cache_slot))
+        {
+            if (stats != nullptr)
+                stats->n_cache_hits++;
+            T *node_coords = q.node_cache->has_coords() ? (T *)q.node_cache->coords(cache_slot) : nullptr;
+            uint32_t *node_nhood = q.node_cache->nhood(cache_slot);
+            pipeline_expand(q, nbr.id, node_coords, *node_nhood, node_nhood + 1);
+            continue;
+        }
+
+        if (stats != nullptr)
+            stats->n_cache_misses++;
+        char *buf = q.free_bufs.back();
+        q.free_bufs.pop_back();
+        q.inflight.push_back(std::make_pair(buf, nbr.id));
+        uint64_t sector = get_node_sector((size_t)nbr.id);
+        if (_sector_cache != nullptr && _sector_cache->lookup(sector, buf))
+        {
+            if (stats != nullptr)
+                stats->n_sector_cache_hits++;
+            pipeline_complete(q, buf, false);
+            continue;
+        }
+        if (stats != nullptr)
+        {
+            stats->n_4k++;
+            stats->n_ios++;
+        }
+        q.pending.emplace_back(sector * defaults::SECTOR_LEN, num_sectors_per_node * defaults::SECTOR_LEN, buf);
+    }
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::pipeline_complete(PipelinedQuery &q, void *buf, bool from_disk)
+{
+    auto iter = std::find_if(q.inflight.begin(), q.inflight.end(),
+                             [buf](const std::pair<char *, uint32_t> &x) { return x.first == (char *)buf; });
+    if (iter == q.inflight.end())
+    {
+        throw ANNException("Completion for a buffer that has no read in flight", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    char *sector_buf = iter->first;
+    uint32_t id = iter->second;
+    *iter = q.inflight.back();
+    q.inflight.pop_back();
+    if (from_disk && _sector_cache != nullptr)
+        _sector_cache->insert(get_node_sector(id), sector_buf);
+
+    char *node_disk_buf = offset_to_node(sector_buf, id);
+    uint64_t nnbrs;
+    uint32_t *node_nbrs = get_node_nbrs(node_disk_buf, q.data->scratch.nbr_scratch.data(), nnbrs);
+    T *data_buf = nullptr;
+    if (!_decoupled_layout)
+    {
+        data_buf = q.data->scratch.coord_scratch;
+        memcpy(data_buf, offset_to_node_coords(node_disk_buf), _disk_bytes_per_point);
+    }
+    // neighbor ids stay in the slot (or nbr_scratch) until pipeline_expand returns
+    pipeline_expand(q, id, data_buf, nnbrs, node_nbrs);
+    q.free_bufs.push_back(sector_buf);
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::drain_aborted_reads(IOContext &ctx, uint64_t num_reads)
+{
+    std::vector<void *> completed;
+    while (num_reads > 0)
+    {
+        completed.clear();
+        try
+        {
+            reader->get_completions(ctx, num_reads, completed);
+        }
+        catch (...)
+        {
+            // failed reads are reaped too; give up only if nothing was
+            if (completed.empty())
+                return;
+        }
+        num_reads -= (std::min)(num_reads, (uint64_t)completed.size());
+    }
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::pipelined_beam_search(const T *query1, const uint64_t k_search, const uint64_t l_search,
+                                                    uint64_t *indices, float *distances, const uint64_t beam_width,
+                                                    const bool use_reorder_data, QueryStats *stats)
+{
+    ScratchStoreManager<SSDThreadData<T>> manager(this->_thread_data);
+    PipelinedQuery q;
+    q.data = manager.scratch_space();
+    q.k_search = k_search;
+    q.l_search = l_search;
+    q.max_inflight = beam_width;
+    q.stats = stats;
+    IOContext &ctx = q.data->ctx;
+
+    Timer query_timer, io_timer;
+    pipeline_start(q, query1);
+
+    std::vector<void *> completed;
+    uint64_t num_outstanding = 0; // submitted and not yet reaped
+    bool reaping = false;
+    try
+    {
+        while (true)
+        {
+            const uint64_t num_expanded = q.num_expanded;
+            pipeline_issue(q);
+            if (!q.pending.empty())
+            {
+                reader->submit_reqs(q.pending, ctx);
+                num_outstanding += q.pending.size();
+                q.pending.clear();
+            }
+
+            if (!q.inflight.empty())
+            {
+                // wait for at least one read, then expand everything that has landed
+                io_timer.reset();
+                completed.clear();
+                reaping = true;
+                reader->get_completions(ctx, 1, completed);
+                reaping = false;
+                num_outstanding -= completed.size();
+                if (stats != nullptr)
+                    stats->io_us += (float)io_timer.elapsed();
+                for (void *buf : completed)
+                    pipeline_complete(q, buf);
+            }
+
+            // a hop is a round that expanded nodes, from the cache or from disk
+            if (stats != nullptr && q.num_expanded > num_expanded)
+                stats->n_hops++;
+            if (q.inflight.empty() && !q.data->scratch.retset.has_unexpanded_node())
                 break;
+        }
+    }
+    catch (...)
+    {
+        // a failed get_completions() still hands back what it reaped
+        if (reaping)
+            num_outstanding -= (std::min)(num_outstanding, (uint64_t)completed.size());
+        drain_aborted_reads(ctx, num_outstanding);
+        throw;
+    }
+
+    finish_search(q.data, k_search, indices, distances, q.query_norm, use_reorder_data, stats);
+
+    if (stats != nullptr)
+    {
+        stats->total_us = (float)query_timer.elapsed();
+    }
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::multiplexed_beam_search(const T *queries, const uint64_t num_queries,
+                                                      const uint64_t query_aligned_dim, const uint64_t k_search,
+                                                      const uint64_t l_search, uint64_t *indices, float *distances,
+                                                      const uint64_t beam_width,
+                                                      const uint64_t num_inflight_queries,
+                                                      const bool use_reorder_data, QueryStats *stats)
+{
+    if (num_queries == 0)
+        return;
+
+    // wait for one scratch, then take as many more as are free (up to the limit) so
+    // that threads holding part of their set never wait on each other
+    ScratchStoreManager<SSDThreadData<T>> manager(this->_thread_data);
+    std::vector<SSDThreadData<T> *> extra_data;
+    while (extra_data.size() + 1 < (std::min)(num_inflight_queries, num_queries))
+    {
+        SSDThreadData<T> *extra = this->_thread_data.pop();
+        if (extra == nullptr)
+            break;
+        extra_data.push_back(extra);
+    }
+    auto return_extra_data = [this, &extra_data]() {
+        for (auto extra : extra_data)
+        {
+            extra->clear();
+            this->_thread_data.push(extra);
+        }
+        if (!extra_data.empty())
+            this->_thread_data.push_notify_all();
+    };
+
+    // every query submits on the first context: one completion queue per thread. The
+    // blocking rerank reads must not reap the other queries' reads from it, so the first
+    // query reranks on the second context; the others rerank on their own.
+    IOContext &ctx = manager.scratch_space()->ctx;
+
+    std::vector<PipelinedQuery> slots(extra_data.size() + 1);
+    std::vector<int64_t> slot_query(slots.size(), -1);
+    std::vector<Timer> slot_timer(slots.size());
+    slots[0].data = manager.scratch_space();
+    for (size_t s = 1; s < slots.size(); s++)
+        slots[s].data = extra_data[s - 1];
+
+    const uint64_t sector_scratch_len = defaults::MAX_N_SECTOR_READS * defaults::SECTOR_LEN;
+    uint64_t next_query = 0, num_active = 0;
+    std::vector<AlignedRead> to_submit;
+    std::vector<void *> completed;
+    uint64_t num_outstanding = 0; // submitted on ctx and not yet reaped
+    bool reaping = false;
+    Timer io_timer;
+
+    // starts the next query in `s`, or finishes the query in `s` once it has nothing left to read
+    auto advance = [&](size_t s) {
+        PipelinedQuery &q = slots[s];
+        while (true)
+        {
+            if (slot_query[s] >= 0)
+            {
+                pipeline_issue(q);
+                to_submit.insert(to_submit.end(), q.pending.begin(), q.pending.end());
+                q.pending.clear();
+                if (!q.inflight.empty())
+                    return;
+
+                uint64_t qid = (uint64_t)slot_query[s];
+                IOContext &rerank_ctx = slots[(s == 0 && slots.size() > 1) ? 1 : s].data->ctx;
+                finish_search(q.data, k_search, indices + qid * k_search,
+                              distances == nullptr ? nullptr : distances + qid * k_search, q.query_norm,
+                              use_reorder_data, q.stats, false, &rerank_ctx);
+                if (q.stats != nullptr)
+                    q.stats->total_us = (float)slot_timer[s].elapsed();
+                slot_query[s] = -1;
+                num_active--;
+            }
+            if (next_query >= num_queries)
+                return;
+
+            slot_query[s] = (int64_t)next_query;
+            slot_timer[s].reset();
+            q.k_search = k_search;
+            q.l_search = l_search;
+            q.max_inflight = beam_width;
+            q.stats = stats == nullptr ? nullptr : stats + next_query;
+            pipeline_start(q, queries + next_query * query_aligned_dim);
+            next_query++;
+            num_active++;
+        }
+    };
+
+    try
+    {
+        for (size_t s = 0; s < slots.size(); s++)
+            advance(s);
+
+        while (num_active > 0)
+        {
+            if (!to_submit.empty())
+            {
+                reader->submit_reqs(to_submit, ctx);
+                num_outstanding += to_submit.size();
+                to_submit.clear();
+            }
+
+            io_timer.reset();
+            completed.clear();
+            reaping = true;
+            reader->get_completions(ctx, 1, completed);
+            reaping = false;
+            num_outstanding -= completed.size();
+            float wait_us = (float)io_timer.elapsed();
+
+            std::vector<bool> touched(slots.size(), false);
+            for (void *buf : completed)
+            {
+                size_t s = 0;
+                while (s < slots.size() && ((char *)buf < slots[s].data->scratch.sector_scratch ||
+                                            (char *)buf >= slots[s].data->scratch.sector_scratch + sector_scratch_len))
+                    s++;
+                if (s == slots.size() || slot_query[s] < 0)
+                {
+                    throw ANNException("Completion for a buffer that has no read in flight", -1, __FUNCSIG__, __FILE__,
+                                       __LINE__);
+                }
+                pipeline_complete(slots[s], buf);
+                if (!touched[s] && slots[s].stats != nullptr)
+                {
+                    slots[s].stats->io_us += wait_us;
+                    slots[s].stats->n_hops++;
+                }
+                touched[s] = true;
+            }
+            for (size_t s = 0; s < slots.size(); s++)
+            {
+                if (touched[s])
+                    advance(s);
             }
-            else if (i == l_search - 1)
-                res_count = l_search;
         }
-        if (res_count < (uint32_t)(l_search / 2.0))
-            stop_flag = true;
-        l_search = l_search * 2;
-        if (l_search > max_l_search)
-            stop_flag = true;
     }
+    catch (...)
+    {
+        // the other queries' reads still land in their scratch; reap them before it is reused
+        if (reaping)
+            num_outstanding -= (std::min)(num_outstanding, (uint64_t)completed.size());
+        drain_aborted_reads(ctx, num_outstanding);
+        return_extra_data();
+        throw;
+    }
+    return_extra_data();
+}
+
+// range search returns results of all neighbors within distance of range.
+// indices and distances need to be pre-allocated of size l_search and the
+// return value is the number of matching hits.
+template <typename T, typename LabelT>
+uint32_t PQFlashIndex<T, LabelT>::range_search(const T *query1, const double range, const uint64_t min_l_search,
+                                               const uint64_t max_l_search, std::vector<uint64_t> &indices,
+                                               std::vector<float> &distances, const uint64_t min_beam_width,
+                                               QueryStats *stats)
+{
+    // a single search whose candidate list doubles, from min_l_search up to max_l_search,
+    // for as long as at least half of it is in range; see beam_search()
+    RangeSearchState range_state;
+    range_state.range = range;
+    range_state.max_l_search = (std::max)(min_l_search, max_l_search);
+    range_state.min_beam_width = min_beam_width;
+    range_state.l_search = min_l_search;
+
+    indices.resize(range_state.max_l_search);
+    distances.resize(range_state.max_l_search);
+    for (auto &x : distances)
+        x = std::numeric_limits<float>::max();
+
+    uint64_t cur_bw = min_beam_width > (min_l_search / 5) ? min_beam_width : min_l_search / 5;
+    cur_bw = (cur_bw > 100) ? 100 : cur_bw;
+    LabelT dummy_filter = 0;
+    beam_search(query1, min_l_search, min_l_search, indices.data(), distances.data(), cur_bw, false, dummy_filter,
+                std::numeric_limits<uint32_t>::max(), false, stats, nullptr, &range_state);
+
+    uint32_t res_count = 0;
+    while (res_count < range_state.l_search && distances[res_count] <= (float)range)
+        res_count++;
     indices.resize(res_count);
     distances.resize(res_count);
     return res_count;
 }
 
+template <typename T, typename LabelT>
+std::unique_ptr<typename PQFlashIndex<T, LabelT>::SearchCursor> PQFlashIndex<T, LabelT>::begin_search(
+    const T *query1, const uint64_t l_search, const uint64_t beam_width, const uint64_t max_l_search,
+    const uint64_t lifetime_ms, const bool use_reorder_data)
+{
+    std::unique_ptr<SearchCursor> cursor(new SearchCursor());
+    cursor->_query.assign(query1, query1 + _data_dim);
+    cursor->_l_search = l_search;
+    cursor->_max_l_search = (std::max)(l_search, max_l_search);
+    cursor->_beam_width = beam_width;
+    cursor->_use_reorder_data = use_reorder_data;
+    cursor->_expiry = lifetime_ms > 0
+                          ? std::chrono::steady_clock::now() + std::chrono::milliseconds(lifetime_ms)
+                          : std::chrono::steady_clock::time_point::max();
+    return cursor;
+}
+
+template <typename T, typename LabelT>
+uint64_t PQFlashIndex<T, LabelT>::next_page(SearchCursor &cursor, const uint64_t k_page, uint64_t *indices,
+                                            float *distances, QueryStats *stats)
+{
+    if (cursor._exhausted || k_page == 0)
+        return 0;
+    if (std::chrono::steady_clock::now() > cursor._expiry)
+    {
+        cursor.release();
+        return 0;
+    }
+
+    // the list has to hold everything returned so far plus this page
+    uint64_t l_search = (std::max)(cursor._l_search, cursor._returned.size() + k_page);
+    l_search = (std::min)(l_search, cursor._max_l_search);
+    if (cursor._returned.size() >= l_search)
+    {
+        cursor.release();
+        return 0;
+    }
+    cursor._l_search = l_search;
+
+    LabelT dummy_filter = 0;
+    beam_search(cursor._query.data(), k_page, l_search, indices, distances, cursor._beam_width, false, dummy_filter,
+                std::numeric_limits<uint32_t>::max(), cursor._use_reorder_data, stats, nullptr, nullptr, &cursor);
+    if (cursor._page_size < k_page)
+        cursor.release();
+    return cursor._page_size;
+}
+
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::set_co_resident_mode(CoResidentMode mode)
+{
+    _co_resident_mode = mode;
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::set_nav_graph_params(uint32_t num_seeds, uint32_t search_l)
+{
+    _nav_num_seeds = num_seeds;
+    _nav_search_l = search_l;
+}
+
+template <typename T, typename LabelT>
+void PQFlashIndex<T, LabelT>::set_adaptive_beam(uint32_t min_beam_width, uint32_t stop_after_hops)
+{
+    _adaptive_min_beam_width = min_beam_width;
+    _early_stop_hops = stop_after_hops;
+}
+
+template <typename T, typename LabelT>
+bool PQFlashIndex<T, LabelT>::seed_from_nav_graph(SSDQueryScratch<T> *query_scratch, QueryStats *stats)
+{
+    if (_nav_index == nullptr || _nav_num_seeds == 0)
+        return false;
+
+    Timer nav_timer;
+    uint64_t num_seeds = (std::min)((uint64_t)_nav_num_seeds, (uint64_t)_nav_to_disk_id.size());
+    std::vector<uint32_t> seeds(num_seeds);
+    _nav_index->search(query_scratch->aligned_query_T, num_seeds, (std::max)(_nav_search_l, (uint32_t)num_seeds),
+                       seeds.data());
+    for (auto &id : seeds)
+        id = _nav_to_disk_id[id];
+
+    // the seeds enter retset with PQ distances like any other candidate
+    auto pq_query_scratch = query_scratch->_pq_scratch;
+    float *dist_scratch = pq_query_scratch->aligned_dist_scratch;
+    diskann::aggregate_coords(seeds.data(), num_seeds, this->data, this->_n_chunks,
+                              pq_query_scratch->aligned_pq_coord_scratch);
+    diskann::pq_dist_lookup(pq_query_scratch->aligned_pq_coord_scratch, num_seeds, this->_n_chunks,
+                            pq_query_scratch->aligned_pqtable_dist_scratch, dist_scratch);
+    for (uint64_t i = 0; i < num_seeds; i++)
+    {
+        if (query_scratch->visited.insert(seeds[i]).second)
+            query_scratch->retset.insert(Neighbor(seeds[i], dist_scratch[i]));
+    }
+
+    if (stats != nullptr)
+    {
+        stats->cpu_us += (float)nav_timer.elapsed();
+    }
+    return true;
+}
+
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::set_sector_cache(uint64_t cache_bytes)
+{
+#ifdef USE_BING_INFRA
+    // the Bing reader reports completions by request index, which assumes one read per frontier node
+    diskann::cerr << "Sector cache is not supported with USE_BING_INFRA; ignoring." << std::endl;
+    return;
+#endif
+    if (cache_bytes == 0)
+    {
+        _sector_cache.reset();
+        return;
+    }
+    const uint64_t num_sectors_per_node =
+        _nnodes_per_sector > 0 ? 1 : DIV_ROUND_UP(_max_node_len, defaults::SECTOR_LEN);
+    _sector_cache.reset(new SectorCache(cache_bytes, num_sectors_per_node * defaults::SECTOR_LEN));
+}
+
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::set_read_dedup(bool enable)
+{
+#ifdef USE_BING_INFRA
+    // same restriction as the sector cache: frontier reads must map one to one to requests
+    diskann::cerr << "Read dedup is not supported with USE_BING_INFRA; ignoring." << std::endl;
+    return;
+#endif
+    if (!enable)
+    {
+        _single_flight.reset();
+        return;
+    }
+    const uint64_t num_sectors_per_node =
+        _nnodes_per_sector > 0 ? 1 : DIV_ROUND_UP(_max_node_len, defaults::SECTOR_LEN);
+    _single_flight.reset(new ReadSingleFlight(num_sectors_per_node * defaults::SECTOR_LEN));
+}
+
 template <typename T, typename LabelT> uint64_t PQFlashIndex<T, LabelT>::get_data_dim()
 {
     return _data_dim;
@@ -1763,7 +3450,7 @@ template <typename T, typename LabelT> char *PQFlashIndex<T, LabelT>::getHeaderB
 template <typename T, typename LabelT>
 std::vector<std::uint8_t> PQFlashIndex<T, LabelT>::get_pq_vector(std::uint64_t vid)
 {
-    std::uint8_t *pqVec = &this->data[vid * this->_n_chunks];
+    std::uint8_t *pqVec = &this->data[(uint64_t)to_disk_id((uint32_t)vid) * this->_n_chunks];
     return std::vector<std::uint8_t>(pqVec, pqVec + this->_n_chunks);
 }
 
@@ -1772,6 +3459,92 @@ template <typename T, typename LabelT> std::uint64_t PQFlashIndex<T, LabelT>::ge
     return _num_points;
 }
 
+template <typename T, typename LabelT> bool PQFlashIndex<T, LabelT>::mark_deleted(uint32_t disk_id)
+{
+    uint64_t bit = 1ULL << (disk_id & 63);
+    if (_delete_bitmap[disk_id >> 6].fetch_or(bit, std::memory_order_relaxed) & bit)
+        return false;
+    // a filtered index may route searches through copies of the point; they go too,
+    // without being counted
+    auto dummies = _real_to_dummy_map.find(disk_id);
+    if (dummies != _real_to_dummy_map.end())
+    {
+        for (uint32_t dummy_id : dummies->second)
+            _delete_bitmap[dummy_id >> 6].fetch_or(1ULL << (dummy_id & 63), std::memory_order_relaxed);
+    }
+    _num_deleted++;
+    return true;
+}
+
+template <typename T, typename LabelT> uint64_t PQFlashIndex<T, LabelT>::deleted_overfetch_l(uint64_t l_search) const
+{
+    uint64_t num_deleted = _num_deleted.load(std::memory_order_relaxed);
+    if (num_deleted == 0)
+        return l_search;
+    double live_fraction = (double)(_num_points - (std::min)(num_deleted, _num_points)) / _num_points;
+    live_fraction = (std::max)(live_fraction, 1.0 / defaults::MAX_DELETED_L_OVERFETCH);
+    return (uint64_t)std::ceil(l_search / live_fraction);
+}
+
+template <typename T, typename LabelT>
+uint64_t PQFlashIndex<T, LabelT>::mark_points_deleted(const std::vector<uint32_t> &ids)
+{
+    std::lock_guard<std::mutex> guard(_delete_lock);
+    uint64_t num_new = 0;
+    for (uint32_t id : ids)
+    {
+        if (id >= _num_points)
+        {
+            throw ANNException("delete_points: id " + std::to_string(id) + " is not in the index", -1, __FUNCSIG__,
+                               __FILE__, __LINE__);
+        }
+        if (mark_deleted(to_disk_id(id)))
+            num_new++;
+    }
+    return num_new;
+}
+
+template <typename T, typename LabelT> void PQFlashIndex<T, LabelT>::save_deleted_ids()
+{
+    std::lock_guard<std::mutex> guard(_delete_lock);
+    // written aside and renamed so that a crash leaves the old set or the new one
+    std::vector<uint32_t> deleted_ids;
+    for (uint64_t w = 0; w < DIV_ROUND_UP(_num_points, 64); w++)
+    {
+        uint64_t word = _delete_bitmap[w].load(std::memory_order_relaxed);
+        for (uint32_t disk_id = (uint32_t)(w * 64); word != 0; word >>= 1, disk_id++)
+        {
+            if ((word & 1) && _dummy_pts.find(disk_id) == _dummy_pts.end())
+                deleted_ids.push_back(_id_map.empty() ? disk_id : _id_map[disk_id]);
+        }
+    }
+    std::string deleted_ids_file = _disk_index_file + "_deleted_ids.bin";
+    save_bin<uint32_t>(deleted_ids_file + ".tmp", deleted_ids.data(), deleted_ids.size(), 1);
+#ifdef _WINDOWS
+    // rename does not replace an existing file here
+    std::remove(deleted_ids_file.c_str());
+#endif
+    if (std::rename((deleted_ids_file + ".tmp").c_str(), deleted_ids_file.c_str()) != 0)
+    {
+        throw ANNException("delete_points: cannot write " + deleted_ids_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+}
+
+template <typename T, typename LabelT> uint64_t PQFlashIndex<T, LabelT>::delete_points(const std::vector<uint32_t> &ids)
+{
+    uint64_t num_new = mark_points_deleted(ids);
+    if (num_new == 0)
+        return 0;
+    save_deleted_ids();
+    diskann::cout << "Deleted " << num_new << " points, " << get_num_deleted() << " in all" << std::endl;
+    return num_new;
+}
+
+template <typename T, typename LabelT> uint64_t PQFlashIndex<T, LabelT>::get_num_deleted()
+{
+    return _num_deleted.load();
+}
+
 // instantiations
 template class PQFlashIndex<uint8_t>;
 template class PQFlashIndex<int8_t>;
@@ -0,0 +1,92 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <cstring>
+
+#include "read_single_flight.h"
+#include "utils.h"
+
+namespace diskann
+{
+ReadSingleFlight::ReadSingleFlight(uint64_t block_len, uint32_t num_stripes) : _block_len(block_len)
+{
+    if (block_len == 0 || num_stripes == 0)
+    {
+        throw ANNException("ReadSingleFlight needs a positive block length and stripe count", -1, __FUNCSIG__,
+                           __FILE__, __LINE__);
+    }
+    for (uint32_t i = 0; i < num_stripes; i++)
+        _stripes.emplace_back(new Stripe());
+}
+
+ReadSingleFlight::Stripe &ReadSingleFlight::stripe_of(uint64_t block_id)
+{
+    // the hot blocks near the medoid are neighbours on disk; spread them over the stripes
+    uint64_t h = block_id * 0x9E3779B97F4A7C15ULL;
+    return *_stripes[(h >> 32) % _stripes.size()];
+}
+
+std::shared_ptr<ReadSingleFlight::Flight> ReadSingleFlight::join(uint64_t block_id)
+{
+    Stripe &stripe = stripe_of(block_id);
+    std::lock_guard<std::mutex> guard(stripe.lock);
+    auto iter = stripe.flights.find(block_id);
+    if (iter != stripe.flights.end())
+    {
+        iter->second->num_waiters++;
+        return iter->second;
+    }
+    stripe.flights.insert({block_id, std::make_shared<Flight>()});
+    return nullptr;
+}
+
+void ReadSingleFlight::land(uint64_t block_id, const char *src)
+{
+    std::shared_ptr<Flight> flight;
+    {
+        Stripe &stripe = stripe_of(block_id);
+        std::lock_guard<std::mutex> guard(stripe.lock);
+        auto iter = stripe.flights.find(block_id);
+        if (iter == stripe.flights.end())
+            return;
+        flight = std::move(iter.value());
+        stripe.flights.erase(iter);
+    }
+
+    // out of the table, so num_waiters can no longer change
+    if (flight->num_waiters > 0 && src != nullptr)
+    {
+        flight->data.reset(new char[_block_len]);
+        memcpy(flight->data.get(), src, _block_len);
+    }
+    {
+        std::lock_guard<std::mutex> guard(flight->lock);
+        flight->landed = true;
+        flight->ok = (src != nullptr);
+    }
+    flight->landed_cv.notify_all();
+}
+
+bool ReadSingleFlight::wait(const std::shared_ptr<Flight> &flight, char *dst)
+{
+    {
+        std::unique_lock<std::mutex> guard(flight->lock);
+        flight->landed_cv.wait(guard, [&flight] { return flight->landed; });
+    }
+    if (!flight->ok)
+        return false;
+    memcpy(dst, flight->data.get(), _block_len);
+    _deduped++;
+    return true;
+}
+
+uint64_t ReadSingleFlight::block_len() const
+{
+    return _block_len;
+}
+
+uint64_t ReadSingleFlight::num_deduped() const
+{
+    return _deduped.load();
+}
+} // namespace diskann
@@ -0,0 +1,148 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "scheduled_aligned_file_reader.h"
+
+#include <algorithm>
+
+namespace
+{
+thread_local uint32_t io_class = 0;
+// submitted reads of this thread not yet reaped; only this thread can free their slots
+thread_local uint64_t charged_in_flight = 0;
+}
+
+ScheduledAlignedFileReader::ScheduledAlignedFileReader(std::shared_ptr<AlignedFileReader> inner,
+                                                       std::shared_ptr<diskann::IOScheduler> scheduler)
+    : inner(inner), scheduler(scheduler)
+{
+    if (inner == nullptr || scheduler == nullptr)
+    {
+        throw diskann::ANNException("ScheduledAlignedFileReader needs a reader and a scheduler", -1, __FUNCSIG__,
+                                    __FILE__, __LINE__);
+    }
+}
+
+void ScheduledAlignedFileReader::set_thread_class(uint32_t cls)
+{
+    io_class = cls;
+}
+
+uint32_t ScheduledAlignedFileReader::thread_class()
+{
+    return io_class;
+}
+
+IOContext &ScheduledAlignedFileReader::get_ctx()
+{
+    return inner->get_ctx();
+}
+
+void ScheduledAlignedFileReader::register_thread()
+{
+    inner->register_thread();
+}
+
+void ScheduledAlignedFileReader::deregister_thread()
+{
+    inner->deregister_thread();
+}
+
+void ScheduledAlignedFileReader::deregister_all_threads()
+{
+    inner->deregister_all_threads();
+}
+
+void ScheduledAlignedFileReader::register_buffer(IOContext &ctx, void *buf, uint64_t len)
+{
+    inner->register_buffer(ctx, buf, len);
+}
+
+void ScheduledAlignedFileReader::open(const std::string &fname)
+{
+    inner->open(fname);
+}
+
+void ScheduledAlignedFileReader::close()
+{
+    inner->close();
+}
+
+void ScheduledAlignedFileReader::read(std::vector<AlignedRead> &read_reqs, IOContext &ctx, bool async)
+{
+    const uint32_t cls = io_class;
+    auto read_batch = [&](std::vector<AlignedRead> &batch) {
+        // waiting for slots while holding charged ones could wait on this thread's own
+        // reads (or on a thread waiting the same way), so such a thread takes its slots
+        // without waiting, like submit_reqs()
+        if (charged_in_flight > 0)
+            scheduler->charge(cls, (uint32_t)batch.size());
+        else
+            scheduler->acquire(cls, (uint32_t)batch.size());
+        try
+        {
+            inner->read(batch, ctx, async);
+        }
+        catch (...)
+        {
+            scheduler->release(cls, (uint32_t)batch.size());
+            throw;
+        }
+        scheduler->release(cls, (uint32_t)batch.size());
+    };
+
+    const uint64_t max_batch = scheduler->max_grant(cls);
+    if (read_reqs.empty())
+        return;
+    if (read_reqs.size() <= max_batch)
+    {
+        read_batch(read_reqs);
+        return;
+    }
+    // more than the class may have in flight: issue it in turns
+    std::vector<AlignedRead> batch;
+    for (uint64_t start = 0; start < read_reqs.size(); start += max_batch)
+    {
+        uint64_t end = (std::min)(start + max_batch, (uint64_t)read_reqs.size());
+        batch.assign(read_reqs.begin() + start, read_reqs.begin() + end);
+        read_batch(batch);
+    }
+}
+
+void ScheduledAlignedFileReader::submit_reqs(std::vector<AlignedRead> &read_reqs, IOContext &ctx)
+{
+    const uint32_t cls = io_class;
+    scheduler->charge(cls, (uint32_t)read_reqs.size());
+    try
+    {
+        inner->submit_reqs(read_reqs, ctx);
+    }
+    catch (...)
+    {
+        scheduler->release(cls, (uint32_t)read_reqs.size());
+        throw;
+    }
+    charged_in_flight += read_reqs.size();
+}
+
+void ScheduledAlignedFileReader::get_completions(IOContext &ctx, uint64_t min_completions,
+                                                 std::vector<void *> &completed_bufs)
+{
+    uint64_t n_before = completed_bufs.size();
+    auto release_reaped = [&]() {
+        uint64_t n_reaped = completed_bufs.size() - n_before;
+        charged_in_flight -= (std::min)(n_reaped, charged_in_flight);
+        scheduler->release(io_class, (uint32_t)n_reaped);
+    };
+    try
+    {
+        inner->get_completions(ctx, min_completions, completed_bufs);
+    }
+    catch (...)
+    {
+        // the reads it reaped before failing are done either way
+        release_reaped();
+        throw;
+    }
+    release_reaped();
+}
@@ -89,6 +89,12 @@ template <typename T> void SSDQueryScratch<T>::reset()
     visited.clear();
     retset.clear();
     full_retset.clear();
+    retset_overflow.clear();
+    full_scored.clear();
+    expanded_in_place.clear();
+    pq_scored.clear();
+    rerank_prefetched.clear();
+    rerank_prefetch_slots = 0;
 }
 
 template <typename T> SSDQueryScratch<T>::SSDQueryScratch(size_t aligned_dim, size_t visited_reserve)
@@ -98,6 +104,8 @@ template <typename T> SSDQueryScratch<T>::SSDQueryScratch(size_t aligned_dim, si
     diskann::alloc_aligned((void **)&coord_scratch, coord_alloc_size, 256);
     diskann::alloc_aligned((void **)&sector_scratch, defaults::MAX_N_SECTOR_READS * defaults::SECTOR_LEN,
                            defaults::SECTOR_LEN);
+    diskann::alloc_aligned((void **)&rerank_scratch, defaults::RERANK_SCRATCH_SECTORS * defaults::SECTOR_LEN,
+                           defaults::SECTOR_LEN);
     diskann::alloc_aligned((void **)&aligned_query_T, aligned_dim * sizeof(T), 8 * sizeof(T));
 
     _pq_scratch = new PQScratch<T>(defaults::MAX_GRAPH_DEGREE, aligned_dim);
@@ -107,12 +115,14 @@ template <typename T> SSDQueryScratch<T>::SSDQueryScratch(size_t aligned_dim, si
 
     visited.reserve(visited_reserve);
     full_retset.reserve(visited_reserve);
+    nbr_scratch.resize(defaults::MAX_GRAPH_DEGREE);
 }
 
 template <typename T> SSDQueryScratch<T>::~SSDQueryScratch()
 {
     diskann::aligned_free((void *)coord_scratch);
     diskann::aligned_free((void *)sector_scratch);
+    diskann::aligned_free((void *)rerank_scratch);
     diskann::aligned_free((void *)aligned_query_T);
 
     delete[] _pq_scratch;
@@ -126,6 +136,7 @@ SSDThreadData<T>::SSDThreadData(size_t aligned_dim, size_t visited_reserve) : sc
 template <typename T> void SSDThreadData<T>::clear()
 {
     scratch.reset();
+    cache_epoch.store(0);
 }
 
 template DISKANN_DLLEXPORT class InMemQueryScratch<int8_t>;
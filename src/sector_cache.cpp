@@ -0,0 +1,131 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <cstring>
+
+#include "sector_cache.h"
+#include "utils.h"
+
+namespace diskann
+{
+SectorCache::SectorCache(uint64_t capacity_bytes, uint64_t block_len, uint32_t num_stripes) : _block_len(block_len)
+{
+    if (block_len == 0 || num_stripes == 0)
+    {
+        throw ANNException("SectorCache needs a positive block length and stripe count", -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+    }
+    uint64_t num_blocks = capacity_bytes / block_len;
+    // fewer stripes than requested for tiny caches, so every stripe holds something
+    num_stripes = (uint32_t)(std::max)((uint64_t)1, (std::min)((uint64_t)num_stripes, num_blocks));
+    _slots_per_stripe = (uint32_t)(num_blocks / num_stripes);
+
+    for (uint32_t i = 0; i < num_stripes; i++)
+    {
+        std::unique_ptr<Stripe> stripe(new Stripe());
+        if (_slots_per_stripe > 0)
+        {
+            stripe->slot_of.reserve(_slots_per_stripe);
+            stripe->block_ids.resize(_slots_per_stripe);
+            stripe->referenced.resize(_slots_per_stripe, 0);
+            alloc_aligned((void **)&stripe->buf, _slots_per_stripe * _block_len, 4096);
+        }
+        _stripes.push_back(std::move(stripe));
+    }
+    diskann::cout << "Sector cache: " << capacity_blocks() << " blocks of " << _block_len << "B in "
+                  << _stripes.size() << " stripes" << std::endl;
+}
+
+SectorCache::~SectorCache()
+{
+    for (auto &stripe : _stripes)
+    {
+        if (stripe->buf != nullptr)
+            aligned_free(stripe->buf);
+    }
+}
+
+SectorCache::Stripe &SectorCache::stripe_of(uint64_t block_id)
+{
+    // neighbouring sectors are often hot together; spread them over the stripes
+    uint64_t h = block_id * 0x9E3779B97F4A7C15ULL;
+    return *_stripes[(h >> 32) % _stripes.size()];
+}
+
+bool SectorCache::lookup(uint64_t block_id, char *dst)
+{
+    if (_slots_per_stripe == 0)
+        return false;
+
+    Stripe &stripe = stripe_of(block_id);
+    {
+        std::lock_guard<std::mutex> guard(stripe.lock);
+        auto iter = stripe.slot_of.find(block_id);
+        if (iter != stripe.slot_of.end())
+        {
+            uint32_t slot = iter->second;
+            stripe.referenced[slot] = 1;
+            memcpy(dst, stripe.buf + slot * _block_len, _block_len);
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    _misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void SectorCache::insert(uint64_t block_id, const char *src)
+{
+    if (_slots_per_stripe == 0)
+        return;
+
+    Stripe &stripe = stripe_of(block_id);
+    std::lock_guard<std::mutex> guard(stripe.lock);
+    if (stripe.slot_of.find(block_id) != stripe.slot_of.end())
+        return;
+
+    uint32_t slot;
+    if (stripe.num_used < _slots_per_stripe)
+    {
+        slot = stripe.num_used++;
+    }
+    else
+    {
+        // CLOCK: clear reference bits until an unreferenced slot comes round
+        while (stripe.referenced[stripe.hand])
+        {
+            stripe.referenced[stripe.hand] = 0;
+            stripe.hand = (stripe.hand + 1) % _slots_per_stripe;
+        }
+        slot = stripe.hand;
+        stripe.hand = (stripe.hand + 1) % _slots_per_stripe;
+        stripe.slot_of.erase(stripe.block_ids[slot]);
+    }
+
+    memcpy(stripe.buf + slot * _block_len, src, _block_len);
+    stripe.block_ids[slot] = block_id;
+    // new blocks start unreferenced: a block read once is evicted before a reused one
+    stripe.referenced[slot] = 0;
+    stripe.slot_of[block_id] = slot;
+}
+
+uint64_t SectorCache::capacity_blocks() const
+{
+    return (uint64_t)_slots_per_stripe * _stripes.size();
+}
+
+uint64_t SectorCache::block_len() const
+{
+    return _block_len;
+}
+
+uint64_t SectorCache::num_hits() const
+{
+    return _hits.load(std::memory_order_relaxed);
+}
+
+uint64_t SectorCache::num_misses() const
+{
+    return _misses.load(std::memory_order_relaxed);
+}
+} // namespace diskann
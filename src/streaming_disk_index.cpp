@@ -0,0 +1,993 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "omp.h"
+#include "pq.h"
+#include "streaming_disk_index.h"
+#include "timer.h"
+#include "tsl/robin_map.h"
+#include "tsl/robin_set.h"
+
+namespace
+{
+inline float l2_sq(const float *a, const float *b, uint64_t dim)
+{
+    float dist = 0;
+    for (uint64_t d = 0; d < dim; d++)
+        dist += (a[d] - b[d]) * (a[d] - b[d]);
+    return dist;
+}
+
+// Vamana's robust prune over a pool sorted by distance to the centre, where pool[i].id
+// indexes vecs: a candidate is dropped once a kept one is alpha times closer to it than
+// the centre is, with alpha raised from 1 like Index::occlude_list. Returns pool indices.
+std::vector<uint32_t> robust_prune(const std::vector<diskann::Neighbor> &pool, const float *vecs, uint64_t dim,
+                                   float alpha, uint32_t degree)
+{
+    std::vector<uint32_t> kept;
+    std::vector<float> occlude_factor(pool.size(), 0.0f);
+    float cur_alpha = 1;
+    while (cur_alpha <= alpha && kept.size() < degree)
+    {
+        for (uint64_t i = 0; i < pool.size() && kept.size() < degree; i++)
+        {
+            if (occlude_factor[i] > cur_alpha)
+                continue;
+            occlude_factor[i] = FLT_MAX;
+            kept.push_back((uint32_t)i);
+            const float *kept_vec = vecs + (uint64_t)pool[i].id * dim;
+            for (uint64_t j = i + 1; j < pool.size(); j++)
+            {
+                if (occlude_factor[j] > alpha)
+                    continue;
+                float djk = l2_sq(kept_vec, vecs + (uint64_t)pool[j].id * dim, dim);
+                occlude_factor[j] = djk == 0 ? FLT_MAX : (std::max)(occlude_factor[j], pool[j].distance / djk);
+            }
+        }
+        cur_alpha *= 1.2f;
+    }
+    return kept;
+}
+
+// Prunes the candidates of a node with coords `center` to the degree, and writes the
+// list to nhood. dists holds their distances to the centre if they are known;
+// vector_of fills in a candidate's (approximate) vector.
+template <typename T>
+void prune_nhood(const T *center, const std::vector<uint32_t> &cands, const std::vector<float> *dists,
+                 const std::function<void(uint32_t, float *)> &vector_of, uint64_t dim, float alpha, uint32_t degree,
+                 uint32_t *nhood)
+{
+    if (cands.size() <= degree)
+    {
+        nhood[0] = (uint32_t)cands.size();
+        std::copy(cands.begin(), cands.end(), nhood + 1);
+        return;
+    }
+    std::vector<float> center_vec(dim), vecs(cands.size() * dim);
+    for (uint64_t d = 0; d < dim; d++)
+        center_vec[d] = (float)center[d];
+    std::vector<diskann::Neighbor> pool;
+    for (uint64_t i = 0; i < cands.size(); i++)
+    {
+        vector_of(cands[i], vecs.data() + i * dim);
+        float dist = dists != nullptr ? (*dists)[i] : l2_sq(center_vec.data(), vecs.data() + i * dim, dim);
+        pool.emplace_back((uint32_t)i, dist);
+    }
+    std::sort(pool.begin(), pool.end());
+    std::vector<uint32_t> kept = robust_prune(pool, vecs.data(), dim, alpha, degree);
+    nhood[0] = (uint32_t)kept.size();
+    for (uint64_t i = 0; i < kept.size(); i++)
+        nhood[1 + i] = cands[pool[kept[i]].id];
+}
+
+// the disk index header, validated for the layouts that can be patched
+std::vector<uint64_t> read_disk_meta(const std::string &disk_index_file)
+{
+    std::ifstream reader(disk_index_file, std::ios::binary);
+    if (!reader)
+    {
+        throw diskann::ANNException("Cannot open " + disk_index_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    uint32_t nr = 0, nc = 0;
+    reader.read((char *)&nr, sizeof(uint32_t));
+    reader.read((char *)&nc, sizeof(uint32_t));
+    std::vector<uint64_t> meta(nr);
+    reader.read((char *)meta.data(), nr * sizeof(uint64_t));
+    if (!reader || nr < 9)
+    {
+        throw diskann::ANNException("Cannot read the header of " + disk_index_file, -1, __FUNCSIG__, __FILE__,
+                                    __LINE__);
+    }
+
+    std::string unsupported;
+    if (meta[5] != 0)
+        unsupported = "frozen points";
+    else if (meta[7] != 0)
+        unsupported = "reorder data";
+    else if (nr > 9 && meta[9] != 0)
+        unsupported = "a decoupled or compressed layout";
+    else if (file_exists(disk_index_file + "_pq_pivots.bin"))
+        unsupported = "disk PQ";
+    else if (file_exists(disk_index_file + "_locality_map.bin"))
+        unsupported = "a locality map";
+    else if (file_exists(disk_index_file + "_labels.txt"))
+        unsupported = "labels";
+    else if (file_exists(disk_index_file + "_stripes.txt"))
+        unsupported = "striping";
+    if (!unsupported.empty())
+    {
+        throw diskann::ANNException("Streaming updates do not support indexes with " + unsupported + ": " +
+                                        disk_index_file,
+                                    -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    return meta;
+}
+} // namespace
+
+namespace diskann
+{
+template <typename T>
+StreamingDiskIndex<T>::StreamingDiskIndex(std::function<std::shared_ptr<AlignedFileReader>()> reader_factory,
+                                          const std::string &index_prefix, uint32_t num_threads,
+                                          uint64_t max_mem_points, uint32_t l, float alpha, uint32_t beam_width)
+    : _reader_factory(reader_factory), _num_threads(num_threads), _max_mem_points(max_mem_points), _l(l),
+      _alpha(alpha), _beam_width(beam_width)
+{
+    if (num_threads == 0 || max_mem_points == 0 || l == 0 || beam_width == 0)
+    {
+        throw ANNException("StreamingDiskIndex needs positive thread, capacity, list size and beam width", -1,
+                           __FUNCSIG__, __FILE__, __LINE__);
+    }
+    std::string disk_index_file = index_prefix + "_disk.index";
+    std::vector<uint64_t> meta = read_disk_meta(disk_index_file);
+    _disk = load_disk_index(index_prefix);
+    _dim = _disk->index->get_data_dim();
+    _max_degree = (uint32_t)((meta[3] - _dim * sizeof(T)) / sizeof(uint32_t) - 1);
+
+    // the medoid starts every in-memory index
+    std::vector<uint32_t> medoid{(uint32_t)meta[2]};
+    _start_point.resize(_dim);
+    std::vector<T *> coord_buffers{_start_point.data()};
+    std::vector<std::pair<uint32_t, uint32_t *>> nbr_buffers{{0, nullptr}};
+    if (!_disk->index->read_nodes(medoid, coord_buffers, nbr_buffers)[0])
+    {
+        throw ANNException("Cannot read the medoid of " + disk_index_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    _frozen_end = _disk->num_points;
+    _next_id = _disk->num_points;
+    _active = make_mem_index();
+    _deleted.assign(_disk->num_points, false);
+    std::string deleted_file = disk_index_file + "_deleted_ids.bin";
+    if (file_exists(deleted_file))
+    {
+        std::unique_ptr<uint32_t[]> deleted_ids;
+        size_t num_ids, ncols;
+        load_bin<uint32_t>(deleted_file, deleted_ids, num_ids, ncols);
+        for (size_t i = 0; i < num_ids; i++)
+        {
+            if (deleted_ids[i] < _deleted.size() && !_deleted[deleted_ids[i]])
+            {
+                _deleted[deleted_ids[i]] = true;
+                _num_deleted++;
+            }
+        }
+        diskann::cout << "Loaded " << _num_deleted << " deleted ids from " << deleted_file << std::endl;
+    }
+}
+
+template <typename T> StreamingDiskIndex<T>::~StreamingDiskIndex()
+{
+    if (_merge_thread.joinable())
+        _merge_thread.join();
+    try
+    {
+        flush_deletes();
+    }
+    catch (const std::exception &e)
+    {
+        diskann::cerr << "StreamingDiskIndex: could not save the deleted ids: " << e.what() << std::endl;
+    }
+}
+
+template <typename T>
+std::shared_ptr<typename StreamingDiskIndex<T>::DiskIndex> StreamingDiskIndex<T>::load_disk_index(
+    const std::string &prefix)
+{
+    auto disk = std::make_shared<DiskIndex>();
+    disk->reader = _reader_factory();
+    disk->index.reset(new PQFlashIndex<T>(disk->reader, Metric::L2));
+    if (disk->index->load(_num_threads, prefix.c_str()) != 0)
+    {
+        throw ANNException("Cannot load the SSD index at " + prefix, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    disk->prefix = prefix;
+    disk->num_points = disk->index->get_num_points();
+    return disk;
+}
+
+template <typename T> std::shared_ptr<typename StreamingDiskIndex<T>::MemIndex> StreamingDiskIndex<T>::make_mem_index()
+{
+    auto write_params = std::make_shared<IndexWriteParameters>(IndexWriteParametersBuilder(_l, _max_degree)
+                                                                   .with_alpha(_alpha)
+                                                                   .with_num_threads(_num_threads)
+                                                                   .with_num_frozen_points(1)
+                                                                   .build());
+    auto search_params = std::make_shared<IndexSearchParams>(_l, _num_threads);
+    auto index = std::make_shared<MemIndex>(Metric::L2, _dim, _max_mem_points, write_params, search_params, 1, true,
+                                            true);
+    index->set_start_points(_start_point.data(), _dim);
+    return index;
+}
+
+template <typename T> uint32_t StreamingDiskIndex<T>::insert(const T *point)
+{
+    std::shared_lock<std::shared_timed_mutex> guard(_state_lock);
+    uint64_t id = _next_id++;
+    if (id >= std::numeric_limits<uint32_t>::max())
+    {
+        throw ANNException("StreamingDiskIndex: out of ids", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    {
+        std::unique_lock<std::shared_timed_mutex> delete_guard(_delete_lock);
+        if (id >= _deleted.size())
+            _deleted.resize((std::max)(2 * _deleted.size(), id + 1), false);
+    }
+
+    if (_active->insert_point(point, (uint32_t)id) != 0)
+    {
+        // the id is taken either way; leave it deleted so that a merge skips it
+        std::unique_lock<std::shared_timed_mutex> delete_guard(_delete_lock);
+        _deleted[id] = true;
+        _num_deleted++;
+        throw ANNException("StreamingDiskIndex: the in-memory index is full, merge first", -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+    }
+    return (uint32_t)id;
+}
+
+template <typename T> bool StreamingDiskIndex<T>::remove(uint32_t id)
+{
+    // held shared so that a merge switching indexes either finds the delete in _deleted or
+    // sees it land in the new SSD index
+    std::shared_lock<std::shared_timed_mutex> guard(_state_lock);
+    {
+        std::unique_lock<std::shared_timed_mutex> delete_guard(_delete_lock);
+        if (id >= _next_id || id >= _deleted.size() || _deleted[id])
+            return false;
+        _deleted[id] = true;
+        _num_deleted++;
+    }
+    // the SSD index then searches with a longer list to make up for it; the set is saved
+    // by flush_deletes() or the next merge
+    if (id < _disk->num_points)
+    {
+        _disk->index->mark_points_deleted({id});
+        _deletes_unsaved = true;
+    }
+    return true;
+}
+
+template <typename T> void StreamingDiskIndex<T>::flush_deletes()
+{
+    std::shared_lock<std::shared_timed_mutex> guard(_state_lock);
+    if (_deletes_unsaved.exchange(false))
+    {
+        try
+        {
+            _disk->index->save_deleted_ids();
+        }
+        catch (...)
+        {
+            _deletes_unsaved = true;
+            throw;
+        }
+    }
+}
+
+template <typename T>
+uint64_t StreamingDiskIndex<T>::search(const T *query, uint64_t k, uint64_t l_search, uint64_t beam_width,
+                                       uint64_t *ids, float *dists)
+{
+    std::shared_ptr<DiskIndex> disk;
+    std::shared_ptr<MemIndex> frozen, active;
+    {
+        std::shared_lock<std::shared_timed_mutex> guard(_state_lock);
+        disk = _disk;
+        frozen = _frozen;
+        active = _active;
+    }
+
+    // every source returns its best l, so that k survive the delete filter
+    const uint64_t l = (std::max)(k, l_search);
+    std::vector<std::pair<float, uint64_t>> results;
+    uint64_t k_disk = (std::min)(l, disk->num_points);
+    std::vector<uint64_t> disk_ids(k_disk);
+    std::vector<float> disk_dists(k_disk);
+    disk->index->cached_beam_search(query, k_disk, l, disk_ids.data(), disk_dists.data(), beam_width);
+    for (uint64_t i = 0; i < k_disk; i++)
+        results.emplace_back(disk_dists[i], disk_ids[i]);
+
+    std::vector<uint32_t> tags(l);
+    std::vector<float> tag_dists(l);
+    std::vector<T *> res_vectors;
+    for (auto &mem : {frozen, active})
+    {
+        if (mem == nullptr)
+            continue;
+        size_t n = mem->search_with_tags(query, l, (uint32_t)l, tags.data(), tag_dists.data(), res_vectors);
+        for (size_t i = 0; i < n; i++)
+            results.emplace_back(tag_dists[i], tags[i]);
+    }
+
+    {
+        std::shared_lock<std::shared_timed_mutex> delete_guard(_delete_lock);
+        results.erase(std::remove_if(results.begin(), results.end(),
+                                     [&](const std::pair<float, uint64_t> &r) {
+                                         return r.second >= _deleted.size() || _deleted[r.second];
+                                     }),
+                      results.end());
+    }
+    uint64_t n_results = (std::min)(k, (uint64_t)results.size());
+    std::partial_sort(results.begin(), results.begin() + n_results, results.end());
+    for (uint64_t i = 0; i < n_results; i++)
+    {
+        ids[i] = results[i].second;
+        dists[i] = results[i].first;
+    }
+    return n_results;
+}
+
+template <typename T> bool StreamingDiskIndex<T>::merge(const std::string &out_prefix)
+{
+    std::lock_guard<std::mutex> merge_guard(_merge_lock);
+    Timer timer;
+
+    std::shared_ptr<DiskIndex> disk;
+    std::shared_ptr<MemIndex> frozen;
+    {
+        std::unique_lock<std::shared_timed_mutex> guard(_state_lock);
+        disk = _disk;
+        if (out_prefix == disk->prefix)
+        {
+            throw ANNException("StreamingDiskIndex: merge into the prefix being served", -1, __FUNCSIG__, __FILE__,
+                               __LINE__);
+        }
+        // a merge that failed left its frozen index behind: retry with it
+        if (_frozen == nullptr)
+        {
+            _frozen = _active;
+            _frozen_end = _next_id;
+            _active = make_mem_index();
+        }
+        frozen = _frozen;
+    }
+    const uint64_t num_new = _frozen_end - disk->num_points;
+
+    std::vector<bool> deleted;
+    uint64_t num_deleted;
+    {
+        std::shared_lock<std::shared_timed_mutex> delete_guard(_delete_lock);
+        deleted.assign(_deleted.begin(), _deleted.begin() + _frozen_end);
+        num_deleted = std::count(deleted.begin(), deleted.begin() + disk->num_points, true);
+    }
+    if (num_new == 0 && num_deleted == 0)
+    {
+        std::unique_lock<std::shared_timed_mutex> guard(_state_lock);
+        _frozen.reset();
+        return false;
+    }
+
+    diskann::cout << "Merging " << num_new << " inserts and " << num_deleted << " deletes into " << out_prefix
+                  << std::endl;
+    write_merged_index(*disk, *frozen, num_new, deleted, out_prefix);
+    std::shared_ptr<DiskIndex> merged = load_disk_index(out_prefix);
+
+    {
+        std::unique_lock<std::shared_timed_mutex> guard(_state_lock);
+        apply_deletes(*merged);
+        _disk = merged;
+        _frozen.reset();
+    }
+    diskann::cout << "Merge done in " << timer.elapsed_seconds() << "s" << std::endl;
+    return true;
+}
+
+template <typename T> void StreamingDiskIndex<T>::start_merge(const std::string &out_prefix)
+{
+    if (_merge_running)
+    {
+        throw ANNException("StreamingDiskIndex: a merge is already running", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    // a finished merge nobody waited for; a failed one left its updates to be retried by this one
+    if (_merge_thread.joinable())
+    {
+        _merge_thread.join();
+        if (_merge_error != nullptr)
+            diskann::cerr << "StreamingDiskIndex: an earlier merge failed, retrying its updates" << std::endl;
+    }
+    _merge_error = nullptr;
+    _merge_running = true;
+    _merge_thread = std::thread([this, out_prefix]() {
+        try
+        {
+            _merge_result = merge(out_prefix);
+        }
+        catch (...)
+        {
+            _merge_error = std::current_exception();
+        }
+        _merge_running = false;
+    });
+}
+
+template <typename T> bool StreamingDiskIndex<T>::wait_for_merge()
+{
+    if (_merge_thread.joinable())
+        _merge_thread.join();
+    if (_merge_error != nullptr)
+    {
+        std::exception_ptr error = _merge_error;
+        _merge_error = nullptr;
+        std::rethrow_exception(error);
+    }
+    return _merge_result;
+}
+
+template <typename T>
+void StreamingDiskIndex<T>::write_merged_index(const DiskIndex &disk, MemIndex &frozen, uint64_t num_new,
+                                               std::vector<bool> &deleted, const std::string &out_prefix)
+{
+    const std::string old_disk_file = disk.prefix + "_disk.index";
+    const std::string new_disk_file = out_prefix + "_disk.index";
+    std::vector<uint64_t> meta = read_disk_meta(old_disk_file);
+    const uint64_t num_old = disk.num_points, num_total = num_old + num_new;
+    const uint64_t dim = _dim, coord_bytes = dim * sizeof(T);
+    const uint64_t max_node_len = meta[3], nnodes_per_sector = meta[4];
+    const uint32_t degree = _max_degree;
+    if (meta[0] != num_old || meta[1] != dim)
+    {
+        throw ANNException("StreamingDiskIndex: " + old_disk_file + " does not match the loaded index", -1,
+                           __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    // entry points keep their edges even when deleted
+    tsl::robin_set<uint32_t> entry_points{(uint32_t)meta[2]};
+    std::string medoids_file = old_disk_file + "_medoids.bin";
+    if (file_exists(medoids_file))
+    {
+        std::unique_ptr<uint32_t[]> medoids;
+        size_t num_medoids, ncols;
+        load_bin<uint32_t>(medoids_file, medoids, num_medoids, ncols);
+        entry_points.insert(medoids.get(), medoids.get() + num_medoids);
+    }
+
+    // the new points, from the frozen index; a failed insert leaves a hole, kept deleted
+    std::vector<T> new_vecs(num_new * dim, 0);
+    for (uint64_t j = 0; j < num_new; j++)
+    {
+        uint32_t tag = (uint32_t)(num_old + j);
+        if (!deleted[tag] && frozen.get_vector_by_tag(tag, new_vecs.data() + j * dim) != 0)
+            deleted[tag] = true;
+    }
+
+    // PQ codes of the new points, from the old pivots
+    const std::string pivots_file = disk.prefix + "_pq_pivots.bin";
+    const std::string old_codes_file = disk.prefix + "_pq_compressed.bin";
+    if (file_exists(pivots_file + "_rotation_matrix.bin"))
+    {
+        throw ANNException("Streaming updates do not support OPQ: " + pivots_file, -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+    }
+    size_t num_codes, n_chunks;
+    get_bin_metadata(old_codes_file, num_codes, n_chunks);
+    std::unique_ptr<uint8_t[]> new_codes;
+    if (num_new > 0)
+    {
+        std::string new_points_file = out_prefix + "_merge_new_points.bin";
+        std::string new_codes_file = out_prefix + "_merge_new_pq_compressed.bin";
+        save_bin<T>(new_points_file, new_vecs.data(), num_new, dim);
+        generate_pq_data_from_pivots<T>(new_points_file, 256, (uint32_t)n_chunks, pivots_file, new_codes_file);
+        size_t n, nc;
+        load_bin<uint8_t>(new_codes_file, new_codes, n, nc);
+        std::remove(new_points_file.c_str());
+        std::remove(new_codes_file.c_str());
+    }
+    FixedChunkPQTable pq_table;
+    pq_table.load_pq_centroid_bin(pivots_file.c_str(), n_chunks);
+
+    // approximate vectors for the distances between neighbours
+    auto candidate_vector = [&](uint32_t id, float *out) {
+        if (id < num_old)
+        {
+            std::vector<uint8_t> code = disk.index->get_pq_vector(id);
+            pq_table.inflate_vector(code.data(), out);
+        }
+        else
+        {
+            const T *vec = new_vecs.data() + (id - num_old) * dim;
+            for (uint64_t d = 0; d < dim; d++)
+                out[d] = (float)vec[d];
+        }
+    };
+
+    // neighbourhoods of the deleted nodes, which replace them in their in-neighbours' lists
+    tsl::robin_map<uint32_t, std::vector<uint32_t>> deleted_nhoods;
+    std::vector<uint32_t> deleted_ids;
+    for (uint32_t id = 0; id < num_old; id++)
+    {
+        if (deleted[id])
+            deleted_ids.push_back(id);
+    }
+    std::vector<uint32_t> nbr_scratch(defaults::MAX_N_SECTOR_READS * (degree + 1));
+    for (uint64_t start = 0; start < deleted_ids.size(); start += defaults::MAX_N_SECTOR_READS)
+    {
+        uint64_t end = (std::min)(start + defaults::MAX_N_SECTOR_READS, (uint64_t)deleted_ids.size());
+        std::vector<uint32_t> batch(deleted_ids.begin() + start, deleted_ids.begin() + end);
+        std::vector<T *> coord_buffers(batch.size(), nullptr);
+        std::vector<std::pair<uint32_t, uint32_t *>> nbr_buffers;
+        for (uint64_t i = 0; i < batch.size(); i++)
+            nbr_buffers.emplace_back(0, nbr_scratch.data() + i * (degree + 1));
+        std::vector<bool> read_ok = disk.index->read_nodes(batch, coord_buffers, nbr_buffers);
+        for (uint64_t i = 0; i < batch.size(); i++)
+        {
+            if (!read_ok[i])
+            {
+                throw ANNException("StreamingDiskIndex: cannot read node " + std::to_string(batch[i]), -1,
+                                   __FUNCSIG__, __FILE__, __LINE__);
+            }
+            deleted_nhoods[batch[i]].assign(nbr_buffers[i].second, nbr_buffers[i].second + nbr_buffers[i].first);
+        }
+    }
+
+    auto write_nhood = [&](const T *center, const std::vector<uint32_t> &cands, const std::vector<float> *dists,
+                           uint32_t *nhood) {
+        prune_nhood(center, cands, dists, candidate_vector, dim, _alpha, degree, nhood);
+    };
+
+    // link the new points: candidates from the SSD graph and from the frozen index
+    std::vector<std::vector<uint32_t>> new_nhoods(num_new);
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> thread_edges(_num_threads);
+    const uint64_t k_disk = (std::min)((uint64_t)_l, num_old);
+#pragma omp parallel for schedule(dynamic, 16) num_threads(_num_threads)
+    for (int64_t j = 0; j < (int64_t)num_new; j++)
+    {
+        uint32_t id = (uint32_t)(num_old + j);
+        if (deleted[id])
+            continue;
+        const T *vec = new_vecs.data() + j * dim;
+        std::vector<uint32_t> cands;
+        std::vector<float> cand_dists;
+
+        std::vector<uint64_t> disk_ids(k_disk);
+        std::vector<float> disk_dists(k_disk);
+        disk.index->cached_beam_search(vec, k_disk, _l, disk_ids.data(), disk_dists.data(), _beam_width);
+        for (uint64_t i = 0; i < k_disk; i++)
+        {
+            if (disk_ids[i] < num_old && !deleted[disk_ids[i]])
+            {
+                cands.push_back((uint32_t)disk_ids[i]);
+                cand_dists.push_back(disk_dists[i]);
+            }
+        }
+        std::vector<uint32_t> tags(_l);
+        std::vector<float> tag_dists(_l);
+        std::vector<T *> res_vectors;
+        size_t n = frozen.search_with_tags(vec, _l, _l, tags.data(), tag_dists.data(), res_vectors);
+        for (size_t i = 0; i < n; i++)
+        {
+            if (tags[i] != id && tags[i] < num_total && !deleted[tags[i]])
+            {
+                cands.push_back(tags[i]);
+                cand_dists.push_back(tag_dists[i]);
+            }
+        }
+
+        std::vector<uint32_t> nhood(degree + 1);
+        write_nhood(vec, cands, &cand_dists, nhood.data());
+        new_nhoods[j].assign(nhood.begin() + 1, nhood.begin() + 1 + nhood[0]);
+        auto &edges = thread_edges[omp_get_thread_num()];
+        for (uint32_t nbr : new_nhoods[j])
+            edges.emplace_back(nbr, id);
+    }
+    // reverse edges to the new points, sorted by the node they are added to
+    std::vector<std::pair<uint32_t, uint32_t>> reverse_edges;
+    for (auto &edges : thread_edges)
+    {
+        reverse_edges.insert(reverse_edges.end(), edges.begin(), edges.end());
+        std::vector<std::pair<uint32_t, uint32_t>>().swap(edges);
+    }
+    std::sort(reverse_edges.begin(), reverse_edges.end());
+    diskann::cout << "Linked " << num_new << " new points, " << reverse_edges.size() << " reverse edges"
+                  << std::endl;
+
+    // Stream the graph into the new file a block of sectors at a time. A unit is the
+    // sector holding nnodes_per_sector nodes, or the run of sectors of one node.
+    const uint64_t nodes_per_unit = nnodes_per_sector > 0 ? nnodes_per_sector : 1;
+    const uint64_t sectors_per_unit = nnodes_per_sector > 0 ? 1 : DIV_ROUND_UP(max_node_len, defaults::SECTOR_LEN);
+    const uint64_t unit_len = sectors_per_unit * defaults::SECTOR_LEN;
+    const uint64_t old_units = DIV_ROUND_UP(num_old, nodes_per_unit);
+    const uint64_t new_units = DIV_ROUND_UP(num_total, nodes_per_unit);
+    const uint64_t block_units = (std::max)((uint64_t)1, defaults::STREAMING_MERGE_BLOCK_SECTORS / sectors_per_unit);
+
+    std::ifstream old_file(old_disk_file, std::ios::binary);
+    std::ofstream new_file(new_disk_file, std::ios::binary);
+    if (!old_file || !new_file)
+    {
+        throw ANNException("StreamingDiskIndex: cannot open " + old_disk_file + " or " + new_disk_file, -1,
+                           __FUNCSIG__, __FILE__, __LINE__);
+    }
+    std::vector<char> block(block_units * unit_len, 0);
+    // the header sector is written once the rest is
+    new_file.write(block.data(), defaults::SECTOR_LEN);
+
+    uint64_t num_patched = 0;
+    for (uint64_t u0 = 0; u0 < new_units; u0 += block_units)
+    {
+        const uint64_t u1 = (std::min)(u0 + block_units, new_units);
+        std::fill(block.begin(), block.end(), 0);
+        if (u0 < old_units)
+        {
+            old_file.seekg((1 + u0 * sectors_per_unit) * defaults::SECTOR_LEN);
+            old_file.read(block.data(), ((std::min)(u1, old_units) - u0) * unit_len);
+            if (!old_file)
+            {
+                throw ANNException("StreamingDiskIndex: short read from " + old_disk_file, -1, __FUNCSIG__, __FILE__,
+                                   __LINE__);
+            }
+        }
+
+        const uint64_t first_id = u0 * nodes_per_unit, last_id = (std::min)(u1 * nodes_per_unit, num_total);
+#pragma omp parallel for schedule(dynamic, 64) num_threads(_num_threads) reduction(+ : num_patched)
+        for (int64_t node_id = (int64_t)first_id; node_id < (int64_t)last_id; node_id++)
+        {
+            const uint32_t id = (uint32_t)node_id;
+            char *node = block.data() + (id / nodes_per_unit - u0) * unit_len + (id % nodes_per_unit) * max_node_len;
+            uint32_t *nhood = (uint32_t *)(node + coord_bytes);
+            if (id >= num_old)
+                memcpy(node, new_vecs.data() + (id - num_old) * dim, coord_bytes);
+            if (deleted[id] && entry_points.find(id) == entry_points.end())
+            {
+                nhood[0] = 0;
+                continue;
+            }
+
+            auto edges = std::equal_range(reverse_edges.begin(), reverse_edges.end(), std::make_pair(id, 0u),
+                                          [](const std::pair<uint32_t, uint32_t> &a,
+                                             const std::pair<uint32_t, uint32_t> &b) { return a.first < b.first; });
+            const uint32_t *old_nbrs = id < num_old ? nhood + 1 : new_nhoods[id - num_old].data();
+            const uint32_t num_old_nbrs = id < num_old ? nhood[0] : (uint32_t)new_nhoods[id - num_old].size();
+            bool changed = id >= num_old || edges.first != edges.second;
+            for (uint32_t i = 0; i < num_old_nbrs && !changed; i++)
+                changed = deleted[old_nbrs[i]];
+            if (!changed)
+                continue;
+
+            std::vector<uint32_t> cands;
+            tsl::robin_set<uint32_t> seen{id};
+            auto add = [&](uint32_t cand) {
+                if (!deleted[cand] && seen.insert(cand).second)
+                    cands.push_back(cand);
+            };
+            for (uint32_t i = 0; i < num_old_nbrs; i++)
+            {
+                uint32_t nbr = old_nbrs[i];
+                if (!deleted[nbr])
+                {
+                    add(nbr);
+                    continue;
+                }
+                auto deleted_nhood = deleted_nhoods.find(nbr);
+                if (deleted_nhood != deleted_nhoods.end())
+                {
+                    for (uint32_t nbr_nbr : deleted_nhood->second)
+                        add(nbr_nbr);
+                }
+            }
+            for (auto edge = edges.first; edge != edges.second; edge++)
+                add(edge->second);
+            write_nhood((const T *)node, cands, nullptr, nhood);
+            num_patched++;
+        }
+        new_file.write(block.data(), (u1 - u0) * unit_len);
+    }
+    new_file.close();
+    old_file.close();
+    // a short write would leave a truncated index for the merge to switch to
+    if (new_file.fail())
+    {
+        throw ANNException("StreamingDiskIndex: cannot write " + new_disk_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    const uint64_t file_size = (1 + new_units * sectors_per_unit) * defaults::SECTOR_LEN;
+    std::vector<uint64_t> new_meta{num_total, dim, meta[2], max_node_len, nnodes_per_sector, 0, 0, 0, file_size};
+    save_bin<uint64_t>(new_disk_file, new_meta.data(), new_meta.size(), 1, 0);
+    diskann::cout << "Patched " << num_patched << " neighbour lists into " << new_disk_file << std::endl;
+
+    // PQ data: the old pivots and codes, with the new codes appended
+    copy_file(pivots_file, out_prefix + "_pq_pivots.bin");
+    const std::string new_codes_file = out_prefix + "_pq_compressed.bin";
+    copy_file(old_codes_file, new_codes_file);
+    std::fstream codes_writer(new_codes_file, std::ios::binary | std::ios::in | std::ios::out);
+    int32_t npts_i32 = (int32_t)num_total;
+    codes_writer.write((char *)&npts_i32, sizeof(int32_t));
+    codes_writer.seekp(0, std::ios::end);
+    if (num_new > 0)
+        codes_writer.write((char *)new_codes.get(), num_new * n_chunks);
+    codes_writer.close();
+    if (codes_writer.fail())
+    {
+        throw ANNException("StreamingDiskIndex: cannot write " + new_codes_file, -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    for (const std::string suffix : {"_medoids.bin", "_centroids.bin"})
+    {
+        if (file_exists(old_disk_file + suffix))
+            copy_file(old_disk_file + suffix, new_disk_file + suffix);
+    }
+    // the deletes are marked once the new index is loaded; a set left at out_prefix is stale
+    std::remove((new_disk_file + "_deleted_ids.bin").c_str());
+}
+
+template <typename T>
+void StreamingDiskIndex<T>::apply_deletes(DiskIndex &disk)
+{
+    std::vector<uint32_t> deleted_ids;
+    {
+        std::shared_lock<std::shared_timed_mutex> delete_guard(_delete_lock);
+        for (uint32_t id = 0; id < disk.num_points && id < _deleted.size(); id++)
+        {
+            if (_deleted[id])
+                deleted_ids.push_back(id);
+        }
+    }
+    disk.index->delete_points(deleted_ids);
+    // the new index holds them all; those still unsaved were marked in the old one
+    _deletes_unsaved = false;
+}
+
+template <typename T> std::string StreamingDiskIndex<T>::index_prefix()
+{
+    std::shared_lock<std::shared_timed_mutex> guard(_state_lock);
+    return _disk->prefix;
+}
+
+template <typename T> uint64_t StreamingDiskIndex<T>::num_disk_points()
+{
+    std::shared_lock<std::shared_timed_mutex> guard(_state_lock);
+    return _disk->num_points;
+}
+
+template <typename T> uint64_t StreamingDiskIndex<T>::num_mem_points()
+{
+    std::shared_lock<std::shared_timed_mutex> guard(_state_lock);
+    return _next_id - _disk->num_points;
+}
+
+template <typename T> uint64_t StreamingDiskIndex<T>::num_deleted()
+{
+    std::shared_lock<std::shared_timed_mutex> delete_guard(_delete_lock);
+    return _num_deleted;
+}
+
+template <typename T>
+bool compact_disk_index(const std::string &index_prefix, const std::string &out_prefix, uint32_t num_threads,
+                        float min_deleted_fraction, float alpha)
+{
+    Timer timer;
+    const std::string old_disk_file = index_prefix + "_disk.index";
+    const std::string new_disk_file = out_prefix + "_disk.index";
+    if (out_prefix == index_prefix)
+    {
+        throw ANNException("compact_disk_index: compact into another prefix", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+    std::vector<uint64_t> meta = read_disk_meta(old_disk_file);
+    const uint64_t num_old = meta[0], dim = meta[1], coord_bytes = dim * sizeof(T);
+    const uint64_t max_node_len = meta[3], nnodes_per_sector = meta[4];
+    const uint32_t degree = (uint32_t)((max_node_len - coord_bytes) / sizeof(uint32_t) - 1);
+
+    std::vector<bool> deleted(num_old, false);
+    uint64_t num_deleted = 0;
+    const std::string deleted_file = old_disk_file + "_deleted_ids.bin";
+    if (file_exists(deleted_file))
+    {
+        std::unique_ptr<uint32_t[]> deleted_ids;
+        size_t num_ids, ncols;
+        load_bin<uint32_t>(deleted_file, deleted_ids, num_ids, ncols);
+        for (size_t i = 0; i < num_ids; i++)
+        {
+            if (deleted_ids[i] < num_old && !deleted[deleted_ids[i]])
+            {
+                deleted[deleted_ids[i]] = true;
+                num_deleted++;
+            }
+        }
+    }
+    diskann::cout << num_deleted << " of " << num_old << " points of " << old_disk_file << " are deleted"
+                  << std::endl;
+    if (num_deleted == 0 || num_deleted < min_deleted_fraction * num_old)
+        return false;
+    if (num_deleted == num_old)
+    {
+        throw ANNException("compact_disk_index: every point is deleted", -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+
+    std::vector<uint32_t> new_to_old;
+    std::vector<uint32_t> old_to_new(num_old, std::numeric_limits<uint32_t>::max());
+    for (uint32_t id = 0; id < num_old; id++)
+    {
+        if (!deleted[id])
+        {
+            old_to_new[id] = (uint32_t)new_to_old.size();
+            new_to_old.push_back(id);
+        }
+    }
+    const uint64_t num_new = new_to_old.size();
+
+    // PQ codes, for the distances between neighbours and for the new codes file
+    const std::string pivots_file = index_prefix + "_pq_pivots.bin";
+    if (file_exists(pivots_file + "_rotation_matrix.bin"))
+    {
+        throw ANNException("compact_disk_index does not support OPQ: " + pivots_file, -1, __FUNCSIG__, __FILE__,
+                           __LINE__);
+    }
+    std::unique_ptr<uint8_t[]> codes;
+    size_t num_codes, n_chunks;
+    load_bin<uint8_t>(index_prefix + "_pq_compressed.bin", codes, num_codes, n_chunks);
+    FixedChunkPQTable pq_table;
+    pq_table.load_pq_centroid_bin(pivots_file.c_str(), n_chunks);
+    std::function<void(uint32_t, float *)> candidate_vector = [&](uint32_t id, float *out) {
+        pq_table.inflate_vector(codes.get() + (uint64_t)id * n_chunks, out);
+    };
+
+    const uint64_t nodes_per_unit = nnodes_per_sector > 0 ? nnodes_per_sector : 1;
+    const uint64_t sectors_per_unit = nnodes_per_sector > 0 ? 1 : DIV_ROUND_UP(max_node_len, defaults::SECTOR_LEN);
+    const uint64_t unit_len = sectors_per_unit * defaults::SECTOR_LEN;
+    const uint64_t old_units = DIV_ROUND_UP(num_old, nodes_per_unit);
+    const uint64_t new_units = DIV_ROUND_UP(num_new, nodes_per_unit);
+    const uint64_t block_units = (std::max)((uint64_t)1, defaults::STREAMING_MERGE_BLOCK_SECTORS / sectors_per_unit);
+
+    // Nodes are read in increasing id order, through a window of old units that only
+    // moves forward, so both passes read the old file sequentially.
+    std::ifstream old_file(old_disk_file, std::ios::binary);
+    std::vector<char> window(block_units * unit_len);
+    uint64_t window_start = 0, window_end = 0;
+    auto old_node = [&](uint32_t id) {
+        uint64_t unit = id / nodes_per_unit;
+        if (unit < window_start || unit >= window_end)
+        {
+            window_start = unit;
+            window_end = (std::min)(unit + block_units, old_units);
+            old_file.seekg((1 + window_start * sectors_per_unit) * defaults::SECTOR_LEN);
+            old_file.read(window.data(), (window_end - window_start) * unit_len);
+            if (!old_file)
+            {
+                throw ANNException("compact_disk_index: short read from " + old_disk_file, -1, __FUNCSIG__, __FILE__,
+                                   __LINE__);
+            }
+        }
+        return window.data() + (unit - window_start) * unit_len + (id % nodes_per_unit) * max_node_len;
+    };
+
+    // pass 1: the neighbourhoods of the deleted nodes
+    tsl::robin_map<uint32_t, std::vector<uint32_t>> deleted_nhoods;
+    for (uint32_t id = 0; id < num_old; id++)
+    {
+        if (!deleted[id])
+            continue;
+        uint32_t *nhood = (uint32_t *)(old_node(id) + coord_bytes);
+        deleted_nhoods[id].assign(nhood + 1, nhood + 1 + nhood[0]);
+    }
+
+    // entry points that were deleted hand over to a live neighbour
+    auto live_entry = [&](uint32_t id) {
+        if (!deleted[id])
+            return old_to_new[id];
+        for (uint32_t nbr : deleted_nhoods.at(id))
+        {
+            if (!deleted[nbr])
+                return old_to_new[nbr];
+        }
+        throw ANNException("compact_disk_index: no live neighbour to replace entry point " + std::to_string(id), -1,
+                           __FUNCSIG__, __FILE__, __LINE__);
+    };
+    const uint32_t new_medoid = live_entry((uint32_t)meta[2]);
+
+    // pass 2: the live nodes, renumbered, a block at a time
+    std::ofstream new_file(new_disk_file, std::ios::binary);
+    std::vector<char> block(block_units * unit_len, 0);
+    new_file.write(block.data(), defaults::SECTOR_LEN);
+    for (uint64_t u0 = 0; u0 < new_units; u0 += block_units)
+    {
+        const uint64_t u1 = (std::min)(u0 + block_units, new_units);
+        const uint64_t first_id = u0 * nodes_per_unit, last_id = (std::min)(u1 * nodes_per_unit, num_new);
+        std::fill(block.begin(), block.end(), 0);
+        auto new_node = [&](uint64_t id) {
+            return block.data() + (id / nodes_per_unit - u0) * unit_len + (id % nodes_per_unit) * max_node_len;
+        };
+        for (uint64_t id = first_id; id < last_id; id++)
+            memcpy(new_node(id), old_node(new_to_old[id]), max_node_len);
+
+#pragma omp parallel for schedule(dynamic, 64) num_threads(num_threads)
+        for (int64_t id = (int64_t)first_id; id < (int64_t)last_id; id++)
+        {
+            char *node = new_node(id);
+            uint32_t *nhood = (uint32_t *)(node + coord_bytes);
+            const uint32_t old_id = new_to_old[id];
+            std::vector<uint32_t> cands(nhood + 1, nhood + 1 + nhood[0]);
+            bool changed = false;
+            for (uint32_t nbr : cands)
+                changed = changed || deleted[nbr];
+            if (changed)
+            {
+                tsl::robin_set<uint32_t> seen{old_id};
+                std::vector<uint32_t> live;
+                for (uint32_t nbr : cands)
+                {
+                    if (!deleted[nbr])
+                    {
+                        if (seen.insert(nbr).second)
+                            live.push_back(nbr);
+                        continue;
+                    }
+                    for (uint32_t nbr_nbr : deleted_nhoods.at(nbr))
+                    {
+                        if (!deleted[nbr_nbr] && seen.insert(nbr_nbr).second)
+                            live.push_back(nbr_nbr);
+                    }
+                }
+                prune_nhood((const T *)node, live, nullptr, candidate_vector, dim, alpha, degree, nhood);
+            }
+            for (uint32_t i = 0; i < nhood[0]; i++)
+                nhood[1 + i] = old_to_new[nhood[1 + i]];
+        }
+        new_file.write(block.data(), (u1 - u0) * unit_len);
+    }
+    new_file.close();
+    const uint64_t file_size = (1 + new_units * sectors_per_unit) * defaults::SECTOR_LEN;
+    std::vector<uint64_t> new_meta{num_new, dim, new_medoid, max_node_len, nnodes_per_sector, 0, 0, 0, file_size};
+    save_bin<uint64_t>(new_disk_file, new_meta.data(), new_meta.size(), 1, 0);
+
+    // PQ data of the live points, the entry points and the id map
+    copy_file(pivots_file, out_prefix + "_pq_pivots.bin");
+    std::vector<uint8_t> new_codes(num_new * n_chunks);
+    for (uint64_t id = 0; id < num_new; id++)
+        memcpy(new_codes.data() + id * n_chunks, codes.get() + (uint64_t)new_to_old[id] * n_chunks, n_chunks);
+    save_bin<uint8_t>(out_prefix + "_pq_compressed.bin", new_codes.data(), num_new, n_chunks);
+    const std::string medoids_file = old_disk_file + "_medoids.bin";
+    if (file_exists(medoids_file))
+    {
+        std::unique_ptr<uint32_t[]> medoids;
+        size_t num_medoids, ncols;
+        load_bin<uint32_t>(medoids_file, medoids, num_medoids, ncols);
+        for (size_t i = 0; i < num_medoids; i++)
+            medoids[i] = live_entry(medoids[i]);
+        save_bin<uint32_t>(new_disk_file + "_medoids.bin", medoids.get(), num_medoids, 1);
+    }
+    if (file_exists(old_disk_file + "_centroids.bin"))
+        copy_file(old_disk_file + "_centroids.bin", new_disk_file + "_centroids.bin");
+    save_bin<uint32_t>(new_disk_file + "_old_ids.bin", new_to_old.data(), num_new, 1);
+
+    diskann::cout << "Compacted " << old_disk_file << " into " << new_disk_file << ": " << num_new << " points, "
+                  << timer.elapsed_seconds() << "s" << std::endl;
+    return true;
+}
+
+// instantiations
+template class StreamingDiskIndex<float>;
+template class StreamingDiskIndex<int8_t>;
+template class StreamingDiskIndex<uint8_t>;
+
+template DISKANN_DLLEXPORT bool compact_disk_index<float>(const std::string &, const std::string &, uint32_t, float,
+                                                          float);
+template DISKANN_DLLEXPORT bool compact_disk_index<int8_t>(const std::string &, const std::string &, uint32_t, float,
+                                                           float);
+template DISKANN_DLLEXPORT bool compact_disk_index<uint8_t>(const std::string &, const std::string &, uint32_t, float,
+                                                            float);
+} // namespace diskann
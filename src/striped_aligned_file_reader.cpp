@@ -0,0 +1,364 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "striped_aligned_file_reader.h"
+
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "tsl/robin_map.h"
+#include "tsl/robin_set.h"
+#include "defaults.h"
+#include "utils.h"
+#define MAX_EVENTS 1024
+
+namespace
+{
+typedef struct io_event io_event_t;
+typedef struct iocb iocb_t;
+
+uint64_t num_pieces(const AlignedRead &req, uint64_t stripe_unit)
+{
+    return (req.offset + req.len - 1) / stripe_unit - req.offset / stripe_unit + 1;
+}
+} // namespace
+
+StripedAlignedFileReader::StripedAlignedFileReader()
+{
+    this->bad_ctx.aio_ctx = (io_context_t)-1;
+}
+
+StripedAlignedFileReader::~StripedAlignedFileReader()
+{
+    if (!this->file_descs.empty())
+    {
+        std::cerr << "close() not called" << std::endl;
+        this->close();
+    }
+}
+
+IOContext &StripedAlignedFileReader::get_ctx()
+{
+    std::unique_lock<std::mutex> lk(ctx_mut);
+    if (ctx_map.find(std::this_thread::get_id()) == ctx_map.end())
+    {
+        std::cerr << "bad thread access; returning -1 as io_context_t" << std::endl;
+        return this->bad_ctx;
+    }
+    else
+    {
+        return ctx_map[std::this_thread::get_id()];
+    }
+}
+
+void StripedAlignedFileReader::register_thread()
+{
+    auto my_id = std::this_thread::get_id();
+    std::unique_lock<std::mutex> lk(ctx_mut);
+    if (ctx_map.find(my_id) != ctx_map.end())
+    {
+        std::cerr << "multiple calls to register_thread from the same thread" << std::endl;
+        return;
+    }
+    io_context_t ctx = 0;
+    int ret = io_setup(MAX_EVENTS, &ctx);
+    if (ret != 0)
+    {
+        lk.unlock();
+        std::cerr << "io_setup() failed; returned " << ret << ", errno=" << errno << ":" << ::strerror(errno)
+                  << std::endl;
+        return;
+    }
+    diskann::cout << "allocating ctx: " << ctx << " to thread-id:" << my_id << std::endl;
+    ctx_map[my_id].aio_ctx = ctx;
+    ctx_map[my_id].striped = new StripedIOState();
+}
+
+void StripedAlignedFileReader::deregister_thread()
+{
+    auto my_id = std::this_thread::get_id();
+    std::unique_lock<std::mutex> lk(ctx_mut);
+    auto iter = ctx_map.find(my_id);
+    assert(iter != ctx_map.end());
+    if (iter == ctx_map.end())
+        return;
+
+    io_destroy(iter->second.aio_ctx);
+    delete iter->second.striped;
+    ctx_map.erase(my_id);
+    std::cerr << "returned ctx from thread-id:" << my_id << std::endl;
+}
+
+void StripedAlignedFileReader::deregister_all_threads()
+{
+    std::unique_lock<std::mutex> lk(ctx_mut);
+    for (auto x = ctx_map.begin(); x != ctx_map.end(); x++)
+    {
+        io_destroy(x.value().aio_ctx);
+        delete x.value().striped;
+    }
+    ctx_map.clear();
+}
+
+void StripedAlignedFileReader::open(const std::string &fname)
+{
+    this->stripe_paths.assign(1, fname);
+    this->stripe_unit = diskann::defaults::SECTOR_LEN;
+
+    std::string manifest = fname + "_stripes.txt";
+    if (file_exists(manifest))
+    {
+        std::ifstream in(manifest);
+        uint64_t stripe_sectors = 0;
+        in >> stripe_sectors;
+        if (stripe_sectors == 0)
+        {
+            throw diskann::ANNException("Invalid stripe size in " + manifest, -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        this->stripe_unit = stripe_sectors * diskann::defaults::SECTOR_LEN;
+        std::string path;
+        while (in >> path)
+            this->stripe_paths.push_back(path);
+    }
+
+    for (auto &path : this->stripe_paths)
+    {
+        FileHandle fd = ::open(path.c_str(), O_DIRECT | O_RDONLY | O_LARGEFILE);
+        if (fd == -1)
+        {
+            std::stringstream stream;
+            stream << "open(" << path << ") failed; errno=" << errno << ":" << ::strerror(errno);
+            throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        this->file_descs.push_back(fd);
+    }
+
+    uint64_t n_dev = this->file_descs.size();
+    this->dev_reads.reset(new std::atomic<uint64_t>[n_dev]);
+    this->dev_bytes.reset(new std::atomic<uint64_t>[n_dev]);
+    this->dev_us.reset(new std::atomic<uint64_t>[n_dev]);
+    for (uint64_t d = 0; d < n_dev; d++)
+    {
+        this->dev_reads[d] = 0;
+        this->dev_bytes[d] = 0;
+        this->dev_us[d] = 0;
+    }
+    std::cerr << "Opened file : " << fname << " striped over " << n_dev << " file(s), " << this->stripe_unit
+              << " bytes per stripe unit" << std::endl;
+}
+
+void StripedAlignedFileReader::close()
+{
+    for (auto fd : this->file_descs)
+        ::close(fd);
+    this->file_descs.clear();
+}
+
+void StripedAlignedFileReader::read(std::vector<AlignedRead> &read_reqs, IOContext &ctx, bool async)
+{
+    if (async == true)
+    {
+        diskann::cout << "Async currently not supported in linux." << std::endl;
+    }
+
+    StripedIOState *state = ctx.striped;
+    if (state == nullptr)
+    {
+        throw diskann::ANNException("StripedAlignedFileReader used with an unregistered context", -1, __FUNCSIG__,
+                                    __FILE__, __LINE__);
+    }
+    // keep at most MAX_EVENTS pieces in flight, the capacity of the aio context, counting
+    // those of submit_reqs() reads on the same context
+    auto pieces_in_flight = [&]() { return (uint64_t)(state->pieces.size() - state->free_pieces.size()); };
+    std::vector<AlignedRead> batch;
+    std::vector<void *> completed;
+    tsl::robin_set<void *> batch_bufs;
+    uint64_t batch_pieces = 0;
+
+    // reaps once; whatever is not the batch's is kept for the caller of submit_reqs()
+    auto reap_some = [&]() {
+        completed.clear();
+        auto sort_completed = [&]() {
+            for (void *buf : completed)
+            {
+                if (batch_bufs.erase(buf) == 0)
+                    state->requeued.push_back(buf);
+            }
+        };
+        try
+        {
+            reap(ctx, 1, completed);
+        }
+        catch (...)
+        {
+            sort_completed();
+            throw;
+        }
+        sort_completed();
+    };
+    auto run_batch = [&]() {
+        submit_reqs(batch, ctx);
+        for (auto &req : batch)
+            batch_bufs.insert(req.buf);
+        while (!batch_bufs.empty())
+            reap_some();
+        batch.clear();
+        batch_pieces = 0;
+    };
+
+    for (auto &req : read_reqs)
+    {
+        uint64_t n = num_pieces(req, this->stripe_unit);
+        if (!batch.empty() && pieces_in_flight() + batch_pieces + n > MAX_EVENTS)
+            run_batch();
+        // submitted reads may fill the context: wait for some of them first
+        while (batch.empty() && pieces_in_flight() > 0 && pieces_in_flight() + n > MAX_EVENTS)
+            reap_some();
+        batch.push_back(req);
+        batch_pieces += n;
+    }
+    if (!batch.empty())
+        run_batch();
+}
+
+void StripedAlignedFileReader::submit_reqs(std::vector<AlignedRead> &read_reqs, IOContext &ctx)
+{
+    StripedIOState *state = ctx.striped;
+    if (state == nullptr)
+    {
+        throw diskann::ANNException("StripedAlignedFileReader used with an unregistered context", -1, __FUNCSIG__,
+                                    __FILE__, __LINE__);
+    }
+
+    uint64_t n_dev = this->file_descs.size();
+    auto now = std::chrono::steady_clock::now();
+    std::vector<iocb_t> cb;
+    cb.reserve(read_reqs.size());
+    for (auto &req : read_reqs)
+    {
+        // split at stripe unit boundaries; piece k of the request reads into buf + (its offset - req.offset)
+        uint64_t offset = req.offset, end = req.offset + req.len;
+        uint32_t n_req_pieces = 0;
+        while (offset < end)
+        {
+            uint64_t unit = offset / this->stripe_unit;
+            uint64_t unit_end = (unit + 1) * this->stripe_unit;
+            uint64_t len = std::min(end, unit_end) - offset;
+            uint32_t dev = (uint32_t)(unit % n_dev);
+            uint64_t file_offset = (unit / n_dev) * this->stripe_unit + offset % this->stripe_unit;
+
+            uint32_t idx;
+            if (state->free_pieces.empty())
+            {
+                idx = (uint32_t)state->pieces.size();
+                state->pieces.emplace_back();
+            }
+            else
+            {
+                idx = state->free_pieces.back();
+                state->free_pieces.pop_back();
+            }
+            state->pieces[idx] = {req.buf, dev, len, now};
+
+            cb.emplace_back();
+            io_prep_pread(&cb.back(), this->file_descs[dev], (char *)req.buf + (offset - req.offset), len,
+                          file_offset);
+            cb.back().data = (void *)(uintptr_t)idx;
+            offset += len;
+            n_req_pieces++;
+        }
+        state->remaining[req.buf] = n_req_pieces;
+    }
+
+    std::vector<iocb_t *> cbs(cb.size());
+    for (uint64_t j = 0; j < cb.size(); j++)
+        cbs[j] = cb.data() + j;
+
+    uint64_t n_submitted = 0;
+    while (n_submitted < cbs.size())
+    {
+        int64_t ret = io_submit(ctx.aio_ctx, (int64_t)(cbs.size() - n_submitted), cbs.data() + n_submitted);
+        if (ret <= 0)
+        {
+            std::stringstream stream;
+            stream << "io_submit() failed; returned " << ret << ", expected=" << cbs.size() - n_submitted
+                   << ", ernno=" << errno << "=" << ::strerror(-ret);
+            throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        n_submitted += (uint64_t)ret;
+    }
+}
+
+void StripedAlignedFileReader::get_completions(IOContext &ctx, uint64_t min_completions,
+                                               std::vector<void *> &completed_bufs)
+{
+    std::vector<void *> &requeued = ctx.striped->requeued;
+    uint64_t n_requeued = requeued.size();
+    completed_bufs.insert(completed_bufs.end(), requeued.begin(), requeued.end());
+    requeued.clear();
+    if (n_requeued < min_completions)
+        reap(ctx, min_completions - n_requeued, completed_bufs);
+}
+
+void StripedAlignedFileReader::reap(IOContext &ctx, uint64_t min_completions, std::vector<void *> &completed_bufs)
+{
+    StripedIOState *state = ctx.striped;
+    io_event_t evts[MAX_EVENTS];
+    uint64_t n_reported = 0;
+    int64_t first_error = 0;
+    do
+    {
+        int64_t ret = io_getevents(ctx.aio_ctx, 1, MAX_EVENTS, evts, nullptr);
+        if (ret < 1)
+        {
+            std::stringstream stream;
+            stream << "io_getevents() failed; returned " << ret << ", ernno=" << errno << "=" << ::strerror(-ret);
+            throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+        }
+        auto now = std::chrono::steady_clock::now();
+        for (int64_t i = 0; i < ret; i++)
+        {
+            // a failed piece still completes its request, so that every reaped buf is handed back
+            if ((int64_t)evts[i].res < 0 && first_error == 0)
+                first_error = (int64_t)evts[i].res;
+            uint32_t idx = (uint32_t)(uintptr_t)evts[i].data;
+            const StripedIOState::Piece &piece = state->pieces[idx];
+            this->dev_reads[piece.device]++;
+            this->dev_bytes[piece.device] += piece.len;
+            this->dev_us[piece.device] +=
+                (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - piece.issued).count();
+
+            auto iter = state->remaining.find(piece.req_buf);
+            assert(iter != state->remaining.end());
+            if (--iter.value() == 0)
+            {
+                completed_bufs.push_back(piece.req_buf);
+                state->remaining.erase(iter);
+                n_reported++;
+            }
+            state->free_pieces.push_back(idx);
+        }
+    } while (n_reported < min_completions);
+
+    if (first_error != 0)
+    {
+        std::stringstream stream;
+        stream << "async read failed; res=" << first_error << "=" << ::strerror(-first_error);
+        throw diskann::ANNException(stream.str(), -1, __FUNCSIG__, __FILE__, __LINE__);
+    }
+}
+
+std::vector<StripedAlignedFileReader::DeviceStats> StripedAlignedFileReader::get_device_stats() const
+{
+    std::vector<DeviceStats> stats(this->stripe_paths.size());
+    for (uint64_t d = 0; d < stats.size(); d++)
+    {
+        stats[d].path = this->stripe_paths[d];
+        stats[d].n_reads = this->dev_reads[d];
+        stats[d].n_bytes = this->dev_bytes[d];
+        stats[d].total_us = this->dev_us[d];
+    }
+    return stats;
+}
@@ -0,0 +1,51 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include "adjacency_codec.h"
+
+BOOST_AUTO_TEST_SUITE(AdjacencyCodec_tests)
+
+BOOST_AUTO_TEST_CASE(test_round_trip)
+{
+    for (uint64_t n = 0; n <= 70; n++)
+    {
+        std::vector<uint32_t> ids(n);
+        for (auto &id : ids)
+            id = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+        std::vector<uint32_t> expected = ids;
+        std::sort(expected.begin(), expected.end());
+
+        // sized exactly, so the decoder must fall back to scalar near the end
+        std::vector<uint8_t> encoded(diskann::adjacency_max_encoded_len(n));
+        uint64_t len = diskann::encode_adjacency(ids.data(), n, encoded.data());
+        BOOST_TEST(len <= encoded.size());
+
+        std::vector<uint32_t> decoded(n);
+        diskann::decode_adjacency(encoded.data(), encoded.data() + len, n, decoded.data());
+        BOOST_TEST(decoded == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_small_deltas_compress)
+{
+    std::vector<uint32_t> ids;
+    for (uint32_t i = 0; i < 64; i++)
+        ids.push_back(1000000 + 37 * i);
+    std::vector<uint32_t> expected = ids;
+
+    std::vector<uint8_t> encoded(diskann::adjacency_max_encoded_len(ids.size()) + 16);
+    uint64_t len = diskann::encode_adjacency(ids.data(), ids.size(), encoded.data());
+    // one 3-byte first delta, 1-byte deltas after that, one control byte per 4 ids
+    BOOST_TEST(len == 16 + 3 + 63);
+
+    std::vector<uint32_t> decoded(ids.size());
+    diskann::decode_adjacency(encoded.data(), encoded.data() + encoded.size(), ids.size(), decoded.data());
+    BOOST_TEST(decoded == expected);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
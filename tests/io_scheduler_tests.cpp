@@ -0,0 +1,199 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ann_exception.h"
+#include "io_scheduler.h"
+#include "scheduled_aligned_file_reader.h"
+
+namespace
+{
+// returns once `n` threads are blocked in acquire()
+void wait_for_waiters(diskann::IOScheduler &scheduler, uint64_t n)
+{
+    while (scheduler.num_waiting() < n)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+// completes every read at once; submitted ones wait in a list for get_completions()
+class InstantReader : public AlignedFileReader
+{
+  public:
+    IOContext ctx;
+    std::vector<void *> submitted;
+
+    IOContext &get_ctx()
+    {
+        return ctx;
+    }
+    void register_thread()
+    {
+    }
+    void deregister_thread()
+    {
+    }
+    void deregister_all_threads()
+    {
+    }
+    void open(const std::string &fname)
+    {
+    }
+    void close()
+    {
+    }
+    void read(std::vector<AlignedRead> &read_reqs, IOContext &ctx, bool async = false)
+    {
+    }
+    void submit_reqs(std::vector<AlignedRead> &read_reqs, IOContext &ctx)
+    {
+        for (auto &req : read_reqs)
+            submitted.push_back(req.buf);
+    }
+    void get_completions(IOContext &ctx, uint64_t min_completions, std::vector<void *> &completed_bufs)
+    {
+        completed_bufs.insert(completed_bufs.end(), submitted.begin(), submitted.end());
+        submitted.clear();
+    }
+};
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(IOScheduler_tests)
+
+BOOST_AUTO_TEST_CASE(test_weighted_grant_order)
+{
+    std::vector<diskann::IOScheduler::ClassConfig> classes(2);
+    classes[0].weight = 3;
+    classes[1].weight = 1;
+    diskann::IOScheduler scheduler(classes, 1);
+
+    // hold the only slot while four reads of each class queue up
+    scheduler.acquire(0, 1);
+    std::mutex order_lock;
+    std::vector<uint32_t> order;
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        uint32_t cls = i % 2;
+        threads.emplace_back([&, cls]() {
+            scheduler.acquire(cls, 1);
+            {
+                std::lock_guard<std::mutex> guard(order_lock);
+                order.push_back(cls);
+            }
+            scheduler.release(cls, 1);
+        });
+    }
+    wait_for_waiters(scheduler, 8);
+    scheduler.release(0, 1);
+    for (auto &thread : threads)
+        thread.join();
+
+    // virtual times: class 0 starts at 1/3 after the slot held above and steps by 1/3,
+    // class 1 starts at 0 and steps by 1; the lower goes first and class 0 wins ties
+    std::vector<uint32_t> expected{1, 0, 0, 0, 1, 0, 1, 1};
+    BOOST_TEST(order == expected);
+
+    auto stats = scheduler.get_class_stats();
+    BOOST_TEST(stats[0].n_grants == 5);
+    BOOST_TEST(stats[1].n_grants == 4);
+}
+
+BOOST_AUTO_TEST_CASE(test_class_cap_does_not_block_others)
+{
+    std::vector<diskann::IOScheduler::ClassConfig> classes(2);
+    classes[0].max_depth = 1;
+    diskann::IOScheduler scheduler(classes, 4);
+    BOOST_TEST(scheduler.max_grant(0) == 1);
+    BOOST_TEST(scheduler.max_grant(1) == 4);
+
+    // larger requests are clamped to the class cap
+    scheduler.acquire(0, 3);
+    std::atomic<bool> granted{false};
+    std::thread capped([&]() {
+        scheduler.acquire(0, 1);
+        granted = true;
+    });
+    wait_for_waiters(scheduler, 1);
+    BOOST_TEST(!granted);
+
+    // class 0 is waiting on its own cap, with device slots to spare
+    scheduler.acquire(1, 3);
+    BOOST_TEST(!granted);
+
+    scheduler.release(0, 1);
+    capped.join();
+    BOOST_TEST(granted);
+
+    auto stats = scheduler.get_class_stats();
+    BOOST_TEST(stats[0].n_reads == 2);
+    BOOST_TEST(stats[1].n_reads == 3);
+    scheduler.release(0, 1);
+    scheduler.release(1, 3);
+}
+
+BOOST_AUTO_TEST_CASE(test_device_cap)
+{
+    std::vector<diskann::IOScheduler::ClassConfig> classes(1);
+    diskann::IOScheduler scheduler(classes, 2);
+
+    // charged reads count against the device without waiting
+    scheduler.charge(0, 2);
+    std::atomic<bool> granted{false};
+    std::thread waiter([&]() {
+        scheduler.acquire(0, 1);
+        granted = true;
+    });
+    wait_for_waiters(scheduler, 1);
+    BOOST_TEST(!granted);
+    scheduler.release(0, 1);
+    waiter.join();
+    BOOST_TEST(granted);
+    scheduler.release(0, 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_blocking_read_with_own_reads_charged)
+{
+    std::vector<diskann::IOScheduler::ClassConfig> classes(1);
+    auto scheduler = std::make_shared<diskann::IOScheduler>(classes, 2);
+    auto inner = std::make_shared<InstantReader>();
+    ScheduledAlignedFileReader reader(inner, scheduler);
+
+    // the thread's own submitted reads fill the device; a blocking read (a rerank
+    // behind other queries' reads) must not wait for them
+    auto done = std::async(std::launch::async, [&]() {
+        std::vector<AlignedRead> reqs(2);
+        reader.submit_reqs(reqs, inner->ctx);
+        std::vector<AlignedRead> rerank(1);
+        reader.read(rerank, inner->ctx);
+        std::vector<void *> bufs;
+        reader.get_completions(inner->ctx, 2, bufs);
+        return bufs.size();
+    });
+    bool finished = done.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+    if (!finished)
+        scheduler->release(0, 2); // let the stuck read through before failing
+    BOOST_REQUIRE(finished);
+    BOOST_TEST(done.get() == 2);
+
+    // everything was given back: a fresh thread gets the whole device
+    scheduler->acquire(0, 2);
+    scheduler->release(0, 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_bad_config)
+{
+    std::vector<diskann::IOScheduler::ClassConfig> classes(1);
+    BOOST_CHECK_THROW(diskann::IOScheduler(classes, 0), diskann::ANNException);
+    classes[0].weight = 0;
+    BOOST_CHECK_THROW(diskann::IOScheduler(classes, 1), diskann::ANNException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
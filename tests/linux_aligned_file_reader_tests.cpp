@@ -0,0 +1,116 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#ifndef _WINDOWS
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "linux_aligned_file_reader.h"
+
+namespace
+{
+const uint64_t SECTOR = 4096;
+
+// bufs are never touched by merge_requests, only told apart
+void *buf_of(uint64_t i)
+{
+    return (void *)((i + 1) * SECTOR);
+}
+
+struct Merged
+{
+    std::vector<diskann::MergedRead> merged;
+    std::vector<iovec> iovs;
+    std::vector<std::pair<AlignedRead *, AlignedRead *>> dups;
+
+    explicit Merged(std::vector<AlignedRead> &reqs)
+    {
+        diskann::merge_requests(reqs, merged, iovs, dups);
+    }
+};
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(MergeRequests_tests)
+
+BOOST_AUTO_TEST_CASE(test_contiguous_runs_and_gaps)
+{
+    // sectors 5, 3, 4 and 8, out of order: 3-5 make one read, 8 another
+    std::vector<AlignedRead> reqs{{5 * SECTOR, SECTOR, buf_of(0)},
+                                  {3 * SECTOR, SECTOR, buf_of(1)},
+                                  {8 * SECTOR, SECTOR, buf_of(2)},
+                                  {4 * SECTOR, SECTOR, buf_of(3)}};
+    Merged m(reqs);
+    BOOST_TEST(m.dups.empty());
+    BOOST_REQUIRE(m.merged.size() == 2);
+    BOOST_TEST(m.merged[0].offset == 3 * SECTOR);
+    BOOST_TEST(m.merged[0].len == 3 * SECTOR);
+    BOOST_TEST(m.merged[0].iov_start == 0);
+    BOOST_TEST(m.merged[0].n_iovs == 3);
+    BOOST_TEST(m.merged[1].offset == 8 * SECTOR);
+    BOOST_TEST(m.merged[1].len == SECTOR);
+    BOOST_TEST(m.merged[1].iov_start == 3);
+    BOOST_TEST(m.merged[1].n_iovs == 1);
+
+    // the iovecs scatter each range into its requests' buffers, in file order
+    BOOST_REQUIRE(m.iovs.size() == 4);
+    BOOST_TEST(m.iovs[0].iov_base == buf_of(1));
+    BOOST_TEST(m.iovs[1].iov_base == buf_of(3));
+    BOOST_TEST(m.iovs[2].iov_base == buf_of(0));
+    BOOST_TEST(m.iovs[3].iov_base == buf_of(2));
+    for (auto &iov : m.iovs)
+        BOOST_TEST(iov.iov_len == SECTOR);
+}
+
+BOOST_AUTO_TEST_CASE(test_identical_offsets)
+{
+    std::vector<AlignedRead> reqs{{2 * SECTOR, SECTOR, buf_of(0)},
+                                  {2 * SECTOR, SECTOR, buf_of(1)},
+                                  {3 * SECTOR, SECTOR, buf_of(2)},
+                                  {2 * SECTOR, SECTOR, buf_of(3)}};
+    Merged m(reqs);
+    BOOST_REQUIRE(m.merged.size() == 1);
+    BOOST_TEST(m.merged[0].offset == 2 * SECTOR);
+    BOOST_TEST(m.merged[0].len == 2 * SECTOR);
+    BOOST_TEST(m.merged[0].n_iovs == 2);
+
+    // the two repeats are copied from the one read
+    BOOST_REQUIRE(m.dups.size() == 2);
+    AlignedRead *twin = m.dups[0].first;
+    BOOST_TEST(twin->offset == 2 * SECTOR);
+    BOOST_TEST(m.iovs[0].iov_base == twin->buf);
+    for (auto &dup : m.dups)
+    {
+        BOOST_TEST(dup.first == twin);
+        BOOST_TEST(dup.second != twin);
+        BOOST_TEST(dup.second->offset == 2 * SECTOR);
+    }
+
+    // the same offset with another length is a read of its own
+    std::vector<AlignedRead> longer{{0, SECTOR, buf_of(0)}, {0, 2 * SECTOR, buf_of(1)}};
+    Merged l(longer);
+    BOOST_TEST(l.dups.empty());
+    BOOST_TEST(l.merged.size() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_iovec_cap)
+{
+    // one contiguous range of 2.5 caps' worth of sectors
+    const uint64_t n = 2 * MAX_IOVS_PER_READ + MAX_IOVS_PER_READ / 2;
+    std::vector<AlignedRead> reqs;
+    for (uint64_t i = 0; i < n; i++)
+        reqs.emplace_back(i * SECTOR, SECTOR, buf_of(i));
+    Merged m(reqs);
+    BOOST_REQUIRE(m.merged.size() == 3);
+    BOOST_TEST(m.merged[0].n_iovs == (uint64_t)MAX_IOVS_PER_READ);
+    BOOST_TEST(m.merged[1].n_iovs == (uint64_t)MAX_IOVS_PER_READ);
+    BOOST_TEST(m.merged[2].n_iovs == (uint64_t)(MAX_IOVS_PER_READ / 2));
+    BOOST_TEST(m.merged[1].offset == MAX_IOVS_PER_READ * SECTOR);
+    BOOST_TEST(m.merged[1].iov_start == (uint64_t)MAX_IOVS_PER_READ);
+    BOOST_TEST(m.merged[2].len == (MAX_IOVS_PER_READ / 2) * SECTOR);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
@@ -0,0 +1,94 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <vector>
+
+#include "ann_exception.h"
+#include "node_cache_table.h"
+
+BOOST_AUTO_TEST_SUITE(NodeCacheTable_tests)
+
+BOOST_AUTO_TEST_CASE(test_lookup)
+{
+    std::vector<uint32_t> node_ids;
+    for (uint32_t i = 0; i < 1000; i++)
+        node_ids.push_back(i * 7919 + 3);
+    diskann::NodeCacheTable cache(node_ids, 12, 5);
+    BOOST_TEST(cache.size() == node_ids.size());
+    BOOST_TEST(cache.has_coords());
+    BOOST_TEST(cache.slot_len() == 64);
+
+    for (uint32_t slot = 0; slot < node_ids.size(); slot++)
+    {
+        BOOST_TEST(cache.find(node_ids[slot]) == (int64_t)slot);
+        BOOST_TEST(cache.node_id(slot) == node_ids[slot]);
+    }
+    for (uint32_t id = 0; id < 1000; id++)
+    {
+        if (id % 7919 != 3)
+            BOOST_TEST(cache.find(id) == -1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_slot_layout)
+{
+    std::vector<uint32_t> node_ids{42, 17};
+    diskann::NodeCacheTable cache(node_ids, 40, 16);
+    BOOST_TEST(cache.slot_len() == 128);
+    BOOST_TEST((void *)cache.nhood(1) == (void *)(cache.coords(1) + 40));
+    BOOST_TEST((void *)cache.coords(1) == (void *)(cache.coords(0) + cache.slot_len()));
+    BOOST_TEST(((uintptr_t)cache.coords(0) & 63) == 0);
+
+    // slots start out zeroed, so an empty neighbourhood reads as such
+    BOOST_TEST(*cache.nhood(0) == 0);
+    uint32_t *nhood = cache.nhood(0);
+    nhood[0] = 2;
+    nhood[1] = 17;
+    nhood[2] = 99;
+    BOOST_TEST(cache.nhood(cache.find(42))[2] == 99);
+
+    // graph-only: the neighbourhood starts the slot
+    diskann::NodeCacheTable graph_only(node_ids, 0, 16);
+    BOOST_TEST(!graph_only.has_coords());
+    BOOST_TEST((void *)graph_only.nhood(1) == (void *)graph_only.coords(1));
+    BOOST_TEST(graph_only.slot_len() == 128);
+}
+
+BOOST_AUTO_TEST_CASE(test_loaded_flags)
+{
+    std::vector<uint32_t> node_ids{5, 6, 7};
+    diskann::NodeCacheTable cache(node_ids, 16, 4);
+    for (uint64_t slot = 0; slot < cache.size(); slot++)
+        BOOST_TEST(!cache.loaded(slot));
+    cache.set_loaded(1);
+    BOOST_TEST(!cache.loaded(0));
+    BOOST_TEST(cache.loaded(1));
+    BOOST_TEST(!cache.loaded(2));
+    // find() answers for slots still loading; callers check loaded()
+    BOOST_TEST(cache.find(7) == 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_duplicates_and_empty)
+{
+    std::vector<uint32_t> node_ids{9, 4, 9};
+    diskann::NodeCacheTable cache(node_ids, 0, 4);
+    BOOST_TEST(cache.find(9) == 0);
+    BOOST_TEST(cache.find(4) == 1);
+
+    diskann::NodeCacheTable empty(std::vector<uint32_t>(), 16, 4);
+    BOOST_TEST(empty.size() == 0);
+    BOOST_TEST(empty.find(0) == -1);
+    BOOST_TEST(empty.find(12345) == -1);
+}
+
+BOOST_AUTO_TEST_CASE(test_invalid_node_id)
+{
+    // the all-ones id marks empty index entries
+    std::vector<uint32_t> node_ids{3, 0xFFFFFFFF};
+    BOOST_CHECK_THROW(diskann::NodeCacheTable(node_ids, 16, 4), diskann::ANNException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
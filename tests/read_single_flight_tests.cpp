@@ -0,0 +1,78 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+#include <vector>
+
+#include "read_single_flight.h"
+
+namespace
+{
+const uint64_t BLOCK_LEN = 512;
+}
+
+BOOST_AUTO_TEST_SUITE(ReadSingleFlight_tests)
+
+BOOST_AUTO_TEST_CASE(test_waiter_gets_leaders_block)
+{
+    diskann::ReadSingleFlight flights(BLOCK_LEN);
+    BOOST_TEST(flights.join(5) == nullptr);
+    auto flight = flights.join(5);
+    BOOST_REQUIRE(flight != nullptr);
+
+    std::vector<char> dst(BLOCK_LEN, 0);
+    bool ok = false;
+    std::thread waiter([&]() { ok = flights.wait(flight, dst.data()); });
+    std::vector<char> block(BLOCK_LEN, 'x');
+    flights.land(5, block.data());
+    waiter.join();
+
+    BOOST_TEST(ok);
+    BOOST_TEST(dst == block);
+    BOOST_TEST(flights.num_deduped() == 1);
+    // the landed flight left the table: the next query leads a new read
+    BOOST_TEST(flights.join(5) == nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(test_failed_read_falls_back)
+{
+    diskann::ReadSingleFlight flights(BLOCK_LEN);
+    BOOST_TEST(flights.join(9) == nullptr);
+    auto first = flights.join(9);
+    auto second = flights.join(9);
+    BOOST_REQUIRE(first != nullptr);
+    BOOST_TEST(first == second);
+
+    std::vector<char> dst(BLOCK_LEN, 0);
+    bool ok = true;
+    std::thread waiter([&]() { ok = flights.wait(first, dst.data()); });
+    flights.land(9, nullptr);
+    waiter.join();
+    BOOST_TEST(!ok);
+    BOOST_TEST(!flights.wait(second, dst.data()));
+    BOOST_TEST(flights.num_deduped() == 0);
+
+    // a waiter falling back reads the block itself, and may lead that read
+    BOOST_TEST(flights.join(9) == nullptr);
+    auto retry = flights.join(9);
+    BOOST_REQUIRE(retry != nullptr);
+    std::vector<char> block(BLOCK_LEN, 'y');
+    flights.land(9, block.data());
+    BOOST_TEST(flights.wait(retry, dst.data()));
+    BOOST_TEST(dst == block);
+    BOOST_TEST(flights.num_deduped() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_land_without_flight)
+{
+    diskann::ReadSingleFlight flights(BLOCK_LEN, 4);
+    std::vector<char> block(BLOCK_LEN, 'z');
+    flights.land(3, block.data());
+    BOOST_TEST(flights.join(3) == nullptr);
+    flights.land(3, nullptr);
+    BOOST_TEST(flights.num_deduped() == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
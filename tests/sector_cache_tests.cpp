@@ -0,0 +1,82 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+#include "sector_cache.h"
+
+namespace
+{
+// stripes allocate their slots sector aligned
+const uint64_t BLOCK_LEN = 4096;
+
+std::vector<char> block_of(uint64_t block_id)
+{
+    return std::vector<char>(BLOCK_LEN, (char)block_id);
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(SectorCache_tests)
+
+BOOST_AUTO_TEST_CASE(test_clock_eviction_order)
+{
+    // one stripe, so that all blocks share one clock
+    diskann::SectorCache cache(3 * BLOCK_LEN, BLOCK_LEN, 1);
+    BOOST_TEST(cache.capacity_blocks() == 3);
+    for (uint64_t id = 1; id <= 3; id++)
+        cache.insert(id, block_of(id).data());
+
+    std::vector<char> dst(BLOCK_LEN);
+    BOOST_TEST(cache.lookup(1, dst.data()));
+    BOOST_TEST(dst == block_of(1));
+
+    // the hand clears block 1's reference bit and takes block 2, then block 3
+    cache.insert(4, block_of(4).data());
+    cache.insert(5, block_of(5).data());
+
+    BOOST_TEST(!cache.lookup(2, dst.data()));
+    BOOST_TEST(!cache.lookup(3, dst.data()));
+    BOOST_TEST(cache.lookup(1, dst.data()));
+    BOOST_TEST(dst == block_of(1));
+    BOOST_TEST(cache.lookup(4, dst.data()));
+    BOOST_TEST(dst == block_of(4));
+    BOOST_TEST(cache.lookup(5, dst.data()));
+    BOOST_TEST(dst == block_of(5));
+
+    // the lookups set all three reference bits, so the next sweep clears them and comes
+    // back round to block 1
+    cache.insert(6, block_of(6).data());
+    BOOST_TEST(!cache.lookup(1, dst.data()));
+    BOOST_TEST(cache.lookup(6, dst.data()));
+}
+
+BOOST_AUTO_TEST_CASE(test_hit_and_miss_counters)
+{
+    diskann::SectorCache cache(4 * BLOCK_LEN, BLOCK_LEN, 2);
+    std::vector<char> dst(BLOCK_LEN);
+    BOOST_TEST(!cache.lookup(7, dst.data()));
+    BOOST_TEST(cache.num_hits() == 0);
+    BOOST_TEST(cache.num_misses() == 1);
+
+    cache.insert(7, block_of(7).data());
+    // a block already present is not replaced
+    cache.insert(7, block_of(8).data());
+    BOOST_TEST(cache.lookup(7, dst.data()));
+    BOOST_TEST(dst == block_of(7));
+    BOOST_TEST(cache.lookup(7, dst.data()));
+    BOOST_TEST(cache.num_hits() == 2);
+    BOOST_TEST(cache.num_misses() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_zero_capacity)
+{
+    diskann::SectorCache cache(BLOCK_LEN - 1, BLOCK_LEN);
+    BOOST_TEST(cache.capacity_blocks() == 0);
+    cache.insert(1, block_of(1).data());
+    std::vector<char> dst(BLOCK_LEN);
+    BOOST_TEST(!cache.lookup(1, dst.data()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
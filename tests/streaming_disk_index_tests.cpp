@@ -0,0 +1,167 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "disk_utils.h"
+#include "streaming_disk_index.h"
+#include "utils.h"
+
+#ifndef _WINDOWS
+#include "linux_aligned_file_reader.h"
+#else
+#include "windows_aligned_file_reader.h"
+#endif
+
+namespace
+{
+const uint32_t NUM_POINTS = 300;
+const uint32_t DIM = 8;
+const uint64_t K = 5;
+
+std::shared_ptr<AlignedFileReader> make_reader()
+{
+#ifndef _WINDOWS
+    return std::make_shared<LinuxAlignedFileReader>();
+#else
+    return std::make_shared<WindowsAlignedFileReader>();
+#endif
+}
+
+std::vector<float> random_points(uint32_t num_points, uint32_t seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> points((size_t)num_points * DIM);
+    for (auto &x : points)
+        x = dist(gen);
+    return points;
+}
+
+// holds the files a test writes, and removes them when it ends, failed or not
+struct ScratchDir
+{
+    const std::filesystem::path path;
+
+    explicit ScratchDir(const std::string &name) : path(name)
+    {
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directory(path);
+    }
+    ~ScratchDir()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+    std::string file(const std::string &name) const
+    {
+        return (path / name).string();
+    }
+};
+
+// polls `done` every 10 ms for up to a minute
+template <typename Pred> bool eventually(Pred done)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::minutes(1);
+    while (!done())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+}
+
+bool found(diskann::StreamingDiskIndex<float> &index, const float *query, uint64_t id)
+{
+    std::vector<uint64_t> ids(K);
+    std::vector<float> dists(K);
+    uint64_t n = index.search(query, K, 32, 4, ids.data(), dists.data());
+    return std::find(ids.begin(), ids.begin() + n, id) != ids.begin() + n;
+}
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(StreamingDiskIndex_tests)
+
+BOOST_AUTO_TEST_CASE(test_insert_delete_merge)
+{
+    // declared before the index, whose destructor still saves deletes into it
+    ScratchDir dir("streaming_disk_index_tests");
+    const std::string data_file = dir.file("data.bin");
+    const std::string prefix = dir.file("a");
+    const std::string merged_prefix = dir.file("b");
+    std::vector<float> base = random_points(NUM_POINTS, 1);
+    diskann::save_bin<float>(data_file, base.data(), NUM_POINTS, DIM);
+    BOOST_REQUIRE(diskann::build_disk_index<float>(data_file.c_str(), prefix.c_str(), "16 32 0.00003 1 2",
+                                                   diskann::Metric::L2) == 0);
+
+    diskann::StreamingDiskIndex<float> index(make_reader, prefix, 2, 100, 32);
+    BOOST_TEST(index.num_disk_points() == NUM_POINTS);
+
+    // new points take the ids after the SSD index's and are searchable at once
+    std::vector<float> inserted = random_points(20, 2);
+    for (uint32_t i = 0; i < 20; i++)
+        BOOST_TEST(index.insert(inserted.data() + i * DIM) == NUM_POINTS + i);
+    BOOST_TEST(index.num_mem_points() == 20);
+    BOOST_TEST(found(index, inserted.data() + 3 * DIM, NUM_POINTS + 3));
+
+    BOOST_TEST(found(index, base.data() + 5 * DIM, 5));
+    BOOST_TEST(index.remove(5));
+    BOOST_TEST(!index.remove(5));
+    BOOST_TEST(!index.remove(NUM_POINTS + 100));
+    BOOST_TEST(index.remove(NUM_POINTS + 7));
+    BOOST_TEST(index.num_deleted() == 2);
+    BOOST_TEST(!found(index, base.data() + 5 * DIM, 5));
+    BOOST_TEST(!found(index, inserted.data() + 7 * DIM, NUM_POINTS + 7));
+
+    // the merged index holds every id, deleted ones included, and keeps them deleted
+    BOOST_TEST(index.merge(merged_prefix));
+    BOOST_TEST(index.index_prefix() == merged_prefix);
+    BOOST_TEST(index.num_disk_points() == NUM_POINTS + 20);
+    BOOST_TEST(index.num_mem_points() == 0);
+    BOOST_TEST(found(index, inserted.data() + 3 * DIM, NUM_POINTS + 3));
+    BOOST_TEST(found(index, base.data() + 9 * DIM, 9));
+    BOOST_TEST(!found(index, base.data() + 5 * DIM, 5));
+    BOOST_TEST(!found(index, inserted.data() + 7 * DIM, NUM_POINTS + 7));
+
+    // deletes after the switch reach the merged index, which saves them on a flush
+    BOOST_TEST(index.remove(NUM_POINTS + 3));
+    BOOST_TEST(!found(index, inserted.data() + 3 * DIM, NUM_POINTS + 3));
+    index.flush_deletes();
+    std::unique_ptr<uint32_t[]> deleted_ids;
+    size_t num_deleted_ids, ncols;
+    diskann::load_bin<uint32_t>(merged_prefix + "_disk.index_deleted_ids.bin", deleted_ids, num_deleted_ids, ncols);
+    std::vector<uint32_t> saved(deleted_ids.get(), deleted_ids.get() + num_deleted_ids);
+    std::vector<uint32_t> expected{5, NUM_POINTS + 3, NUM_POINTS + 7};
+    std::sort(saved.begin(), saved.end());
+    BOOST_TEST(saved == expected);
+
+    // a background merge that finishes without being waited for does not hold up the next
+    // one: once it is done, start_merge() goes through
+    index.start_merge(prefix);
+    BOOST_REQUIRE(eventually([&]() { return index.index_prefix() == prefix; }));
+    BOOST_REQUIRE(eventually([&]() {
+        try
+        {
+            index.start_merge(merged_prefix);
+            return true;
+        }
+        catch (const diskann::ANNException &)
+        {
+            return false; // still running
+        }
+    }));
+    BOOST_TEST(index.wait_for_merge());
+    BOOST_TEST(index.index_prefix() == merged_prefix);
+    BOOST_TEST(found(index, base.data() + 9 * DIM, 9));
+    BOOST_TEST(!found(index, inserted.data() + 3 * DIM, NUM_POINTS + 3));
+}
+
+BOOST_AUTO_TEST_SUITE_END()